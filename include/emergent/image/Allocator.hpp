@@ -0,0 +1,250 @@
+#pragma once
+
+#include <emergent/Emergent.hpp>
+#include <atomic>
+#include <bit>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+
+#if defined(__linux__)
+	#include <sys/mman.h>
+#endif
+
+
+// namespace emergent::image  // >= c++17 only :(
+namespace emergent { namespace image
+{
+	// The source of memory for image buffers. Implement this to supply memory from elsewhere, such as
+	// an arena or a shared memory segment. An allocator must outlive every buffer that uses it and
+	// must be safe to call from multiple threads.
+	class Allocator
+	{
+		public:
+
+			// Alignment of every allocation, which suits the widest vector registers and cache lines
+			static constexpr size_t ALIGNMENT = 64;
+
+
+			virtual ~Allocator() = default;
+
+			// Allocate at least the given number of bytes aligned to ALIGNMENT, throwing
+			// std::bad_alloc on failure.
+			virtual void *Allocate(const size_t bytes) = 0;
+
+			// Release memory previously allocated with the same number of bytes
+			virtual void Release(void *data, const size_t bytes) = 0;
+
+
+			// The allocator used by buffers that are not given one
+			static Allocator &Default();
+
+			// Change the default allocator, buffers that already exist continue to use the one
+			// that they were created with.
+			static void Default(Allocator &allocator);
+
+		private:
+
+			static std::atomic<Allocator *> &Current();
+	};
+
+
+	// Allocates directly from the system with the required alignment. Optionally, allocations of at least
+	// the size of a huge page are aligned to one and marked as candidates for transparent huge pages,
+	// which reduces TLB misses when working on large images (Linux only).
+	class AlignedAllocator : public Allocator
+	{
+		public:
+
+			static constexpr size_t HUGE_PAGE = 2 << 20;
+
+
+			explicit AlignedAllocator(const bool hugePages = false) : hugePages(hugePages) {}
+
+
+			void *Allocate(const size_t bytes) override
+			{
+				void *result = ::operator new(bytes, std::align_val_t { this->Alignment(bytes) });
+
+				#if defined(__linux__) && defined(MADV_HUGEPAGE)
+					if (this->Alignment(bytes) == HUGE_PAGE)
+					{
+						madvise(result, bytes, MADV_HUGEPAGE);
+					}
+				#endif
+
+				return result;
+			}
+
+
+			void Release(void *data, const size_t bytes) override
+			{
+				::operator delete(data, std::align_val_t { this->Alignment(bytes) });
+			}
+
+
+			// A shared instance without huge pages. Like the shared pool it is never destroyed.
+			static AlignedAllocator &Shared()
+			{
+				static auto *allocator = new AlignedAllocator();
+				return *allocator;
+			}
+
+		private:
+
+			size_t Alignment(const size_t bytes) const
+			{
+				return this->hugePages && bytes >= HUGE_PAGE ? HUGE_PAGE : ALIGNMENT;
+			}
+
+			const bool hugePages;
+	};
+
+
+	// Recycles released memory so that images of a similar size, such as successive frames passing
+	// through a pipeline, do not go back to the system for every allocation. Sizes are rounded up to
+	// classes of a quarter of a power of two, wasting at most 25%, and a free list is kept for each
+	// class. Memory beyond the limit is returned upstream rather than held.
+	//
+	//    image::Allocator::Default(image::BufferPool::Shared());
+	class BufferPool : public Allocator
+	{
+		public:
+
+			explicit BufferPool(const size_t limit = 512 << 20, Allocator &upstream = AlignedAllocator::Shared())
+				: limit(limit), upstream(upstream) {}
+
+
+			~BufferPool()
+			{
+				this->Trim();
+			}
+
+
+			void *Allocate(const size_t bytes) override
+			{
+				const size_t size = Round(bytes);
+
+				{
+					std::lock_guard<std::mutex> lock(this->cs);
+
+					auto &free = this->free[size];
+
+					if (!free.empty())
+					{
+						void *result = free.back();
+						free.pop_back();
+						this->cached -= size;
+						this->recycled++;
+
+						return result;
+					}
+				}
+
+				return this->upstream.Allocate(size);
+			}
+
+
+			void Release(void *data, const size_t bytes) override
+			{
+				const size_t size = Round(bytes);
+
+				{
+					std::lock_guard<std::mutex> lock(this->cs);
+
+					if (this->cached + size <= this->limit)
+					{
+						this->free[size].push_back(data);
+						this->cached += size;
+
+						return;
+					}
+				}
+
+				this->upstream.Release(data, size);
+			}
+
+
+			// Return all of the cached memory upstream
+			void Trim()
+			{
+				std::lock_guard<std::mutex> lock(this->cs);
+
+				for (auto &[size, free] : this->free)
+				{
+					for (auto *data : free)
+					{
+						this->upstream.Release(data, size);
+					}
+				}
+
+				this->free.clear();
+				this->cached = 0;
+			}
+
+
+			// Number of bytes currently held for reuse
+			size_t Cached() const
+			{
+				std::lock_guard<std::mutex> lock(this->cs);
+				return this->cached;
+			}
+
+
+			// Number of allocations that have been satisfied from the pool
+			size_t Recycled() const
+			{
+				std::lock_guard<std::mutex> lock(this->cs);
+				return this->recycled;
+			}
+
+
+			// The size class that an allocation of the given number of bytes belongs to
+			static size_t Round(const size_t bytes)
+			{
+				if (bytes <= ALIGNMENT) return ALIGNMENT;
+
+				const size_t step = std::max<size_t>(std::bit_floor(bytes - 1) / 4, ALIGNMENT);
+
+				return (bytes + step - 1) / step * step;
+			}
+
+
+			// The process-wide pool. It is never destroyed so that buffers belonging to static
+			// images can still be released safely at exit.
+			static BufferPool &Shared()
+			{
+				static auto *pool = new BufferPool();
+				return *pool;
+			}
+
+		private:
+
+			const size_t limit;
+			Allocator &upstream;
+
+			mutable std::mutex cs;
+			std::unordered_map<size_t, std::vector<void *>> free;
+			size_t cached	= 0;
+			size_t recycled	= 0;
+	};
+
+
+	inline Allocator &Allocator::Default()
+	{
+		return *Current().load(std::memory_order_acquire);
+	}
+
+
+	inline void Allocator::Default(Allocator &allocator)
+	{
+		Current().store(&allocator, std::memory_order_release);
+	}
+
+
+	inline std::atomic<Allocator *> &Allocator::Current()
+	{
+		static std::atomic<Allocator *> current = &AlignedAllocator::Shared();
+		return current;
+	}
+}}
@@ -1,7 +1,10 @@
 #pragma once
 
 #include <emergent/Emergent.hpp>
+#include <emergent/image/Allocator.hpp>
+#include <cstdint>
 #include <cstring>
+#include <new>
 
 
 // namespace emergent::image  // >= c++17 only :(
@@ -11,6 +14,10 @@ namespace emergent { namespace image
 	// only ever dealing with fundamental types then there is no need to invoke destructors
 	// and so this is much more efficient than vector for resizing.
 	// It meets some of the requirements for a Container type.
+	//
+	// Memory comes from an Allocator, by default the process-wide one (see Allocator::Default),
+	// and is always aligned to Allocator::ALIGNMENT. A buffer keeps the allocator that it was
+	// created with so that memory is always released to where it came from.
 	template <typename T> struct Buffer
 	{
 		using value_type		= T;
@@ -18,45 +25,68 @@ namespace emergent { namespace image
 		using iterator 			= typename std::vector<T>::iterator;
 		using const_iterator	= typename std::vector<T>::const_iterator;
 
-		T *storage		= nullptr;
-		size_t used		= 0;
-		size_t capacity = 0;
+		T *storage				= nullptr;
+		size_t used				= 0;
+		size_t capacity			= 0;
+		Allocator *allocator	= &Allocator::Default();
 
 
 		Buffer() = default;
 
-		Buffer(const Buffer<T> &other)
+		explicit Buffer(Allocator &allocator) : allocator(&allocator) {}
+
+		Buffer(const Buffer<T> &other) : allocator(other.allocator)
 		{
 			*this = other;
 		}
 
-		Buffer(Buffer<T> &&other) : storage(other.storage), used(other.used), capacity(other.capacity)
+		Buffer(Buffer<T> &&other) : storage(other.storage), used(other.used), capacity(other.capacity), allocator(other.allocator)
 		{
 			other.storage	= nullptr;
 			other.used		= other.capacity = 0;
 		}
 
-		explicit Buffer(const size_t size)
+		explicit Buffer(const size_t size, Allocator &allocator = Allocator::Default()) : allocator(&allocator)
 		{
 			this->resize(size);
 		}
 
 		~Buffer()
 		{
-			if (this->storage)
-			{
-				delete [] this->storage;
-			}
+			this->release();
 		}
 
 
 		Buffer& operator=(const Buffer &other)
 		{
-			this->resize(other.size());
-			if (this->storage)
+			if (this != &other)
 			{
-				std::memcpy(this->storage, other.storage, other.size() * sizeof(T));
+				// The existing contents are about to be overwritten so there is no need to preserve them
+				if (other.size() > this->capacity)
+				{
+					this->reallocate(other.size(), 0);
+				}
+
+				this->used = other.size();
+
+				if (this->used)
+				{
+					std::memcpy(this->storage, other.storage, other.size() * sizeof(T));
+				}
 			}
+
+			return *this;
+		}
+
+
+		// Exchanges the storage, and allocators, of the two buffers
+		Buffer& operator=(Buffer &&other)
+		{
+			std::swap(this->storage, other.storage);
+			std::swap(this->used, other.used);
+			std::swap(this->capacity, other.capacity);
+			std::swap(this->allocator, other.allocator);
+
 			return *this;
 		}
 
@@ -73,23 +103,39 @@ namespace emergent { namespace image
 		}
 
 
+		// Change the size of the buffer, the existing contents are preserved but any new
+		// elements are uninitialised.
 		void resize(const size_t size)
 		{
 			if (size > this->capacity)
 			{
-				if (this->storage)
-				{
-					delete [] this->storage;
-				}
-
-				this->storage	= new T[size];
-				this->capacity	= size;
+				this->reallocate(size, this->used);
 			}
 
 			this->used = size;
 		}
 
 
+		// Ensure that the capacity is at least the given size, preserving the contents
+		void reserve(const size_t size)
+		{
+			if (size > this->capacity)
+			{
+				this->reallocate(size, this->used);
+			}
+		}
+
+
+		// Reduce the capacity to the current size, preserving the contents
+		void shrink_to_fit()
+		{
+			if (this->capacity > this->used)
+			{
+				this->reallocate(this->used, this->used);
+			}
+		}
+
+
 		[[nodiscard]] size_t size() const	{ return this->used; }
 		[[nodiscard]] bool empty() const	{ return this->used == 0; }
 		[[nodiscard]] T *data()				{ return this->storage; }
@@ -104,5 +150,39 @@ namespace emergent { namespace image
 		[[nodiscard]] const_iterator end() const	{ return const_iterator(this->storage + this->used); }
 		[[nodiscard]] const_iterator cbegin() const	{ return const_iterator(this->storage); }
 		[[nodiscard]] const_iterator cend() const	{ return const_iterator(this->storage + this->used); }
+
+
+		private:
+
+			// Replace the storage with a new allocation of the given capacity, copying across
+			// the first `keep` elements.
+			void reallocate(const size_t capacity, const size_t keep)
+			{
+				if (capacity > SIZE_MAX / sizeof(T))
+				{
+					throw std::bad_alloc();
+				}
+
+				T *storage = capacity ? (T *)this->allocator->Allocate(capacity * sizeof(T)) : nullptr;
+
+				if (keep)
+				{
+					std::memcpy(storage, this->storage, keep * sizeof(T));
+				}
+
+				this->release();
+				this->storage	= storage;
+				this->capacity	= capacity;
+			}
+
+
+			void release()
+			{
+				if (this->storage)
+				{
+					this->allocator->Release(this->storage, this->capacity * sizeof(T));
+					this->storage = nullptr;
+				}
+			}
 	};
 }}
@@ -0,0 +1,429 @@
+#pragma once
+
+#include <emergent/Emergent.hpp>
+#include <emergent/image/Simd.hpp>
+
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+
+
+namespace emergent::image
+{
+	// How sample values are mapped when converting an image from one type to another. Where a
+	// full range is used, floating point images are treated as being in the range 0 to 1.
+	enum class Scaling
+	{
+		Automatic,	// Find the range of the source and only rescale it if it does not fit the destination
+		None,		// Cast the values, anything outside the range of the destination type is clamped
+		Full,		// Map the full range of the source type onto the full range of the destination type
+		Shift,		// As Full but integers are shifted by the difference in width (uint16_t to byte keeps the high byte)
+		Range		// Map a known range of source values onto the full range of the destination type
+	};
+
+
+	// Channel weights used when converting RGB to greyscale, these are normalised by their sum.
+	// Integer results of a weighted sum are rounded, whereas the mean truncates in the same way
+	// as integer division.
+	struct Weights
+	{
+		float r = 1;
+		float g = 1;
+		float b = 1;
+	};
+
+	namespace Luma
+	{
+		static const Weights Mean	= { 1.0f, 1.0f, 1.0f };
+		static const Weights Rec601	= { 0.299f, 0.587f, 0.114f };
+		static const Weights Rec709	= { 0.2126f, 0.7152f, 0.0722f };
+	}
+
+
+	// The options for converting between image types. Any scaling other than automatic avoids the
+	// pass over the source data to find its range.
+	struct Conversion
+	{
+		Scaling scaling	= Scaling::Automatic;
+		Weights luma	= {};
+
+		// The known range of source values when using Scaling::Range
+		double low		= 0;
+		double high		= 0;
+
+
+		Conversion(const Scaling scaling = Scaling::Automatic, const Weights &luma = {}) : scaling(scaling), luma(luma) {}
+		Conversion(const Weights &luma) : luma(luma) {}
+
+		// Map the given range of source values onto the destination type
+		Conversion(const double low, const double high, const Weights &luma = {})
+			: scaling(Scaling::Range), luma(luma), low(low), high(high) {}
+	};
+
+
+	// The linear mapping applied to each sample (value * scale + offset) which is then clamped
+	// to the range of the destination type. Integer results are either rounded or truncated.
+	struct Mapping
+	{
+		double scale	= 1;
+		double offset	= 0;
+		bool round		= false;
+
+		bool Identity() const { return this->scale == 1 && this->offset == 0; }
+	};
+
+
+	namespace internal
+	{
+		// The full range of a type where floating point is treated as 0 to 1
+		template <typename T> constexpr double Unit()
+		{
+			return std::is_floating_point_v<T> ? 1.0 : (double)std::numeric_limits<T>::max();
+		}
+
+
+		// Map, clamp and round a single sample. This is the scalar equivalent of the vector
+		// kernel, computed with the precision of C.
+		template <typename T, typename C> T Sample(C value, const C scale, const C offset, const bool round)
+		{
+			value = value * scale + offset;
+
+			if constexpr (std::is_integral_v<T>)
+			{
+				value = std::clamp<C>(value, std::numeric_limits<T>::lowest(), std::numeric_limits<T>::max());
+				return (T)(round ? std::floor(value + (C)0.5) : value);
+			}
+			else
+			{
+				return (T)value;
+			}
+		}
+
+
+		// Converts rows of samples from U to T using vectors of W bytes. Only same depth, RGB to grey
+		// and grey to RGB conversions are supported. Samples are mapped in single precision and the
+		// mean of integers is exact, since the sum is exact and the reciprocal of 3 is rounded up.
+		template <std::size_t W, typename T, typename U> struct Converter
+		{
+			// Each vector holds N samples since the intermediate values are 32-bit
+			static constexpr std::size_t N = W / sizeof(float);
+
+			typedef float F __attribute__((vector_size(W)));
+			typedef int32_t I __attribute__((vector_size(W)));
+			typedef uint16_t H __attribute__((vector_size(W / 2)));
+
+			// N samples of the source (P) and destination (V) types along with their unaligned
+			// equivalents for loading (S) and storing (D). B is the destination type in a full vector.
+			// Unaligned data must be copied into a P rather than bound to a reference, otherwise
+			// GCC assumes that it is aligned.
+			typedef U P __attribute__((vector_size(N * sizeof(U))));
+			typedef U S __attribute__((vector_size(N * sizeof(U)), aligned(sizeof(U)), may_alias));
+			typedef T V __attribute__((vector_size(N * sizeof(T))));
+			typedef T D __attribute__((vector_size(N * sizeof(T)), aligned(sizeof(T)), may_alias));
+			typedef T B __attribute__((vector_size(W)));
+
+
+			// Convert between vectors with the same number of elements. This is a template so that
+			// GCC accepts vectors with a dependent size.
+			template <typename X, typename Y> static void Cast(const X &x, Y &y)
+			{
+				y = __builtin_convertvector(x, Y);
+			}
+
+
+			// Widen integer samples. Conversions that more than double the width of each element
+			// are not vectorised by every compiler, so bytes are widened in stages.
+			static void Widen(const P &p, I &i)
+			{
+				if constexpr (sizeof(U) == 1)
+				{
+					H h;
+					Cast(p, h);
+					Cast(h, i);
+				}
+				else
+				{
+					Cast(p, i);
+				}
+			}
+
+
+			static void Widen(const P &p, F &x)
+			{
+				if constexpr (std::is_integral_v<U>)
+				{
+					I i;
+					Widen(p, i);
+					Cast(i, x);
+				}
+				else
+				{
+					Cast(p, x);
+				}
+			}
+
+
+			// Narrow integers that have already been clamped to the destination type. Truncating
+			// conversions are not vectorised before AVX-512, so the low bytes are shuffled instead.
+			template <std::size_t... L> static void Narrow(const I &i, V &v, std::index_sequence<L...>)
+			{
+				const B b = (B)i;
+				v = __builtin_shufflevector(b, b, (L * sizeof(int32_t) / sizeof(T))...);
+			}
+
+
+			template <std::size_t... L> static void Narrow(const F &x, V &v, std::index_sequence<L...> lanes)
+			{
+				if constexpr (std::is_integral_v<T>)
+				{
+					I i;
+					Cast(x, i);
+					Narrow(i, v, lanes);
+				}
+				else
+				{
+					Cast(x, v);
+				}
+			}
+
+
+			// Shuffle indices for extracting channel k from three interleaved vectors. The first
+			// shuffle gathers the samples found in vectors a and b, the second fills in from c.
+			static constexpr int First(const std::size_t j, const std::size_t k)
+			{
+				return 3 * j + k < 2 * N ? (int)(3 * j + k) : -1;
+			}
+
+			static constexpr int Second(const std::size_t j, const std::size_t k)
+			{
+				return 3 * j + k < 2 * N ? (int)j : (int)(N + 3 * j + k - 2 * N);
+			}
+
+
+			static void Row(T *dst, const U *src, const std::size_t pixels, const byte from, const byte to, const Mapping &mapping, const Weights &luma)
+			{
+				Row(dst, src, pixels, from, to, mapping, luma, std::make_index_sequence<N> {});
+			}
+
+
+			template <std::size_t... L> static void Row(T *dst, const U *src, const std::size_t pixels, const byte from, const byte to, const Mapping &mapping, const Weights &luma, std::index_sequence<L...> lanes)
+			{
+				const float scale	= mapping.scale;
+				const float offset	= mapping.offset;
+				const float inverse	= 1.0f / (luma.r + luma.g + luma.b);
+
+				const F s = F {} + scale, o = F {} + offset, n = F {} + inverse;
+				const F r = F {} + luma.r, g = F {} + luma.g, b = F {} + luma.b;
+				const F upper = F {} + (float)std::numeric_limits<T>::max();
+				const F half = F {} + (mapping.round ? 0.5f : 0.0f);
+
+				// Map, clamp and round in place. The destination types are unsigned or floating point
+				// and since the values are clamped at zero, truncation is the same as the floor.
+				auto map = [&](F &x) {
+					x = x * s + o;
+
+					if constexpr (std::is_integral_v<T>)
+					{
+						x = x < F {} ? F {} : x;
+						x = upper < x ? upper : x;
+						x += half;
+					}
+				};
+
+				auto sample = [&](const float value) {
+					return Sample<T, float>(value, scale, offset, mapping.round);
+				};
+
+				std::size_t i = 0;
+
+				if (from == to)
+				{
+					const std::size_t size = pixels * from;
+
+					for (; i + N <= size; i += N)
+					{
+						const P p = *(const S *)(src + i);
+						F x;
+						V v;
+
+						Widen(p, x);
+						map(x);
+						Narrow(x, v, lanes);
+						*(D *)(dst + i) = v;
+					}
+
+					for (; i < size; i++)
+					{
+						dst[i] = sample(src[i]);
+					}
+				}
+				else if (from == 3 && to == 1)
+				{
+					for (; i + N <= pixels; i += N, src += 3 * N, dst += N)
+					{
+						const P p0 = *(const S *)src, p1 = *(const S *)(src + N), p2 = *(const S *)(src + 2 * N);
+						F cr, cg, cb;
+						V v;
+
+						Widen(__builtin_shufflevector(__builtin_shufflevector(p0, p1, First(L, 0)...), p2, Second(L, 0)...), cr);
+						Widen(__builtin_shufflevector(__builtin_shufflevector(p0, p1, First(L, 1)...), p2, Second(L, 1)...), cg);
+						Widen(__builtin_shufflevector(__builtin_shufflevector(p0, p1, First(L, 2)...), p2, Second(L, 2)...), cb);
+
+						F x = (cr * r + cg * g + cb * b) * n;
+						map(x);
+						Narrow(x, v, lanes);
+						*(D *)dst = v;
+					}
+
+					for (; i < pixels; i++, src += 3)
+					{
+						*dst++ = sample((src[0] * luma.r + src[1] * luma.g + src[2] * luma.b) * inverse);
+					}
+				}
+				else if (from == 1 && to == 3)
+				{
+					for (; i + N <= pixels; i += N, dst += 3 * N)
+					{
+						const P p = *(const S *)(src + i);
+						F x;
+						V v;
+
+						Widen(p, x);
+						map(x);
+						Narrow(x, v, lanes);
+
+						*(D *)dst			= __builtin_shufflevector(v, v, (L / 3)...);
+						*(D *)(dst + N)		= __builtin_shufflevector(v, v, ((L + N) / 3)...);
+						*(D *)(dst + 2 * N)	= __builtin_shufflevector(v, v, ((L + 2 * N) / 3)...);
+					}
+
+					for (; i < pixels; i++, dst += 3)
+					{
+						dst[0] = dst[1] = dst[2] = sample(src[i]);
+					}
+				}
+			}
+		};
+	}
+
+
+	// Determine the mapping from U to T for a conversion. Automatic scaling requires a pass over
+	// the source data to find its range unless every value of U can be represented by T.
+	template <typename T, typename U> Mapping Map(const Conversion &conversion, const U *data, const std::size_t size)
+	{
+		constexpr bool INTEGRAL	= std::is_integral_v<T>;
+		constexpr double MAX	= std::numeric_limits<T>::max();
+
+		switch (conversion.scaling)
+		{
+			case Scaling::None:		return {};
+			case Scaling::Shift:
+
+				if constexpr (INTEGRAL && std::is_integral_v<U>)
+				{
+					return { std::ldexp(1.0, std::numeric_limits<T>::digits - std::numeric_limits<U>::digits), 0, false };
+				}
+
+				[[fallthrough]];
+
+			case Scaling::Full:		return { internal::Unit<T>() / internal::Unit<U>(), 0, INTEGRAL };
+			case Scaling::Range:
+			{
+				const double range = conversion.high - conversion.low;
+				const double scale = range > 0 ? internal::Unit<T>() / range : 0;
+
+				return { scale, -conversion.low * scale, INTEGRAL };
+			}
+
+			default: break;
+		}
+
+		if constexpr ((double)std::numeric_limits<U>::max() - (double)std::numeric_limits<U>::lowest() <= MAX)
+		{
+			return {};
+		}
+		else
+		{
+			if (!size)
+			{
+				return {};
+			}
+
+			std::pair<U, U> bounds;
+
+			if constexpr (simd::Supported<U>)
+			{
+				bounds = simd::MinMax(data, size);
+			}
+			else
+			{
+				const auto minmax	= std::minmax_element(data, data + size);
+				bounds				= { *minmax.first, *minmax.second };
+			}
+
+			const double low	= bounds.first;
+			const double range	= (double)bounds.second - low;
+
+			if (range > MAX)				return { MAX / range, -low * MAX / range, true };
+			if (bounds.second > MAX)		return { 1, -low, false };
+
+			return {};
+		}
+	}
+
+
+	// Convert a row of pixels from U to T, changing the depth from RGB to grey or vice versa
+	// if required. Byte, uint16_t and float images use the vector kernels.
+	template <typename T, typename U> void Convert(T *dst, const U *src, const std::size_t pixels, const byte from, const byte to, const Mapping &mapping, const Weights &luma = {}, const simd::Isa isa = simd::Detect())
+	{
+		const bool weighted = from == 3 && to == 1 && (luma.r != luma.g || luma.g != luma.b);
+
+		if (weighted && !mapping.round)
+		{
+			return Convert(dst, src, pixels, from, to, { mapping.scale, mapping.offset, true }, luma, isa);
+		}
+
+		if constexpr (std::is_same_v<T, U>)
+		{
+			if (from == to && mapping.Identity())
+			{
+				std::copy(src, src + pixels * from, dst);
+				return;
+			}
+		}
+
+		if constexpr (simd::Supported<T> && simd::Supported<U>)
+		{
+			simd::Run(isa, [&](auto w) { internal::Converter<w, T, U>::Row(dst, src, pixels, from, to, mapping, luma); });
+		}
+		else
+		{
+			auto sample = [&](const double value) {
+				return internal::Sample<T, double>(value, mapping.scale, mapping.offset, mapping.round);
+			};
+
+			if (from == to)
+			{
+				std::transform(src, src + pixels * from, dst, sample);
+			}
+			else if (from == 3 && to == 1)
+			{
+				const double total = luma.r + luma.g + luma.b;
+
+				for (std::size_t i=0; i<pixels; i++, src += 3)
+				{
+					*dst++ = sample((src[0] * (double)luma.r + src[1] * (double)luma.g + src[2] * (double)luma.b) / total);
+				}
+			}
+			else if (from == 1 && to == 3)
+			{
+				for (std::size_t i=0; i<pixels; i++, dst += 3)
+				{
+					dst[0] = dst[1] = dst[2] = sample(src[i]);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <emergent/parallel/Parallel.hpp>
+#include <thread>
+
+
+namespace emergent::image
+{
+	// Execution policy for the operations of ImageBase. A parallel policy splits the image into
+	// bands of roughly `band` bytes (whole rows where the operation needs them) which are processed
+	// by the pool along with the calling thread. Images smaller than the threshold are always
+	// processed serially since the cost of waking the pool would outweigh the benefit.
+	//
+	//    img.Threshold(image::par, 128);
+	//    img.Threshold(image::par.On(pool), 128);
+	struct Policy
+	{
+		bool parallel			= false;
+		Executor *pool			= nullptr;	// The pool to use, otherwise the shared one (see SharedPool)
+		std::size_t threshold	= 1 << 20;	// Images of fewer bytes than this are processed serially
+		std::size_t band		= 1 << 18;	// Approximate number of bytes per band, sized to fit in the L2 cache
+
+
+		// The same policy but using the given pool
+		Policy On(Executor &pool) const
+		{
+			auto result = *this;
+			result.pool = &pool;
+			return result;
+		}
+
+
+		// Whether data of the given size should be split
+		bool Split(const std::size_t bytes) const
+		{
+			return this->parallel && bytes >= this->threshold && bytes > this->band;
+		}
+	};
+
+
+	inline constexpr Policy seq {};
+	inline constexpr Policy par { true };
+
+
+	// The pool used by parallel policies that do not specify one. It is created on first use with a
+	// worker for each hardware thread other than the caller, which takes part in every operation.
+	inline Executor &SharedPool()
+	{
+		static Executor pool(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+		return pool;
+	}
+
+
+	namespace internal
+	{
+		inline Executor &PoolFor(const Policy &policy)
+		{
+			return policy.pool ? *policy.pool : SharedPool();
+		}
+
+
+		// Number of elements of type T per band. It is a multiple of 64 bytes so that the bands of an
+		// aligned buffer do not share cache lines, or vector loads.
+		template <typename T> std::size_t Grain(const Policy &policy)
+		{
+			constexpr std::size_t ALIGN = std::max<std::size_t>(64 / sizeof(T), 1);
+
+			return std::max<std::size_t>(policy.band / sizeof(T) / ALIGN, 1) * ALIGN;
+		}
+
+
+		// Number of rows per band where each row is of the given number of bytes
+		inline std::size_t RowGrain(const Policy &policy, const std::size_t row)
+		{
+			return std::max<std::size_t>(policy.band / std::max<std::size_t>(row, 1), 1);
+		}
+
+
+		// Invoke fn(begin, end) over ranges of [0, size) of type T.
+		template <typename T, typename F> void Elements(const Policy &policy, const std::size_t size, F &&fn)
+		{
+			if (!policy.Split(size * sizeof(T)))
+			{
+				fn(std::size_t { 0 }, size);
+				return;
+			}
+
+			ParallelFor(PoolFor(policy), Generator<std::size_t>(0, size), [&](const Generator<std::size_t> &range) {
+				fn(range.first, range.first + range.count);
+			}, { Chunking::Dynamic, Grain<T>(policy) });
+		}
+
+
+		// Invoke fn(begin, end) over bands of whole rows where each row is of the given number of bytes.
+		template <typename F> void Rows(const Policy &policy, const std::size_t height, const std::size_t row, F &&fn)
+		{
+			if (!policy.Split(height * row))
+			{
+				fn(std::size_t { 0 }, height);
+				return;
+			}
+
+			ParallelFor(PoolFor(policy), Generator<std::size_t>(0, height), [&](const Generator<std::size_t> &range) {
+				fn(range.first, range.first + range.count);
+			}, { Chunking::Dynamic, RowGrain(policy, row) });
+		}
+
+
+		// Reduce [0, size) in chunks of grain with fn(begin, end) -> V and combine the partial results,
+		// in order, with combine(V, V) -> V. Any range passed to fn is never empty.
+		template <typename V, typename F, typename C> V Reduce(const Policy &policy, const std::size_t size, const std::size_t bytes, const std::size_t grain, const V &identity, F &&fn, C &&combine)
+		{
+			if (!policy.Split(bytes))
+			{
+				return size ? combine(identity, fn(std::size_t { 0 }, size)) : identity;
+			}
+
+			const std::size_t chunks = (size + grain - 1) / grain;
+
+			return ParallelReduce(PoolFor(policy), Generator<std::size_t>(0, chunks), identity, [&](V result, const std::size_t chunk) {
+				return combine(std::move(result), fn(chunk * grain, std::min(size, (chunk + 1) * grain)));
+			}, combine, { Chunking::Dynamic, 1 });
+		}
+
+
+		// Reduce ranges of [0, size) of type T.
+		template <typename T, typename V, typename F, typename C> V Reduce(const Policy &policy, const std::size_t size, const V &identity, F &&fn, C &&combine)
+		{
+			return Reduce(policy, size, size * sizeof(T), Grain<T>(policy), identity, fn, combine);
+		}
+
+
+		// Reduce bands of whole rows where each row is of the given number of bytes.
+		template <typename V, typename F, typename C> V ReduceRows(const Policy &policy, const std::size_t height, const std::size_t row, const V &identity, F &&fn, C &&combine)
+		{
+			return Reduce(policy, height, height * row, RowGrain(policy, row), identity, fn, combine);
+		}
+	}
+}
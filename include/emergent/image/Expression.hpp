@@ -0,0 +1,717 @@
+#pragma once
+
+#include <emergent/image/ImageView.hpp>
+#include <emergent/image/Execution.hpp>
+#include <emergent/image/Simd.hpp>
+
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+
+
+namespace emergent::image
+{
+	// Lazy arithmetic on images. Combining images and values with the operators below, or with the
+	// functions min, max, clamp, abs and select, builds a tree of nodes that refer to the images
+	// without computing anything. Assigning the tree to an image then evaluates it in a single pass,
+	// one vector of samples at a time, so a pipeline of several steps reads each operand and writes
+	// the result only once and needs no temporary images.
+	//
+	//    dst = clamp(a * 0.5 + b - 10, 0, 255) > 128;
+	//    dst.Assign(image::par, max(a, b) - min(a, b));
+	//    image::Evaluate(image::par, view, select(mask, a, 0));
+	//
+	// Every image in an expression must have the same dimensions and depth. The destination may also
+	// be one of the operands but must not otherwise overlap them. Each operation is computed with C++
+	// promotion rules, so the sum of two byte images does not overflow, except that floating point
+	// values are not promoted to double unless one of the images is. Comparisons result in 255 or 0,
+	// as Threshold does, and the result is saturated to the range of the destination type. Integer
+	// division by zero results in 0.
+
+
+	// The base of all expression nodes
+	struct Expression {};
+
+	template <typename E> constexpr bool IsExpression = std::is_base_of_v<Expression, E>;
+
+
+	// The dimensions of an expression, a depth of 0 means that it does not involve an image
+	struct Extent
+	{
+		std::size_t width	= 0;
+		std::size_t height	= 0;
+		byte depth			= 0;
+		bool contiguous		= true;
+
+		bool operator==(const Extent &other) const
+		{
+			return this->width == other.width && this->height == other.height && this->depth == other.depth;
+		}
+	};
+
+
+	namespace internal
+	{
+		// The element type and number of lanes of a vector, where a scalar is a single lane
+		template <typename X> struct Lanes
+		{
+			using type = std::remove_cvref_t<decltype(std::declval<X &>()[0])>;
+			static constexpr std::size_t count = sizeof(X) / sizeof(type);
+		};
+
+		template <typename X> requires std::is_arithmetic_v<X> struct Lanes<X>
+		{
+			using type = X;
+			static constexpr std::size_t count = 1;
+		};
+
+		template <typename X> using Lane = typename Lanes<X>::type;
+
+
+		// A vector of N elements of type T (S is the unaligned equivalent for loads and stores), or
+		// T itself when N is 1 so that the same code evaluates single samples. S has no alignment at
+		// all since packed lanes are loaded from and stored to rows of smaller samples.
+		template <typename T, std::size_t N> struct Vector
+		{
+			typedef T V __attribute__((vector_size(N * sizeof(T))));
+			typedef T S __attribute__((vector_size(N * sizeof(T)), aligned(1), may_alias));
+		};
+
+		template <typename T> struct Vector<T, 1>
+		{
+			using V = T;
+			using S = T;
+		};
+
+		// The equivalent of X with elements of type T
+		template <typename T, typename X> using Like = typename Vector<T, Lanes<X>::count>::V;
+
+
+		// The type that an operation on A and B is computed with. Integers are promoted to at least
+		// int and unsigned 32-bit values to int64_t so that subtraction does not wrap.
+		template <typename A, typename B> struct Promote
+		{
+			using C = std::common_type_t<int, A, B>;
+			using type = std::conditional_t<std::is_unsigned_v<C> && sizeof(C) < 8, int64_t, C>;
+		};
+
+		template <typename A, typename B> requires std::is_floating_point_v<A> || std::is_floating_point_v<B> struct Promote<A, B>
+		{
+			using type = std::conditional_t<std::is_same_v<A, double> || std::is_same_v<B, double>, double, float>;
+		};
+
+		template <typename A, typename B> using Promoted = typename Promote<A, B>::type;
+
+
+		template <std::size_t... L, typename X, typename Y> void Narrow(const X &x, Y &y, std::index_sequence<L...>)
+		{
+			constexpr std::size_t RATIO = sizeof(Lane<X>) / sizeof(Lane<Y>);
+
+			typedef Lane<Y> B __attribute__((vector_size(sizeof(X))));
+
+			const B b = (B)x;
+			y = __builtin_shufflevector(b, b, (L * RATIO)...);
+		}
+
+
+		// Convert between vectors, or scalars, with the same number of elements. Conversions that are
+		// not vectorised by every compiler go through 16 or 32-bit integers, and integers are narrowed
+		// by keeping the low bytes of each element.
+		template <typename X, typename Y> void Cast(const X &x, Y &y)
+		{
+			using A = Lane<X>;
+			using B = Lane<Y>;
+			constexpr std::size_t N = Lanes<X>::count;
+
+			if constexpr (std::is_arithmetic_v<X>)
+			{
+				y = (Y)x;
+			}
+			else if constexpr (std::is_same_v<X, Y>)
+			{
+				y = x;
+			}
+			else if constexpr (std::is_integral_v<A> && sizeof(A) == 1 && sizeof(B) > 2)
+			{
+				typename Vector<std::conditional_t<std::is_signed_v<A>, int16_t, uint16_t>, N>::V h;
+				Cast(x, h);
+				Cast(h, y);
+			}
+			else if constexpr (std::is_integral_v<A> && sizeof(A) < 4 && std::is_floating_point_v<B>)
+			{
+				typename Vector<int32_t, N>::V i;
+				Cast(x, i);
+				Cast(i, y);
+			}
+			else if constexpr (std::is_floating_point_v<A> && std::is_integral_v<B> && sizeof(B) < 4)
+			{
+				typename Vector<int32_t, N>::V i;
+				Cast(x, i);
+				Cast(i, y);
+			}
+			else if constexpr (std::is_integral_v<A> && std::is_integral_v<B> && sizeof(B) < sizeof(A) && sizeof(A) <= 4)
+			{
+				Narrow(x, y, std::make_index_sequence<N> {});
+			}
+			else
+			{
+				y = __builtin_convertvector(x, Y);
+			}
+		}
+
+
+		// Broadcast a value to every element of X
+		template <typename X, typename S> void Fill(X &x, const S value)
+		{
+			x = X {} + (Lane<X>)value;
+		}
+
+
+		// The operations, each of which works on vectors and scalars alike
+		struct Add		{ template <typename X> static void Apply(const X &a, const X &b, X &r) { r = a + b; } };
+		struct Subtract	{ template <typename X> static void Apply(const X &a, const X &b, X &r) { r = a - b; } };
+		struct Multiply	{ template <typename X> static void Apply(const X &a, const X &b, X &r) { r = a * b; } };
+		struct Minimum	{ template <typename X> static void Apply(const X &a, const X &b, X &r) { r = b < a ? b : a; } };
+		struct Maximum	{ template <typename X> static void Apply(const X &a, const X &b, X &r) { r = a < b ? b : a; } };
+
+		// Integer division by zero results in 0 rather than trapping, and the one quotient that
+		// overflows (the lowest value divided by -1) wraps as negation does
+		struct Divide
+		{
+			template <typename X> static void Apply(const X &a, const X &b, X &r)
+			{
+				using L = Lane<X>;
+
+				if constexpr (std::is_integral_v<L>)
+				{
+					const X zero = {};
+					X one;
+					Fill(one, 1);
+
+					if constexpr (std::is_signed_v<L>)
+					{
+						using U = Like<std::make_unsigned_t<L>, X>;
+
+						X minus;
+						Fill(minus, -1);
+
+						const X d = b == zero || b == minus ? one : b;
+						const X n = (X)(U {} - (U)a);
+
+						r = b == zero ? zero : b == minus ? n : a / d;
+					}
+					else
+					{
+						const X d = b == zero ? one : b;
+						r = b == zero ? zero : a / d;
+					}
+				}
+				else
+				{
+					r = a / b;
+				}
+			}
+		};
+
+		struct Bitwise {};
+		struct And : Bitwise	{ template <typename X> static void Apply(const X &a, const X &b, X &r) { r = a & b; } };
+		struct Or : Bitwise		{ template <typename X> static void Apply(const X &a, const X &b, X &r) { r = a | b; } };
+		struct Xor : Bitwise	{ template <typename X> static void Apply(const X &a, const X &b, X &r) { r = a ^ b; } };
+
+		// Comparisons result in 255 where true and 0 otherwise
+		struct Compare
+		{
+			template <typename X> static void High(X &h) { Fill(h, 255); }
+		};
+
+		struct Less : Compare			{ template <typename X> static void Apply(const X &a, const X &b, X &r) { X h; High(h); r = a < b ? h : X {}; } };
+		struct LessEqual : Compare		{ template <typename X> static void Apply(const X &a, const X &b, X &r) { X h; High(h); r = a <= b ? h : X {}; } };
+		struct Greater : Compare		{ template <typename X> static void Apply(const X &a, const X &b, X &r) { X h; High(h); r = a > b ? h : X {}; } };
+		struct GreaterEqual : Compare	{ template <typename X> static void Apply(const X &a, const X &b, X &r) { X h; High(h); r = a >= b ? h : X {}; } };
+		struct Equal : Compare			{ template <typename X> static void Apply(const X &a, const X &b, X &r) { X h; High(h); r = a == b ? h : X {}; } };
+		struct NotEqual : Compare		{ template <typename X> static void Apply(const X &a, const X &b, X &r) { X h; High(h); r = a != b ? h : X {}; } };
+
+		struct Negate			{ template <typename X> static void Apply(const X &a, X &r) { r = -a; } };
+		struct Absolute			{ template <typename X> static void Apply(const X &a, X &r) { r = a < X {} ? -a : a; } };
+		struct Not : Bitwise	{ template <typename X> static void Apply(const X &a, X &r) { r = ~a; } };
+
+
+		// The extent of an expression with two operands, which must match where both involve images
+		inline Extent Combine(const Extent &a, const Extent &b)
+		{
+			if (a.depth && b.depth && !(a == b))
+			{
+				throw std::runtime_error("Images in an expression must have the same dimensions and depth");
+			}
+
+			Extent result		= a.depth ? a : b;
+			result.contiguous	= a.contiguous && b.contiguous;
+
+			return result;
+		}
+
+
+		// The element size shared by every image in an expression, 0 if there are none and SIZE_MAX
+		// if they differ
+		constexpr std::size_t Size(const std::size_t a, const std::size_t b)
+		{
+			return !a ? b : !b || a == b ? a : SIZE_MAX;
+		}
+	}
+
+
+	// An image within an expression
+	template <typename T> class Term : public Expression
+	{
+		public:
+
+			using type = T;
+
+			static constexpr std::size_t SIZE = sizeof(T);
+
+
+			explicit Term(const ImageView<const T> &image)
+				: data(image.Data()), row(image.Pitch() / sizeof(T)), extent { (std::size_t)image.Width(), (std::size_t)image.Height(), image.Depth(), image.Contiguous() } {}
+
+
+			image::Extent Extent() const { return this->extent; }
+
+
+			// Load the samples at element x of row y into X, which may be a vector or a scalar. When
+			// packed (P > 1) each 32-bit lane holds P samples and lane i is given sample k of the
+			// group at x + i * P, which extracts it with shifts rather than shuffles.
+			template <std::size_t P, typename X> void Load(const std::size_t y, const std::size_t x, X &result, const std::size_t k = 0) const
+			{
+				const T *data = this->data + y * this->row + x;
+
+				if constexpr (P > 1 && !std::is_arithmetic_v<X>)
+				{
+					static_assert(P * sizeof(T) == 4, "Packed samples must fill a 32-bit lane");
+
+					using I = internal::Vector<std::conditional_t<std::is_signed_v<T>, int32_t, uint32_t>, internal::Lanes<X>::count>;
+					constexpr int BITS = 8 * sizeof(T);
+
+					// Signed samples are sign extended by shifting them to the top of the lane first
+					const typename I::V w = *(const typename I::S *)data;
+					const typename I::V v = std::is_signed_v<T>
+						? (w << (int)(32 - BITS * (k + 1))) >> (32 - BITS)
+						: (w >> (int)(BITS * k)) & (typename I::V {} + ((1u << BITS) - 1));
+
+					internal::Cast(v, result);
+				}
+				else
+				{
+					using V = internal::Vector<T, internal::Lanes<X>::count>;
+
+					// Unaligned data must be copied rather than bound to a reference
+					const typename V::V p = *(const typename V::S *)data;
+					internal::Cast(p, result);
+				}
+			}
+
+		private:
+
+			const T *data;
+			std::size_t row;
+			image::Extent extent;
+	};
+
+
+	// A value within an expression. Floating point values do not promote an expression to double,
+	// but are converted directly to the type of the operation they take part in.
+	template <typename S> class Constant : public Expression
+	{
+		public:
+
+			using type = std::conditional_t<std::is_floating_point_v<S>, float, std::conditional_t<sizeof(S) <= 4, int, S>>;
+
+			static constexpr std::size_t SIZE = 0;
+
+
+			explicit Constant(const S value) : value(value) {}
+
+			image::Extent Extent() const { return {}; }
+
+			template <std::size_t P, typename X> void Load(const std::size_t, const std::size_t, X &result, const std::size_t = 0) const
+			{
+				internal::Fill(result, this->value);
+			}
+
+		private:
+
+			S value;
+	};
+
+
+	// An operation on a single operand
+	template <typename O, typename A> class Unary : public Expression
+	{
+		public:
+
+			using type = internal::Promoted<typename A::type, typename A::type>;
+
+			static constexpr std::size_t SIZE = A::SIZE;
+
+			static_assert(!std::is_base_of_v<internal::Bitwise, O> || std::is_integral_v<type>, "Bitwise operations require integral images");
+
+
+			explicit Unary(const A &a) : a(a) {}
+
+			image::Extent Extent() const { return this->a.Extent(); }
+
+			template <std::size_t P, typename X> void Load(const std::size_t y, const std::size_t x, X &result, const std::size_t k = 0) const
+			{
+				internal::Like<type, X> a, r;
+
+				this->a.template Load<P>(y, x, a, k);
+				O::Apply(a, r);
+				internal::Cast(r, result);
+			}
+
+		private:
+
+			A a;
+	};
+
+
+	// An operation on two operands
+	template <typename O, typename A, typename B> class Binary : public Expression
+	{
+		public:
+
+			using type = internal::Promoted<typename A::type, typename B::type>;
+
+			static constexpr std::size_t SIZE = internal::Size(A::SIZE, B::SIZE);
+
+			static_assert(!std::is_base_of_v<internal::Bitwise, O> || std::is_integral_v<type>, "Bitwise operations require integral images");
+
+
+			Binary(const A &a, const B &b) : a(a), b(b), extent(internal::Combine(a.Extent(), b.Extent())) {}
+
+			image::Extent Extent() const { return this->extent; }
+
+			template <std::size_t P, typename X> void Load(const std::size_t y, const std::size_t x, X &result, const std::size_t k = 0) const
+			{
+				internal::Like<type, X> a, b, r;
+
+				this->a.template Load<P>(y, x, a, k);
+				this->b.template Load<P>(y, x, b, k);
+				O::Apply(a, b, r);
+				internal::Cast(r, result);
+			}
+
+		private:
+
+			A a;
+			B b;
+			image::Extent extent;
+	};
+
+
+	// Chooses a where the condition is non-zero and b otherwise
+	template <typename C, typename A, typename B> class Select : public Expression
+	{
+		public:
+
+			using type = internal::Promoted<typename A::type, typename B::type>;
+
+			static constexpr std::size_t SIZE = internal::Size(C::SIZE, internal::Size(A::SIZE, B::SIZE));
+
+
+			Select(const C &c, const A &a, const B &b)
+				: c(c), a(a), b(b), extent(internal::Combine(c.Extent(), internal::Combine(a.Extent(), b.Extent()))) {}
+
+			image::Extent Extent() const { return this->extent; }
+
+			template <std::size_t P, typename X> void Load(const std::size_t y, const std::size_t x, X &result, const std::size_t k = 0) const
+			{
+				using M = std::conditional_t<sizeof(type) == 8, int64_t, std::conditional_t<sizeof(type) == 4, int32_t, int16_t>>;
+
+				internal::Like<typename C::type, X> c;
+				internal::Like<type, X> a, b, r;
+
+				this->c.template Load<P>(y, x, c, k);
+				this->a.template Load<P>(y, x, a, k);
+				this->b.template Load<P>(y, x, b, k);
+
+				if constexpr (std::is_arithmetic_v<X>)
+				{
+					r = c ? a : b;
+				}
+				else
+				{
+					// The mask must have elements of the same size as the values
+					const auto m = c != internal::Like<typename C::type, X> {};
+					internal::Like<M, X> mask;
+
+					internal::Cast(m, mask);
+					r = mask ? a : b;
+				}
+
+				internal::Cast(r, result);
+			}
+
+		private:
+
+			C c;
+			A a;
+			B b;
+			image::Extent extent;
+	};
+
+
+	namespace internal
+	{
+		// Convert an operand to an expression node
+		template <typename T> Term<T> Wrap(const ImageBase<T> &image)						{ return Term<T>(ImageView<const T>(image)); }
+		template <typename T> Term<std::remove_const_t<T>> Wrap(const ImageView<T> &image)	{ return Term<std::remove_const_t<T>>(image); }
+		template <typename E> requires IsExpression<E> const E &Wrap(const E &expression)	{ return expression; }
+
+		template <typename S> requires (std::is_arithmetic_v<S> && !std::is_same_v<S, bool>) Constant<S> Wrap(const S value)
+		{
+			return Constant<S>(value);
+		}
+
+		template <typename X> using Wrapped = std::decay_t<decltype(Wrap(std::declval<const X &>()))>;
+
+		template <typename X> concept Operand = requires (const X &x) { Wrap(x); };
+
+		// An operand other than a value, which ensures that the operators only apply to images
+		template <typename X> concept Varying = Operand<X> && !std::is_arithmetic_v<X>;
+
+		template <typename A, typename B> concept Operands = Operand<A> && Operand<B> && (Varying<A> || Varying<B>);
+
+
+		template <typename O, typename A> auto Make(const A &a)
+		{
+			return Unary<O, Wrapped<A>>(Wrap(a));
+		}
+
+		template <typename O, typename A, typename B> auto Make(const A &a, const B &b)
+		{
+			return Binary<O, Wrapped<A>, Wrapped<B>>(Wrap(a), Wrap(b));
+		}
+
+
+		// Evaluates an expression using vectors of W bytes. Each vector holds N samples since the
+		// intermediate values are usually 32-bit. Results are saturated to the range of T, where
+		// values beyond the largest R that converts to T are clamped to it since floating point
+		// cannot represent every integer limit.
+		//
+		// Widening 8 or 16-bit samples to 32-bit lanes, and narrowing them again, needs several
+		// shuffles per vector. When every image in the expression has the same element size as
+		// the destination the samples are packed instead: each block of N * P samples is loaded
+		// as N lanes of P samples that are extracted with shifts, evaluated P times and the
+		// results are packed back into lanes to be stored. Since the operations are element-wise
+		// the order of samples within a block does not matter.
+		template <std::size_t W, typename T, typename E> struct Evaluator
+		{
+			using R = typename E::type;
+			using X = typename Vector<R, W / 4>::V;
+
+			static constexpr std::size_t N = W / 4;
+
+			static constexpr bool SATURATE = std::is_integral_v<T>
+				&& (std::is_floating_point_v<R> || std::numeric_limits<R>::digits > std::numeric_limits<T>::digits || std::is_signed_v<R> != std::is_signed_v<T>);
+
+			static constexpr std::size_t P = std::is_integral_v<T> && sizeof(T) < 4 && E::SIZE == sizeof(T) ? 4 / sizeof(T) : 1;
+
+
+			// Evaluate elements [begin, end) of row y
+			static void Span(T *dst, const E &expression, const std::size_t y, const std::size_t begin, const std::size_t end)
+			{
+				// A local copy of the expression cannot be aliased by the stores, so the compiler is
+				// free to keep the operands in registers.
+				const E e		= expression;
+				const R low		= (R)std::numeric_limits<T>::lowest();
+				const R high	= High();
+
+				X l, h;
+				Fill(l, low);
+				Fill(h, high);
+
+				std::size_t x = begin;
+
+				if constexpr (P > 1)
+				{
+					using U = Vector<uint32_t, N>;
+					constexpr int BITS = 8 * sizeof(T);
+
+					for (; x + N * P <= end; x += N * P)
+					{
+						typename U::V packed = {};
+
+						// Unrolled so that every shift is by a constant
+						[&]<std::size_t... K>(std::index_sequence<K...>) {
+							([&] {
+								X v;
+								typename U::V u;
+
+								e.template Load<P>(y, x, v, K);
+								Saturate(v, l, h);
+								Cast(v, u);
+
+								packed |= (u & (typename U::V {} + ((1u << BITS) - 1))) << (int)(BITS * K);
+							}(), ...);
+						}(std::make_index_sequence<P> {});
+
+						*(typename U::S *)(dst + x) = packed;
+					}
+				}
+
+				for (; x + N <= end; x += N)
+				{
+					X v;
+					e.template Load<1>(y, x, v);
+					Store(v, l, h, dst + x);
+				}
+
+				for (; x < end; x++)
+				{
+					R v;
+					e.template Load<1>(y, x, v);
+					Store(v, low, high, dst + x);
+				}
+			}
+
+
+			template <typename Y> static void Saturate(Y &v, const Y &low, const Y &high)
+			{
+				if constexpr (SATURATE)
+				{
+					v = v < low ? low : v;
+					v = high < v ? high : v;
+				}
+			}
+
+
+			template <typename Y> static void Store(const Y &value, const Y &low, const Y &high, T *dst)
+			{
+				using P = Vector<T, Lanes<Y>::count>;
+
+				Y v = value;
+				Saturate(v, low, high);
+
+				typename P::V p;
+				Cast(v, p);
+				*(typename P::S *)dst = p;
+			}
+
+
+			static R High()
+			{
+				constexpr auto MAX = std::numeric_limits<T>::max();
+
+				if constexpr (std::is_floating_point_v<R> && std::is_integral_v<T>)
+				{
+					return (long double)(R)MAX > (long double)MAX ? std::nextafter((R)MAX, R {}) : (R)MAX;
+				}
+
+				return (R)MAX;
+			}
+		};
+	}
+
+
+	// Evaluate an expression into a view of the same dimensions and depth, returning false if they differ.
+	// The instruction set can be given so that each of them can be tested, otherwise the detected one is used.
+	template <typename T, typename E> requires IsExpression<E> bool Evaluate(const Policy &policy, const ImageView<T> &dst, const E &expression, const simd::Isa isa = simd::Detect())
+	{
+		static_assert(!std::is_const_v<T>, "Cannot evaluate into a read-only image view");
+
+		const auto &extent = expression.Extent();
+
+		if (!extent.depth || extent.width != (std::size_t)dst.Width() || extent.height != (std::size_t)dst.Height() || extent.depth != dst.Depth())
+		{
+			return false;
+		}
+
+		const std::size_t line	= extent.width * extent.depth;
+		const std::size_t row	= dst.Pitch() / sizeof(T);
+
+		// When everything is contiguous the whole image is treated as a single row
+		if (extent.contiguous && dst.Contiguous())
+		{
+			internal::Elements<T>(policy, line * extent.height, [&](const std::size_t begin, const std::size_t end) {
+				simd::Run(isa, [&](auto w) { internal::Evaluator<w, T, E>::Span(dst.Data(), expression, 0, begin, end); });
+			});
+		}
+		else
+		{
+			internal::Rows(policy, extent.height, line * sizeof(T), [&](const std::size_t begin, const std::size_t end) {
+				simd::Run(isa, [&](auto w) {
+					for (std::size_t y=begin; y<end; y++)
+					{
+						internal::Evaluator<w, T, E>::Span(dst.Data() + y * row, expression, y, 0, line);
+					}
+				});
+			});
+		}
+
+		return true;
+	}
+
+
+	template <typename T, typename E> requires IsExpression<E> bool Evaluate(const ImageView<T> &dst, const E &expression)
+	{
+		return Evaluate(seq, dst, expression);
+	}
+
+
+	template <typename A, typename B> requires internal::Operands<A, B> auto operator+(const A &a, const B &b)	{ return internal::Make<internal::Add>(a, b); }
+	template <typename A, typename B> requires internal::Operands<A, B> auto operator-(const A &a, const B &b)	{ return internal::Make<internal::Subtract>(a, b); }
+	template <typename A, typename B> requires internal::Operands<A, B> auto operator*(const A &a, const B &b)	{ return internal::Make<internal::Multiply>(a, b); }
+	template <typename A, typename B> requires internal::Operands<A, B> auto operator/(const A &a, const B &b)	{ return internal::Make<internal::Divide>(a, b); }
+	template <typename A, typename B> requires internal::Operands<A, B> auto operator&(const A &a, const B &b)	{ return internal::Make<internal::And>(a, b); }
+	template <typename A, typename B> requires internal::Operands<A, B> auto operator|(const A &a, const B &b)	{ return internal::Make<internal::Or>(a, b); }
+	template <typename A, typename B> requires internal::Operands<A, B> auto operator^(const A &a, const B &b)	{ return internal::Make<internal::Xor>(a, b); }
+
+	template <typename A, typename B> requires internal::Operands<A, B> auto operator<(const A &a, const B &b)	{ return internal::Make<internal::Less>(a, b); }
+	template <typename A, typename B> requires internal::Operands<A, B> auto operator<=(const A &a, const B &b)	{ return internal::Make<internal::LessEqual>(a, b); }
+	template <typename A, typename B> requires internal::Operands<A, B> auto operator>(const A &a, const B &b)	{ return internal::Make<internal::Greater>(a, b); }
+	template <typename A, typename B> requires internal::Operands<A, B> auto operator>=(const A &a, const B &b)	{ return internal::Make<internal::GreaterEqual>(a, b); }
+	template <typename A, typename B> requires internal::Operands<A, B> auto operator==(const A &a, const B &b)	{ return internal::Make<internal::Equal>(a, b); }
+	template <typename A, typename B> requires internal::Operands<A, B> auto operator!=(const A &a, const B &b)	{ return internal::Make<internal::NotEqual>(a, b); }
+
+	template <typename A> requires internal::Varying<A> auto operator-(const A &a)	{ return internal::Make<internal::Negate>(a); }
+	template <typename A> requires internal::Varying<A> auto operator~(const A &a)	{ return internal::Make<internal::Not>(a); }
+
+
+	template <typename A, typename B> requires internal::Operands<A, B> auto min(const A &a, const B &b)	{ return internal::Make<internal::Minimum>(a, b); }
+	template <typename A, typename B> requires internal::Operands<A, B> auto max(const A &a, const B &b)	{ return internal::Make<internal::Maximum>(a, b); }
+
+	template <typename A> requires internal::Varying<A> auto abs(const A &a)	{ return internal::Make<internal::Absolute>(a); }
+
+	template <typename A, typename L, typename U> requires internal::Varying<A> && internal::Operand<L> && internal::Operand<U> auto clamp(const A &a, const L &lower, const U &upper)
+	{
+		return min(max(a, lower), upper);
+	}
+
+	template <typename C, typename A, typename B> requires internal::Varying<C> && internal::Operand<A> && internal::Operand<B> auto select(const C &condition, const A &a, const B &b)
+	{
+		return Select<internal::Wrapped<C>, internal::Wrapped<A>, internal::Wrapped<B>>(internal::Wrap(condition), internal::Wrap(a), internal::Wrap(b));
+	}
+}
+
+
+namespace emergent
+{
+	// The operators must be found through the namespace of the images themselves
+	using image::operator+;
+	using image::operator-;
+	using image::operator*;
+	using image::operator/;
+	using image::operator&;
+	using image::operator|;
+	using image::operator^;
+	using image::operator<;
+	using image::operator<=;
+	using image::operator>;
+	using image::operator>=;
+	using image::operator==;
+	using image::operator!=;
+	using image::operator~;
+}
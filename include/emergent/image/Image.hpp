@@ -49,6 +49,14 @@ namespace emergent
 			}
 
 
+			/// Assignment override which evaluates an image expression, the images in it must be of the same depth.
+			template <typename E, typename = std::enable_if_t<image::IsExpression<E>>> Image<T, D> &operator=(const E &expression)
+			{
+				this->Assign(image::seq, expression);
+				return *this;
+			}
+
+
 			/// Prevent the depth from being changed for this derived type of image.
 			void Resize(const int width, const int height, const byte depth = 0) override
 			{
@@ -79,6 +87,21 @@ namespace emergent
 			}
 
 
+			/// Prevent the depth from being changed for this derived type of image.
+			bool Load(const image::Policy &policy, const std::string &path, const byte depth = 0)
+			{
+				if (depth && depth != D)
+				{
+					throw std::runtime_error(
+						"Attempting to load an Image<> as a different depth, "
+						"if this is intentional please consider using an ImageBase<> instead"
+					);
+				}
+
+				return ImageBase<T>::Load(policy, path);
+			}
+
+
 			/// Prevent the depth from being changed for this derived type of image.
 		#ifdef __cpp_lib_span
 			virtual bool Load(std::span<byte> buffer, const byte depth = 0)
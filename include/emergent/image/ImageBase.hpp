@@ -6,6 +6,12 @@
 #include <emergent/image/Iterator.hpp>
 #include <emergent/image/Buffer.hpp>
 #include <emergent/image/SubImage.hpp>
+#include <emergent/image/Simd.hpp>
+#include <emergent/image/Conversion.hpp>
+#include <emergent/image/Execution.hpp>
+#include <emergent/image/ImageView.hpp>
+#include <emergent/image/Raw.hpp>
+#include <emergent/image/Expression.hpp>
 #include <emergent/struct/Distribution.hpp>
 #include <emergent/struct/Bounds.hpp>
 #include <FreeImage.h>
@@ -13,6 +19,7 @@
 #include <cstring>
 #include <utility>
 #include <algorithm>
+#include <stop_token>
 
 #if __has_include(<span>)
 	#include <span>
@@ -22,7 +29,9 @@
 
 namespace emergent
 {
-	// A simple header used when storing a raw Image<> as a binary blob (for example, to file or Redis).
+	// A simple header used when storing a raw Image<> as a binary blob (for example, to Redis).
+	// Raw files used to start with this header but are now written as an image::RawHeader container,
+	// which is not limited to 65535 pixels in each dimension; files in the old form can still be loaded.
 	struct ImageHeader
 	{
 		byte depth;
@@ -50,9 +59,9 @@ namespace emergent
 
 				if (width > 0 && height > 0)
 				{
+					this->buffer.resize(Elements(width, height, depth));
 					this->width		= width;
 					this->height	= height;
-					this->buffer.resize(width * height * depth);
 				}
 			}
 
@@ -115,12 +124,53 @@ namespace emergent
 			}
 
 
+			/// Assignment override which evaluates an image expression (see image::Expression),
+			/// for example `dst = clamp(a * 0.5 + b - 10, 0, 255) > 128`.
+			template <typename E, typename = std::enable_if_t<image::IsExpression<E>>> ImageBase<T> &operator=(const E &expression)
+			{
+				return this->Assign(image::seq, expression);
+			}
+
+
+			// Evaluate an image expression in a single pass using the given execution policy. The image
+			// is resized to the dimensions and depth of the images in the expression, which may include
+			// this one.
+			template <typename E, typename = std::enable_if_t<image::IsExpression<E>>> ImageBase<T> &Assign(const image::Policy &policy, const E &expression)
+			{
+				const auto extent = expression.Extent();
+
+				this->Resize(extent.width, extent.height, extent.depth);
+				image::Evaluate(policy, this->View(), expression);
+
+				return *this;
+			}
+
+
 			// Copy from an existing image but ensure the required depth is established.
-			// Converts type and depth where necessary and returns itself
-			template <typename U> ImageBase<T> &From(const ImageBase<U> &image, const byte depth)
+			// Converts type and depth where necessary and returns itself. If the token is
+			// stopped part way through a conversion then the contents are incomplete.
+			template <typename U> ImageBase<T> &From(const ImageBase<U> &image, const byte depth, std::stop_token token = {})
+			{
+				return this->From(image, depth, image::Conversion {}, token);
+			}
+
+
+			// Copy from an existing image with an explicit conversion, which determines how the
+			// values are scaled and how RGB is converted to greyscale.
+			template <typename U> ImageBase<T> &From(const ImageBase<U> &image, const byte depth, const image::Conversion &conversion, std::stop_token token = {})
 			{
 				this->depth = depth;
-				this->Copy(image);
+				this->Copy(image, conversion, token);
+				return *this;
+			}
+
+
+			// Copy from an existing image using the given execution policy, which converts bands
+			// of rows in parallel. The token is checked at the start of each row.
+			template <typename U> ImageBase<T> &From(const image::Policy &policy, const ImageBase<U> &image, const byte depth, const image::Conversion &conversion = {}, std::stop_token token = {})
+			{
+				this->depth = depth;
+				this->Copy(image, conversion, token, policy);
 				return *this;
 			}
 
@@ -165,9 +215,9 @@ namespace emergent
 
 				if (width > 0 && height > 0)
 				{
+					this->buffer.resize(Elements(width, height, this->depth));
 					this->width		= width;
 					this->height	= height;
-					this->buffer.resize(width * height * this->depth);
 				}
 				else
 				{
@@ -181,102 +231,148 @@ namespace emergent
 			/// Returns the maximum value in the current image data (regardless of image depth).
 			T Max() const
 			{
-				return *std::max_element(this->cbegin(), this->cend());
+				return this->Max(image::seq);
+			}
+
+			/// Returns the maximum value in the current image data (regardless of image depth)
+			/// using the given execution policy.
+			T Max(const image::Policy &policy) const
+			{
+				return this->View().Max(policy);
 			}
 
 			/// Returns the minimum value in the current image data (regardless of image depth).
 			T Min() const
 			{
-				return *std::min_element(this->cbegin(), this->cend());
+				return this->Min(image::seq);
+			}
+
+			/// Returns the minimum value in the current image data (regardless of image depth)
+			/// using the given execution policy.
+			T Min(const image::Policy &policy) const
+			{
+				return this->View().Min(policy);
 			}
 
 			/// Count the number of values in the current image data (regardless of image depth)
 			/// that match the supplied predicate.
 			int Count(std::function<bool(T value)> predicate) const
 			{
-				return std::count_if(this->cbegin(), this->cend(), predicate);
+				return this->View().Count(predicate);
+			}
+
+			/// Count the number of values in the current image data (regardless of image depth)
+			/// that match the supplied predicate using the given execution policy. The predicate
+			/// may be invoked concurrently.
+			int Count(const image::Policy &policy, std::function<bool(T value)> predicate) const
+			{
+				return this->View().Count(policy, predicate);
 			}
 
 			/// Count the number of zero values in the current image data (regardless of image depth)
 			int ZeroCount() const
 			{
-				return std::count_if(this->cbegin(), this->cend(), std::logical_not<T> {});
+				return this->ZeroCount(image::seq);
+			}
+
+			/// Count the number of zero values in the current image data (regardless of image depth)
+			/// using the given execution policy.
+			int ZeroCount(const image::Policy &policy) const
+			{
+				return this->View().ZeroCount(policy);
 			}
 
 			/// Check if all the pixels in the image are set to the same value (regardless of image depth)
 			bool IsBlank(const T reference = 0) const
 			{
-				return std::all_of(
-					this->buffer.cbegin(), this->buffer.cend(),
-					[&](auto v) { return v == reference; }
-				);
+				return this->IsBlank(image::seq, reference);
+			}
+
+			/// Check if all the pixels in the image are set to the same value (regardless of image depth)
+			/// using the given execution policy.
+			bool IsBlank(const image::Policy &policy, const T reference = 0) const
+			{
+				return this->View().IsBlank(policy, reference);
 			}
 
 			/// Clamp the current image data (regardless of image depth) to the supplied
 			/// lower and upper limits.
 			void Clamp(T lower, T upper)
 			{
-				for (auto &d : this->buffer)
-				{
-					#if __cpp_lib_clamp >= 201603L
-						d = std::clamp(d, lower, upper);
-					#else
-						d = d < lower ? lower : (d > upper ? upper : d);
-					#endif
-				}
+				this->Clamp(image::seq, lower, upper);
+			}
+
+			/// Clamp the current image data (regardless of image depth) to the supplied
+			/// lower and upper limits using the given execution policy.
+			void Clamp(const image::Policy &policy, T lower, T upper)
+			{
+				this->View().Clamp(policy, lower, upper);
 			}
 
 			/// Shift all of the values in the image data (regardless of image depth) by the
-			/// specified amount.
+			/// specified amount, saturating at the limits of the type.
 			void Shift(int value)
 			{
-				for (auto &d : this->buffer)
-				{
-					d = Maths::clamp<T>(d + value);
-				}
+				this->Shift(image::seq, value);
+			}
+
+			/// Shift all of the values in the image data (regardless of image depth) by the
+			/// specified amount, saturating at the limits of the type, using the given execution policy.
+			void Shift(const image::Policy &policy, int value)
+			{
+				this->View().Shift(policy, value);
 			}
 
 			/// Threshold this image at the given value
 			void Threshold(T threshold, T high = 255, T low = 0)
 			{
-				for (auto &d : this->buffer)
-				{
-					d = d < threshold ? low : high;
-				}
+				this->Threshold(image::seq, threshold, high, low);
+			}
+
+			/// Threshold this image at the given value using the given execution policy
+			void Threshold(const image::Policy &policy, T threshold, T high = 255, T low = 0)
+			{
+				this->View().Threshold(policy, threshold, high, low);
 			}
 
 			/// Inverts this image
 			void Invert()
 			{
-				std::transform(this->cbegin(), this->cend(), this->begin(), std::bit_not<T> {});
+				this->Invert(image::seq);
 			}
 
+			/// Inverts this image using the given execution policy
+			void Invert(const image::Policy &policy)
+			{
+				this->View().Invert(policy);
+			}
 
-			/// Arimetic OR of this image with a modifier image. The images should be of the
-			/// same size and if not then it will return false.
-			bool OR(const ImageBase<T> &modifier)
+
+			/// Arimetic OR of this image with a modifier image, or view. They should have the
+			/// same dimensions and if not then it will return false.
+			bool OR(const ImageView<const T> &modifier)
 			{
-				if (modifier.buffer.size() != this->buffer.size())
-				{
-					return false;
-				}
+				return this->OR(image::seq, modifier);
+			}
 
-				std::transform(this->cbegin(), this->cend(), modifier.cbegin(), this->begin(), std::bit_or<T> {});
-				return true;
+			/// Arimetic OR of this image with a modifier image using the given execution policy.
+			bool OR(const image::Policy &policy, const ImageView<const T> &modifier)
+			{
+				return this->View().OR(policy, modifier);
 			}
 
 
-			/// Arimetic AND of this image with a modifier image. The images should be of the
-			/// same size and if not then it will return false.
-			bool AND(const ImageBase<T> &modifier)
+			/// Arimetic AND of this image with a modifier image, or view. They should have the
+			/// same dimensions and if not then it will return false.
+			bool AND(const ImageView<const T> &modifier)
 			{
-				if (modifier.buffer.size() != this->buffer.size())
-				{
-					return false;
-				}
+				return this->AND(image::seq, modifier);
+			}
 
-				std::transform(this->cbegin(), this->cend(), modifier.cbegin(), this->begin(), std::bit_and<T> {});
-				return true;
+			/// Arimetic AND of this image with a modifier image using the given execution policy.
+			bool AND(const image::Policy &policy, const ImageView<const T> &modifier)
+			{
+				return this->View().AND(policy, modifier);
 			}
 
 
@@ -301,10 +397,43 @@ namespace emergent
 
 			/// Calculate the distribution statistics of the image mask can be optionally passed in;
 			/// zero values in the mask tell distribution to ignore the corresponding pixels in the image.
+			/// Without a mask the vectorised statistics of the view are used.
 			// distribution Stats(Buffer<byte> *mask = nullptr) const
 			distribution Stats(std::vector<byte> *mask = nullptr) const
 			{
-				return distribution(this->buffer, mask);
+				return mask ? distribution(this->buffer, mask) : this->View().Stats();
+			}
+
+
+			/// Calculate the distribution statistics of the image using the given execution policy. The
+			/// stats of each band are merged which may differ from the serial result by rounding error.
+			distribution Stats(const image::Policy &policy) const
+			{
+				return this->View().Stats(policy);
+			}
+
+
+			/// Calculate the distribution statistics of the pixels selected by a bit-packed mask of the
+			/// same dimensions, the result is empty if the dimensions differ.
+			distribution Stats(const image::Policy &policy, const image::MaskView &mask) const
+			{
+				return this->View().Stats(policy, mask);
+			}
+
+
+			/// Calculate the distribution statistics of each channel, for example to control the
+			/// exposure and white balance of a camera from the same pass over a frame.
+			std::vector<distribution> ChannelStats(const image::Policy &policy = image::seq) const
+			{
+				return this->View().ChannelStats(policy);
+			}
+
+
+			/// Calculate the distribution statistics of each channel of the pixels selected by a
+			/// bit-packed mask of the same dimensions, the results are empty if the dimensions differ.
+			std::vector<distribution> ChannelStats(const image::Policy &policy, const image::MaskView &mask) const
+			{
+				return this->View().ChannelStats(policy, mask);
 			}
 
 
@@ -328,7 +457,7 @@ namespace emergent
 			// will test as false.
 			const image::SubImage<const T> SubImage(const int rx, const int ry, const int rw, const int rh) const
 			{
-				if (rx < 0 || rx+rw > this->width || ry < 0 || ry+rh > this->height || rw < 0 || rh < 0)
+				if (rx < 0 || ry < 0 || rw < 0 || rh < 0 || (size_t)rx + rw > this->width || (size_t)ry + rh > this->height)
 				{
 					return {};
 				}
@@ -339,29 +468,46 @@ namespace emergent
 					return {
 						.data	= this->buffer.data() + ry * row + rx * this->depth,
 						.depth	= this->depth,
-						.width	= rw,
-						.height	= rh,
+						.width	= (size_t)rw,
+						.height	= (size_t)rh,
 						.row	= row
 					};
 				#else
 					return {
 						this->buffer.data() + ry * row + rx * this->depth,
 						this->depth,
-						rw,
-						rh,
+						(size_t)rw,
+						(size_t)rh,
 						row
 					};
 				#endif
 			}
 
 
+			/// A view of this image which can be passed to anything that accepts an ImageView. It is
+			/// invalidated if this image is resized, reloaded or assigned to.
+			ImageView<T> View()
+			{
+				return { this->buffer.data(), (int)this->width, (int)this->height, this->depth };
+			}
+
+			/// A read-only view of this image. It is invalidated if this image is resized, reloaded
+			/// or assigned to.
+			ImageView<const T> View() const
+			{
+				return { this->buffer.data(), (int)this->width, (int)this->height, this->depth };
+			}
+
+
 			// Apply an operation to inspect a given region of the image. The region must be fully
 			// contained within the image and if it is invalid then `operation` will not be invoked.
-			void Inspect(const int rx, const int ry, const int rw, const int rh, std::function<void(const T*)> operation) const
+			// The token is checked at the start of each row so that an inspection that is no longer
+			// required can stop part way through.
+			void Inspect(const int rx, const int ry, const int rw, const int rh, std::function<void(const T*)> operation, std::stop_token token = {}) const
 			{
 				if (const auto sub = this->SubImage(rx, ry, rw, rh))
 				{
-					for (size_t y=0; y<sub.height; y++)
+					for (size_t y=0; y<sub.height && !token.stop_requested(); y++)
 					{
 						for (auto p : sub.Row(y))
 						{
@@ -394,27 +540,36 @@ namespace emergent
 			/// supported unless sum is false and the depths are the same.
 			ImageBase<T> &Insert(const ImageBase<T> &image, const int x, const int y, const bool sum = false)
 			{
-				if (x >= 0 && x < this->width && y >= 0 && y < this->height)
+				return this->Insert(image::seq, image, x, y, sum);
+			}
+
+
+			/// Add the values from another image to this one at the given offset using the given
+			/// execution policy, which splits the inserted region into bands of rows.
+			ImageBase<T> &Insert(const image::Policy &policy, const ImageBase<T> &image, const int x, const int y, const bool sum = false)
+			{
+				if (x >= 0 && (size_t)x < this->width && y >= 0 && (size_t)y < this->height)
 				{
-					int i, j;
 					const int ds	= this->depth;
 					const int di	= image.depth;
 					const int ls	= this->width * ds;
 					const int li	= image.width * di;
-					const int w		= std::min(image.width, this->width - x);
-					const int h		= std::min(image.height, this->height - y);
-					const T *pi 	= image;
-					T *ps 			= this->buffer.data() + y * ls + x * ds;
+					const int w		= std::min<int>(image.width, this->width - x);
+					const int h		= std::min<int>(image.height, this->height - y);
+					const T *src 	= image;
+					T *dst 			= this->buffer.data() + y * ls + x * ds;
 
 					if (ds == di && !sum)
 					{
 						// Faster option for images of equal depth when not summing
-						int line = w * ds * sizeof(T);
+						const int line = w * ds * sizeof(T);
 
-						for (j=0; j<h; j++, pi+=li, ps+=ls)
-						{
-							memcpy(ps, pi, line);
-						}
+						image::internal::Rows(policy, h, line, [&](const size_t begin, const size_t end) {
+							for (size_t j=begin; j<end; j++)
+							{
+								memcpy(dst + j * ls, src + j * li, line);
+							}
+						});
 					}
 					else
 					{
@@ -435,16 +590,18 @@ namespace emergent
 
 						if (convert)
 						{
-							const int js = ls - w * ds;
-							const int ji = li - w * di;
-
-							for (j=0; j<h; j++, pi+=ji, ps+=js)
-							{
-								for (i=0; i<w; i++, ps+=ds, pi+=di)
+							image::internal::Rows(policy, h, w * ds * sizeof(T), [&](const size_t begin, const size_t end) {
+								for (size_t j=begin; j<end; j++)
 								{
-									convert(pi, ps);
+									const T *pi	= src + j * li;
+									T *ps		= dst + j * ls;
+
+									for (int i=0; i<w; i++, ps+=ds, pi+=di)
+									{
+										convert(pi, ps);
+									}
 								}
-							}
+							});
 						}
 					}
 				}
@@ -548,6 +705,14 @@ namespace emergent
 			/// depth of this image will be left as it is, otherwise it will attempt to convert to the
 			/// required depth where necessary.
 			virtual bool Load(const std::string &path, const byte depth = 0)
+			{
+				return this->Load(image::seq, path, depth);
+			}
+
+
+			/// Load an image from file using the given execution policy for the conversion of the
+			/// decoded pixels into this image.
+			bool Load(const image::Policy &policy, const std::string &path, const byte depth = 0)
 			{
 				bool result = false;
 				auto fif	= FreeImage_GetFileType(path.c_str(), 0);
@@ -560,7 +725,7 @@ namespace emergent
 
 					if (image)
 					{
-						result = this->FromFib(image, depth);
+						result = this->FromFib(image, depth, policy);
 						FreeImage_Unload(image);
 					}
 				}
@@ -602,7 +767,9 @@ namespace emergent
 			}
 
 
-			/// Load a raw image file, expects ImageHeader to be at the beginning
+			/// Load a raw image file, either a raw container (see image::RawHeader) or the older
+			/// form that starts with an ImageHeader. To use a large raw file without copying it into
+			/// an image, map it with image::RawFile instead.
 			virtual bool LoadRaw(const std::string &path)
 			{
 				return this->LoadRaw(path, false);
@@ -613,12 +780,20 @@ namespace emergent
 			/// out the image (converts it to byte first but does not scale the values,
 			/// so be warned). Image format is automatically determined by file extension.
 			bool Save(const std::string &path, int compression = 0) const
+			{
+				return this->Save(image::seq, path, compression);
+			}
+
+
+			/// Save an image to file using the given execution policy for the conversion of
+			/// this image into the pixel format of the encoder.
+			bool Save(const image::Policy &policy, const std::string &path, int compression = 0) const
 			{
 				bool result = false;
 
 				if (this->Size())
 				{
-					auto *image = this->ToFib();
+					auto *image = this->ToFib(policy);
 
 					if (image)
 					{
@@ -646,6 +821,14 @@ namespace emergent
 
 			/// Save image to a memory buffer.
 			bool Save(std::vector<byte> &buffer, const int compression) const
+			{
+				return this->Save(image::seq, buffer, compression);
+			}
+
+
+			/// Save image to a memory buffer using the given execution policy for the conversion
+			/// of this image into the pixel format of the encoder.
+			bool Save(const image::Policy &policy, std::vector<byte> &buffer, const int compression) const
 			{
 				bool result = false;
 
@@ -654,7 +837,7 @@ namespace emergent
 					DWORD size;
 					byte *data;
 					auto *mem 	= FreeImage_OpenMemory();
-					auto *image = this->ToFib();
+					auto *image = this->ToFib(policy);
 
 					if (image)
 					{
@@ -687,26 +870,11 @@ namespace emergent
 			}
 
 
-			/// Save a raw image file starting with ImageHeader
-			bool SaveRaw(const std::string &path) const
+			/// Save a raw image file as a raw container (see image::RawHeader), which can be loaded
+			/// with LoadRaw or mapped with image::RawFile.
+			bool SaveRaw(const std::string &path, const image::RawOptions &options = {}) const
 			{
-				if (this->Size())
-				{
-					std::ofstream ofs(path, std::ios::out | std::ios::binary);
-
-					if (ofs.good())
-					{
-						ImageHeader header = { this->depth, sizeof(T), (uint16_t)this->width, (uint16_t)this->height };
-
-						ofs.write((char *)&header, sizeof(ImageHeader));
-						ofs.write((char *)this->Data(), this->width * this->height * this->depth * sizeof(T));
-						ofs.flush();
-
-						return true;
-					}
-				}
-
-				return false;
+				return this->Size() && image::Raw::Save(this->View(), path, options);
 			}
 
 
@@ -714,7 +882,7 @@ namespace emergent
 			// and provide a pointer to the current position which gives access to all channels.
 			image::Iterator<T> Row(const int y)
 			{
-				return y >= 0 && y < this->height
+				return y >= 0 && (size_t)y < this->height
 					? image::Iterator<T>(this->buffer.data() + y * this->width * this->depth, this->width, this->depth)
 					: image::Iterator<T>();
 			}
@@ -723,7 +891,7 @@ namespace emergent
 			// and provide a pointer to the current position which gives access to all channels.
 			image::Iterator<const T> Row(const int y) const
 			{
-				return y >= 0 && y < this->height
+				return y >= 0 && (size_t)y < this->height
 					? image::Iterator<const T>(this->buffer.data() + y * this->width * this->depth, this->width, this->depth)
 					: image::Iterator<const T>();
 			}
@@ -774,32 +942,37 @@ namespace emergent
 		protected:
 
 
-			template <typename U = T> typename std::enable_if<std::is_same<byte, U>::value, FIBITMAP *>::type ToFib() const
+			template <typename U = T> typename std::enable_if<std::is_same<byte, U>::value, FIBITMAP *>::type ToFib(const image::Policy &policy = image::seq) const
 			{
 				auto *result = FreeImage_ConvertFromRawBits(const_cast<T*>(this->buffer.data()), this->width, this->height, this->width * this->depth, this->depth * 8, 0, 0, 0, true);
 
 				#if FREEIMAGE_COLORORDER == FREEIMAGE_COLORORDER_BGR
 					if (result && this->depth == 3)
 					{
-						int x, y;
-						byte *data	= FreeImage_GetBits(result);
-						int jump	= FreeImage_GetPitch(result) - this->width * this->depth;
+						byte *bits			= FreeImage_GetBits(result);
+						const size_t pitch	= FreeImage_GetPitch(result);
 
-						for (y=0; y<this->height; y++, data += jump)
-						{
-							for (x=0; x<this->width; x++, data += this->depth)
+						image::internal::Rows(policy, this->height, pitch, [&](const size_t begin, const size_t end) {
+							for (size_t y=begin; y<end; y++)
 							{
-								std::swap(data[0], data[2]);
+								byte *data = bits + y * pitch;
+
+								for (size_t x=0; x<this->width; x++, data += this->depth)
+								{
+									std::swap(data[0], data[2]);
+								}
 							}
-						}
+						});
 					}
+				#else
+					(void)policy;
 				#endif
 
 				return result;
 			}
 
 
-			template <typename U = T> typename std::enable_if<!std::is_same<byte, U>::value, FIBITMAP *>::type ToFib() const
+			template <typename U = T> typename std::enable_if<!std::is_same<byte, U>::value, FIBITMAP *>::type ToFib(const image::Policy &policy = image::seq) const
 			{
 				FIBITMAP *result							= nullptr;
 				std::function<int(const T *src, byte *dst)> apply	= nullptr;
@@ -849,19 +1022,21 @@ namespace emergent
 
 				if (result)
 				{
-					int x, y;
-					auto *b = this->buffer.data();
+					const size_t line = this->width * this->depth;
 
-					for (y=0; y<height; y++)
-					{
-						auto bits = FreeImage_GetScanLine(result, height - y - 1);
-
-						for (x=0; x<width; x++)
+					image::internal::Rows(policy, this->height, line * sizeof(T), [&](const size_t begin, const size_t end) {
+						for (size_t y=begin; y<end; y++)
 						{
-							bits	+= apply(b, bits);
-							b		+= this->depth;
+							auto bits	= FreeImage_GetScanLine(result, height - y - 1);
+							auto *b		= this->buffer.data() + y * line;
+
+							for (size_t x=0; x<width; x++)
+							{
+								bits	+= apply(b, bits);
+								b		+= this->depth;
+							}
 						}
-					}
+					});
 				}
 
 				return result;
@@ -869,7 +1044,7 @@ namespace emergent
 
 
 
-			template <typename U = T> typename std::enable_if<std::is_same<byte, U>::value, bool>::type FromFib(FIBITMAP *image, const byte depth)
+			template <typename U = T> typename std::enable_if<std::is_same<byte, U>::value, bool>::type FromFib(FIBITMAP *image, const byte depth, const image::Policy &policy = image::seq)
 			{
 				this->width 	= FreeImage_GetWidth(image);
 				this->height	= FreeImage_GetHeight(image);
@@ -881,18 +1056,25 @@ namespace emergent
 				#if FREEIMAGE_COLORORDER == FREEIMAGE_COLORORDER_BGR
 					if (this->depth == 3)
 					{
-						for (auto p : this->Pixels())
-						{
-							std::swap(p[0], p[2]);
-						}
+						image::internal::Rows(policy, this->height, this->width * 3, [&](const size_t begin, const size_t end) {
+							for (size_t y=begin; y<end; y++)
+							{
+								for (auto p : this->Row(y))
+								{
+									std::swap(p[0], p[2]);
+								}
+							}
+						});
 					}
+				#else
+					(void)policy;
 				#endif
 
 				return true;
 			}
 
 
-			template <typename U = T> typename std::enable_if<!std::is_same<byte, U>::value, bool>::type FromFib(FIBITMAP *image, const byte depth)
+			template <typename U = T> typename std::enable_if<!std::is_same<byte, U>::value, bool>::type FromFib(FIBITMAP *image, const byte depth, const image::Policy &policy = image::seq)
 			{
 				FIBITMAP *converted							= nullptr;
 				std::function<int(byte *src, T *dst)> apply = nullptr;
@@ -947,18 +1129,21 @@ namespace emergent
 
 				if (converted)
 				{
-					T *b = this->buffer.data();
+					const size_t line = this->width * this->depth;
 
-					for (size_t y=0; y<height; y++)
-					{
-						auto bits = FreeImage_GetScanLine(converted, height - y - 1);
-
-						for (size_t x=0; x<width; x++)
+					image::internal::Rows(policy, this->height, line * sizeof(T), [&](const size_t begin, const size_t end) {
+						for (size_t y=begin; y<end; y++)
 						{
-							bits	+= apply(bits, b);
-							b		+= this->depth;
+							auto bits	= FreeImage_GetScanLine(converted, height - y - 1);
+							T *b		= this->buffer.data() + y * line;
+
+							for (size_t x=0; x<width; x++)
+							{
+								bits	+= apply(bits, b);
+								b		+= this->depth;
+							}
 						}
-					}
+					});
 
 					FreeImage_Unload(converted);
 
@@ -971,102 +1156,106 @@ namespace emergent
 
 			/// A copy function that also attempts to do type conversion. For example, when going from an RGB int
 			/// image to a greyscale byte image it will first convert from int to byte by normalising the values
-			/// and scaling to byte (if necessary). Then it will convert from RGB to greyscale. If the source image
-			/// is the same type as this then it should be pretty fast since it is a simple buffer copy instead.
-			template <typename U> void Copy(const ImageBase<U> &image)
+			/// and scaling to byte (if necessary). Then it will convert from RGB to greyscale. The conversion
+			/// determines how values are scaled and the weights used for greyscale, by default the range of the
+			/// source is found and it is only rescaled if it will not fit. Common types use vectorised kernels.
+			/// The token is checked at the start of each row, if a stop is requested then the copy is abandoned
+			/// and the contents of this image are incomplete.
+			template <typename U> void Copy(const ImageBase<U> &image, const image::Conversion &conversion = {}, std::stop_token token = {}, const image::Policy &policy = image::seq)
 			{
-				const T max			= std::numeric_limits<T>::max();
-				this->width			= image.width;
-				this->height		= image.height;
-				const size_t size	= this->width * this->height;
-				// auto r			= image.buffer.Range();
+				this->width		= image.width;
+				this->height	= image.height;
+				this->buffer.resize(this->width * this->height * this->depth);
 
-				// once we no longer require c++14 support
-				// const auto [low, high]	= std::minmax_element(image.buffer.begin(), image.buffer.end());
-				// const auto r			= emg::bounds<U>(*low, *high);
-				const auto minmax	= std::minmax_element(image.buffer.begin(), image.buffer.end());
-				const auto r		= emg::bounds<U>(*minmax.first, *minmax.second);
+				this->Convert(image, image::Map<T>(conversion, image.Data(), image.buffer.size()), conversion.luma, token, policy);
+			}
 
-				this->buffer.resize(size * this->depth);
 
-				auto *src = image.Data();
-				auto *dst = this->buffer.data();
+			/// If the image to be copied is of the same type and depth as this one then simply copy the buffer, otherwise
+			/// convert appropriately (supports grey to RGB and vice versa). Only a known range in the conversion will
+			/// rescale the values. The token is only checked when converting.
+			void Copy(const ImageBase<T> &image, const image::Conversion &conversion = {}, std::stop_token token = {}, const image::Policy &policy = image::seq)
+			{
+				// Every value already fits, so automatic scaling does not need to find the range of the source
+				const auto mapping = conversion.scaling == image::Scaling::Automatic
+					? image::Mapping {}
+					: image::Map<T>(conversion, image.Data(), image.buffer.size());
 
-				std::function<T(U value)> apply = nullptr;
-				if (r.range > max)		apply = [&](U value) { return (T)lrint(max * r.normalise(value)); };
-				else if (r.max > max)	apply = [&](U value) { return (T)(value - r.min); };
-				else					apply = [&](U value) { return (T)value; };
+				this->width		= image.width;
+				this->height	= image.height;
 
-				if (this->depth == image.depth)
+				if (this->depth != image.depth || !mapping.Identity())
 				{
-					const size_t total = size * this->depth;
-					for (size_t i=0; i<total; i++)
-					{
-						*dst++ = apply(*src++);
-					}
+					this->buffer.resize(this->width * this->height * this->depth);
+					this->Convert(image, mapping, conversion.luma, token, policy);
 				}
-				else if (this->depth == 1 && image.depth == 3)
+				else if (policy.parallel)
 				{
-					for (size_t i=0; i<size; i++, src+=3)
-					{
-						*dst++ = (apply(src[0]) + apply(src[1]) + apply(src[2])) / 3;
-					}
+					this->buffer.resize(image.buffer.size());
+
+					image::internal::Elements<T>(policy, this->buffer.size(), [&](const size_t begin, const size_t end) {
+						std::copy(image.buffer.data() + begin, image.buffer.data() + end, this->buffer.data() + begin);
+					});
 				}
-				else if (this->depth == 3 && image.depth == 1)
+				else
 				{
-					T value;
-					for (size_t i=0; i<size; i++)
+					this->buffer = image.buffer;
+				}
+			}
+
+
+			// Convert each row of an image with the same dimensions into this one, the token is
+			// checked at the start of each row.
+			template <typename U> void Convert(const ImageBase<U> &image, const image::Mapping &mapping, const image::Weights &luma, std::stop_token token, const image::Policy &policy)
+			{
+				const size_t ls	= this->width * this->depth;
+				const size_t li	= this->width * image.depth;
+
+				image::internal::Rows(policy, this->height, std::max(ls * sizeof(T), li * sizeof(U)), [&](const size_t begin, const size_t end) {
+					for (size_t y=begin; y<end && !token.stop_requested(); y++)
 					{
-						value = apply(*src++);
-						*dst++ = value;
-						*dst++ = value;
-						*dst++ = value;
+						image::Convert(this->buffer.data() + y * ls, image.Data() + y * li, this->width, image.depth, this->depth, mapping, luma);
 					}
-
-				}
+				});
 			}
 
 
-			/// If the image to be copied is of the same type and depth as this one then simply copy the buffer, otherwise
-			/// convert appropriately (supports grey to RGB and vice versa).
-			void Copy(const ImageBase<T> &image)
+			/// Load a raw image file, either a raw container or the older form that starts with an ImageHeader
+			bool LoadRaw(std::string path, bool checkDepth)
 			{
-				this->width		= image.width;
-				this->height	= image.height;
+				image::RawFile file(path);
 
-				if (this->depth != image.depth)
+				if (file)
 				{
-					const size_t size = this->width * this->height;
-					this->buffer.resize(size * this->depth);
-
-					const T *src	= image;
-					T *dst			= this->buffer.data();
+					const auto &h = file.Header();
 
-					if (this->depth == 1 && image.depth == 3)
+					if (checkDepth && h.depth != this->depth)
 					{
-						for (size_t i=0; i<size; i++, src+=3)
-						{
-							*dst++ = (src[0] + src[1] + src[2]) / 3;
-						}
+						throw std::runtime_error(
+							"Attempting to load an Image<> from raw as a different depth, "
+							"if this is intentional please consider using an ImageBase<> instead"
+						);
 					}
-					else if (this->depth == 3 && image.depth == 1)
+
+					auto src = file.View<const T>();
+
+					if (src && file.Verify())
 					{
-						for (size_t i=0; i<size; i++, src++, dst+=3)
+						const size_t line = src.Width() * src.Depth();
+
+						this->Resize(src.Width(), src.Height(), src.Depth());
+
+						for (int y=0; y<src.Height(); y++)
 						{
-							dst[0] = dst[1] = dst[2] = src[0];
+							std::memcpy(this->buffer.data() + y * line, src.Row(y).data, line * sizeof(T));
 						}
+
+						return true;
 					}
-				}
-				else
-				{
-					this->buffer = image.buffer;
-				}
-			}
 
+					return false;
+				}
 
-			/// Load a raw image file, expects ImageHeader to be at the beginning
-			bool LoadRaw(std::string path, bool checkDepth)
-			{
 				ImageHeader h;
 				std::ifstream ifs(path, std::ios::in | std::ios::binary);
 
@@ -1087,12 +1276,12 @@ namespace emergent
 							);
 						}
 
-						int length = h.width * h.height * h.depth * sizeof(T);
+						const size_t length = (size_t)h.width * h.height * h.depth * sizeof(T);
 
-						if (h.typesize == sizeof(T) && size == sizeof(ImageHeader) + length)
+						if (h.typesize == sizeof(T) && (size_t)size == sizeof(ImageHeader) + length)
 						{
 							this->Resize(h.width, h.height, h.depth);
-							ifs.read((char *)this->Data(), size);
+							ifs.read((char *)this->Data(), length);
 
 							return true;
 						}
@@ -1103,6 +1292,20 @@ namespace emergent
 			}
 
 
+			// The number of elements in an image of the given dimensions, throws if it cannot be addressed
+			static size_t Elements(const int width, const int height, const byte depth)
+			{
+				const size_t pixels = (size_t)width * height;
+
+				if (pixels > SIZE_MAX / sizeof(T) / std::max<size_t>(depth, 1))
+				{
+					throw std::runtime_error("Image dimensions are too large");
+				}
+
+				return pixels * depth;
+			}
+
+
 			// Image depth
 			byte depth = 1;
 
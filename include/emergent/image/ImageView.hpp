@@ -0,0 +1,549 @@
+#pragma once
+
+#include <emergent/Emergent.hpp>
+#include <emergent/Maths.hpp>
+#include <emergent/image/Iterator.hpp>
+#include <emergent/image/SubImage.hpp>
+#include <emergent/image/Simd.hpp>
+#include <emergent/image/Execution.hpp>
+#include <emergent/image/Mask.hpp>
+#include <emergent/image/Statistics.hpp>
+#include <emergent/struct/Distribution.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+
+namespace emergent
+{
+	template <typename T> class ImageBase;
+
+
+	/// A non-owning view of an image in memory that belongs to something else, such as the frame
+	/// buffer of a camera SDK, a memory mapped file or a shared memory segment. Rows may be padded,
+	/// the pitch being the distance in bytes from the start of one row to the next. A view of a
+	/// const type is read-only.
+	///
+	/// The memory must outlive the view. A view of an ImageBase is invalidated if that image is
+	/// resized, reloaded or assigned to.
+	///
+	///    ImageView<byte> frame(sdk.Buffer(), 1920, 1080, 3, sdk.Pitch());
+	///    frame.Threshold(image::par, 128);
+	template <typename T> class ImageView
+	{
+		using V = std::remove_const_t<T>;
+
+		static_assert(std::is_arithmetic<V>::value, "Image type must be numeric");
+
+		public:
+
+			ImageView() = default;
+
+
+			/// Wrap the given memory. A pitch of 0 means that the rows are not padded, otherwise it must
+			/// hold a whole row and be a multiple of the type size.
+			ImageView(T *data, const int width, const int height, const byte depth = 1, const size_t pitch = 0)
+				: data(data), depth(depth), width(std::max(width, 0)), height(std::max(height, 0))
+			{
+				if (!depth)
+				{
+					throw std::runtime_error("Image depth must be greater than zero");
+				}
+
+				if (pitch && (pitch % sizeof(T) || pitch < this->width * depth * sizeof(T)))
+				{
+					throw std::runtime_error("Image view pitch must be a multiple of the type size and hold a whole row");
+				}
+
+				this->row = pitch ? pitch / sizeof(T) : this->width * depth;
+			}
+
+
+			/// A view of an entire image
+			ImageView(ImageBase<V> &image) : ImageView(image.Data(), image.Width(), image.Height(), image.Depth()) {}
+
+
+			/// A read-only view of an entire image
+			template <typename U = T, typename = std::enable_if_t<std::is_const_v<U>>> ImageView(const ImageBase<V> &image)
+				: ImageView(image.Data(), image.Width(), image.Height(), image.Depth()) {}
+
+
+			/// A view of the region described by a sub-image
+			ImageView(const image::SubImage<T> &image)
+				: ImageView(image.data, (int)image.width, (int)image.height, image.depth, image.row * sizeof(T)) {}
+
+
+			/// A read-only view of the region described by a writable sub-image
+			template <typename U = T, typename = std::enable_if_t<std::is_const_v<U>>> ImageView(const image::SubImage<V> &image)
+				: ImageView(image.data, (int)image.width, (int)image.height, image.depth, image.row * sizeof(T)) {}
+
+
+			/// A read-only view from a writable one
+			template <typename U, typename = std::enable_if_t<std::is_same_v<const U, T> && !std::is_same_v<U, T>>> ImageView(const ImageView<U> &view)
+				: data(view.data), depth(view.depth), width(view.width), height(view.height), row(view.row) {}
+
+
+			/// Test whether this view refers to anything
+			operator bool() const { return this->data; }
+
+			/// Return a pointer to the top-left pixel
+			T *Data() const { return this->data; }
+
+			/// Return the image depth
+			byte Depth() const { return this->depth; }
+
+			/// Return the image width
+			int Width() const { return this->width; }
+
+			/// Return the image height
+			int Height() const { return this->height; }
+
+			/// Return the number of pixels
+			size_t Size() const { return this->width * this->height; }
+
+			/// Return the distance between the start of each row in bytes
+			size_t Pitch() const { return this->row * sizeof(T); }
+
+			/// Whether the rows follow one another without any padding
+			bool Contiguous() const { return this->row == this->width * this->depth; }
+
+
+			/// A view of a region of this one. The region must be fully contained within this view,
+			/// if it is invalid then the result will be empty and will test as false.
+			ImageView<T> View(const int rx, const int ry, const int rw, const int rh) const
+			{
+				if (rx < 0 || ry < 0 || rw < 0 || rh < 0 || rx + rw > (int)this->width || ry + rh > (int)this->height)
+				{
+					return {};
+				}
+
+				return { this->data + ry * this->row + rx * this->depth, rw, rh, this->depth, this->Pitch() };
+			}
+
+
+			// Return an iterator to a row in the view. It will automatically step between pixels
+			// and provide a pointer to the current position which gives access to all channels.
+			image::Iterator<T> Row(const int y) const
+			{
+				return y >= 0 && y < (int)this->height
+					? image::Iterator<T>(this->data + y * this->row, this->width, this->depth)
+					: image::Iterator<T>();
+			}
+
+
+			/// Returns the maximum value (regardless of image depth), or 0 if the view is empty.
+			V Max(const image::Policy &policy = image::seq) const
+			{
+				return this->Reduce(policy, this->First(), [](const V *data, const size_t size) {
+					if constexpr (image::simd::Supported<V>)
+					{
+						return image::simd::Max(data, size);
+					}
+
+					return *std::max_element(data, data + size);
+				}, [](V a, V b) { return std::max(a, b); });
+			}
+
+			/// Returns the minimum value (regardless of image depth), or 0 if the view is empty.
+			V Min(const image::Policy &policy = image::seq) const
+			{
+				return this->Reduce(policy, this->First(), [](const V *data, const size_t size) {
+					if constexpr (image::simd::Supported<V>)
+					{
+						return image::simd::Min(data, size);
+					}
+
+					return *std::min_element(data, data + size);
+				}, [](V a, V b) { return std::min(a, b); });
+			}
+
+			/// Count the number of values (regardless of image depth) that match the supplied predicate.
+			/// With a parallel policy the predicate may be invoked concurrently.
+			int Count(const image::Policy &policy, std::function<bool(V value)> predicate) const
+			{
+				return this->Reduce(policy, 0, [&](const V *data, const size_t size) {
+					return (int)std::count_if(data, data + size, predicate);
+				}, std::plus<int> {});
+			}
+
+			/// Count the number of values (regardless of image depth) that match the supplied predicate.
+			int Count(std::function<bool(V value)> predicate) const
+			{
+				return this->Count(image::seq, predicate);
+			}
+
+			/// Count the number of zero values (regardless of image depth)
+			int ZeroCount(const image::Policy &policy = image::seq) const
+			{
+				return this->Reduce(policy, 0, [](const V *data, const size_t size) {
+					if constexpr (image::simd::Supported<V>)
+					{
+						return (int)image::simd::Count<V>(data, size, 0);
+					}
+
+					return (int)std::count_if(data, data + size, std::logical_not<V> {});
+				}, std::plus<int> {});
+			}
+
+			/// Check if all the pixels are set to the same value (regardless of image depth)
+			bool IsBlank(const image::Policy &policy, const V reference = 0) const
+			{
+				return this->Reduce(policy, true, [&](const V *data, const size_t size) {
+					if constexpr (image::simd::Supported<V>)
+					{
+						return image::simd::Uniform(data, size, reference);
+					}
+
+					return std::all_of(data, data + size, [&](auto v) { return v == reference; });
+				}, std::logical_and<bool> {});
+			}
+
+			/// Check if all the pixels are set to the same value (regardless of image depth)
+			bool IsBlank(const V reference = 0) const
+			{
+				return this->IsBlank(image::seq, reference);
+			}
+
+			/// Calculate the distribution statistics (regardless of image depth). With a parallel policy
+			/// the stats of each band are merged which may differ from the serial result by rounding error.
+			distribution Stats(const image::Policy &policy = image::seq) const
+			{
+				const size_t line = this->width * this->depth;
+
+				return this->Accumulate(policy, 1, [&](auto &stats, const size_t begin, const size_t end) {
+					if (this->Contiguous())
+					{
+						stats[0].Add(this->data + begin * line, (end - begin) * line);
+					}
+					else
+					{
+						for (size_t y=begin; y<end; y++)
+						{
+							stats[0].Add(this->data + y * this->row, line);
+						}
+					}
+				})[0];
+			}
+
+			/// Calculate the distribution statistics (regardless of image depth) of the pixels selected
+			/// by a mask of the same dimensions, the result is empty if the dimensions differ.
+			distribution Stats(const image::Policy &policy, const image::MaskView &mask) const
+			{
+				distribution result;
+
+				for (auto &channel : this->ChannelStats(policy, mask))
+				{
+					result.merge(channel);
+				}
+
+				return result;
+			}
+
+			/// Calculate the distribution statistics of each channel. Each band of pixels is split into
+			/// planes so that every channel is analysed at the full width of a vector.
+			std::vector<distribution> ChannelStats(const image::Policy &policy = image::seq) const
+			{
+				return this->Channels(policy, nullptr);
+			}
+
+			/// Calculate the distribution statistics of each channel of the pixels selected by a mask of
+			/// the same dimensions, the results are empty if the dimensions differ.
+			std::vector<distribution> ChannelStats(const image::Policy &policy, const image::MaskView &mask) const
+			{
+				if (mask.Width() != (int)this->width || mask.Height() != (int)this->height)
+				{
+					return std::vector<distribution>(this->depth);
+				}
+
+				return this->Channels(policy, &mask);
+			}
+
+
+			/// Clamp the values (regardless of image depth) to the supplied lower and upper limits.
+			void Clamp(const image::Policy &policy, const V lower, const V upper) const
+			{
+				this->Apply(policy, [&](V *data, const size_t size) {
+					if constexpr (image::simd::Supported<V>)
+					{
+						return image::simd::Clamp(data, size, lower, upper);
+					}
+
+					for (auto *d = data; d < data + size; d++)
+					{
+						*d = std::clamp(*d, lower, upper);
+					}
+				});
+			}
+
+			/// Clamp the values (regardless of image depth) to the supplied lower and upper limits.
+			void Clamp(const V lower, const V upper) const
+			{
+				this->Clamp(image::seq, lower, upper);
+			}
+
+			/// Shift all of the values (regardless of image depth) by the specified amount,
+			/// saturating at the limits of the type.
+			void Shift(const image::Policy &policy, const int value) const
+			{
+				this->Apply(policy, [&](V *data, const size_t size) {
+					if constexpr (image::simd::Integral<V>)
+					{
+						return image::simd::Shift(data, size, value);
+					}
+
+					for (auto *d = data; d < data + size; d++)
+					{
+						*d = Maths::clamp<V>(*d + value);
+					}
+				});
+			}
+
+			/// Shift all of the values (regardless of image depth) by the specified amount,
+			/// saturating at the limits of the type.
+			void Shift(const int value) const
+			{
+				this->Shift(image::seq, value);
+			}
+
+			/// Threshold the values at the given value
+			void Threshold(const image::Policy &policy, const V threshold, const V high = 255, const V low = 0) const
+			{
+				this->Apply(policy, [&](V *data, const size_t size) {
+					if constexpr (image::simd::Supported<V>)
+					{
+						return image::simd::Threshold(data, size, threshold, high, low);
+					}
+
+					for (auto *d = data; d < data + size; d++)
+					{
+						*d = *d < threshold ? low : high;
+					}
+				});
+			}
+
+			/// Threshold the values at the given value
+			void Threshold(const V threshold, const V high = 255, const V low = 0) const
+			{
+				this->Threshold(image::seq, threshold, high, low);
+			}
+
+			/// Invert the values
+			void Invert(const image::Policy &policy = image::seq) const
+			{
+				this->Apply(policy, [](V *data, const size_t size) {
+					if constexpr (image::simd::Integral<V>)
+					{
+						return image::simd::Invert(data, size);
+					}
+
+					std::transform(data, data + size, data, std::bit_not<V> {});
+				});
+			}
+
+			/// Arimetic OR with a modifier of the same dimensions, returns false if they differ.
+			bool OR(const image::Policy &policy, const ImageView<const V> &modifier) const
+			{
+				return this->Combine(policy, modifier, [](V *data, const V *m, const size_t size) {
+					if constexpr (image::simd::Integral<V>)
+					{
+						return image::simd::Or(data, m, size);
+					}
+
+					std::transform(data, data + size, m, data, std::bit_or<V> {});
+				});
+			}
+
+			/// Arimetic OR with a modifier of the same dimensions, returns false if they differ.
+			bool OR(const ImageView<const V> &modifier) const
+			{
+				return this->OR(image::seq, modifier);
+			}
+
+			/// Arimetic AND with a modifier of the same dimensions, returns false if they differ.
+			bool AND(const image::Policy &policy, const ImageView<const V> &modifier) const
+			{
+				return this->Combine(policy, modifier, [](V *data, const V *m, const size_t size) {
+					if constexpr (image::simd::Integral<V>)
+					{
+						return image::simd::And(data, m, size);
+					}
+
+					std::transform(data, data + size, m, data, std::bit_and<V> {});
+				});
+			}
+
+			/// Arimetic AND with a modifier of the same dimensions, returns false if they differ.
+			bool AND(const ImageView<const V> &modifier) const
+			{
+				return this->AND(image::seq, modifier);
+			}
+
+
+		private:
+
+			// The first value, used as the identity when searching for extremes
+			V First() const
+			{
+				return this->width && this->height ? *this->data : V {};
+			}
+
+
+			// Apply fn(data, size) to spans of the view. Contiguous views are split into arbitrary spans,
+			// otherwise each span is a single row.
+			template <typename F> void Apply(const image::Policy &policy, F &&fn, const bool contiguous = true) const
+			{
+				static_assert(!std::is_const_v<T>, "Cannot modify a read-only image view");
+
+				const size_t line = this->width * this->depth;
+
+				if (contiguous && this->Contiguous())
+				{
+					image::internal::Elements<V>(policy, line * this->height, [&](const size_t begin, const size_t end) {
+						fn(this->data + begin, end - begin);
+					});
+				}
+				else
+				{
+					image::internal::Rows(policy, this->height, line * sizeof(V), [&](const size_t begin, const size_t end) {
+						for (size_t y=begin; y<end; y++)
+						{
+							fn(this->data + y * this->row, line);
+						}
+					});
+				}
+			}
+
+
+			// Apply fn(data, modifier, size) to matching spans of this view and the modifier
+			template <typename F> bool Combine(const image::Policy &policy, const ImageView<const V> &modifier, F &&fn) const
+			{
+				if (modifier.width != this->width || modifier.height != this->height || modifier.depth != this->depth)
+				{
+					return false;
+				}
+
+				this->Apply(policy, [&](V *data, const size_t size) {
+					// Spans never cross the end of a row unless both views are contiguous
+					const size_t offset = data - this->data;
+					const size_t y		= this->row ? offset / this->row : 0;
+
+					fn(data, modifier.data + y * modifier.row + (offset - y * this->row), size);
+				}, modifier.Contiguous());
+
+				return true;
+			}
+
+
+			// Reduce spans of the view with fn(data, size) -> R and combine(R, R) -> R
+			template <typename R, typename F, typename C> R Reduce(const image::Policy &policy, const R &identity, F &&fn, C &&combine) const
+			{
+				const size_t line = this->width * this->depth;
+
+				if (this->Contiguous())
+				{
+					return image::internal::Reduce<V>(policy, line * this->height, identity, [&](const size_t begin, const size_t end) {
+						return fn(this->data + begin, end - begin);
+					}, combine);
+				}
+
+				return image::internal::ReduceRows(policy, this->height, line * sizeof(V), identity, [&](const size_t begin, const size_t end) {
+					R result = fn(this->data + begin * this->row, line);
+
+					for (size_t y=begin+1; y<end; y++)
+					{
+						result = combine(std::move(result), fn(this->data + y * this->row, line));
+					}
+
+					return result;
+				}, combine);
+			}
+
+
+			// Accumulate statistics over bands of rows with fn(stats, begin, end), where stats are the
+			// accumulators of each channel for that band, and merge the results of the bands.
+			template <typename F> std::vector<distribution> Accumulate(const image::Policy &policy, const size_t channels, F &&fn) const
+			{
+				return image::internal::ReduceRows(policy, this->height, this->width * this->depth * sizeof(V), std::vector<distribution>(channels), [&](const size_t begin, const size_t end) {
+					std::vector<image::internal::Statistics<V>> stats(channels);
+					std::vector<distribution> result;
+
+					fn(stats, begin, end);
+
+					for (auto &s : stats)
+					{
+						result.push_back(s.Result());
+					}
+
+					return result;
+				}, [](std::vector<distribution> a, const std::vector<distribution> &b) {
+					for (size_t c=0; c<a.size(); c++)
+					{
+						a[c].merge(b[c]);
+					}
+
+					return a;
+				});
+			}
+
+
+			// Statistics of each channel, where a mask (if any) selects the pixels. Rows are processed in
+			// chunks of pixels that are deinterleaved into planes, small enough to remain in the L1 cache.
+			std::vector<distribution> Channels(const image::Policy &policy, const image::MaskView *mask) const
+			{
+				constexpr size_t CHUNK = 1024;
+
+				using Statistics = image::internal::Statistics<V>;
+
+				return this->Accumulate(policy, this->depth, [&](auto &stats, const size_t begin, const size_t end) {
+					std::vector<V> planes(this->depth > 1 ? CHUNK * this->depth : 0);
+					std::vector<V *> pointers(this->depth);
+					std::vector<typename Statistics::M> selection;
+					uint64_t bits[CHUNK / 64];
+					size_t selected = 0;
+
+					for (byte c=0; c<this->depth; c++)
+					{
+						pointers[c] = planes.data() + c * CHUNK;
+					}
+
+					for (size_t y=begin; y<end; y++)
+					{
+						for (size_t x=0; x<this->width; x+=CHUNK)
+						{
+							const size_t count	= std::min(CHUNK, this->width - x);
+							const V *src		= this->data + y * this->row + x * this->depth;
+
+							if (mask)
+							{
+								mask->Extract(x, y, count, bits);
+								selected = Statistics::Expand(bits, count, selection);
+							}
+
+							if (this->depth > 1)
+							{
+								image::simd::Deinterleave(src, pointers.data(), count, this->depth);
+							}
+
+							for (byte c=0; c<this->depth; c++)
+							{
+								const V *samples = this->depth > 1 ? pointers[c] : src;
+
+								if (mask)	stats[c].Add(samples, count, selection.data(), selected);
+								else		stats[c].Add(samples, count);
+							}
+						}
+					}
+				});
+			}
+
+
+			T *data			= nullptr;
+			byte depth		= 1;
+			size_t width	= 0;
+			size_t height	= 0;
+			size_t row		= 0;	// Row stride in elements
+
+			template <typename U> friend class ImageView;
+	};
+}
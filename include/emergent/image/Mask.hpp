@@ -0,0 +1,198 @@
+#pragma once
+
+#include <emergent/Emergent.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+
+namespace emergent
+{
+	template <typename T> class ImageView;
+}
+
+
+namespace emergent::image
+{
+	// A read-only view of a bit-packed mask, which may be a region of a larger one. Bit i of the mask
+	// is bit i % 64 of word i / 64 and pixel (x, y) of the view is bit offset + y * row + x, where a
+	// set bit selects the pixel.
+	struct MaskView
+	{
+		const uint64_t *words	= nullptr;
+		size_t offset			= 0;	// Bit of the top-left pixel
+		size_t width			= 0;
+		size_t height			= 0;
+		size_t row				= 0;	// Bits from the start of one row to the next
+
+
+		operator bool() const { return this->words; }
+
+		int Width() const	{ return this->width; }
+		int Height() const	{ return this->height; }
+
+
+		// Whether the pixel is selected, the position must be within the view
+		bool Test(const int x, const int y) const
+		{
+			const size_t bit = this->offset + y * this->row + x;
+			return this->words[bit / 64] >> (bit % 64) & 1;
+		}
+
+
+		// A view of a region of this one. The region must be fully contained within this view,
+		// if it is invalid then the result will be empty and will test as false.
+		MaskView View(const int rx, const int ry, const int rw, const int rh) const
+		{
+			if (rx < 0 || ry < 0 || rw < 0 || rh < 0 || rx + rw > (int)this->width || ry + rh > (int)this->height)
+			{
+				return {};
+			}
+
+			return { this->words, this->offset + ry * this->row + rx, (size_t)rw, (size_t)rh, this->row };
+		}
+
+
+		// Copy the bits of `count` pixels of row y, starting at x, so that the first is bit 0 of dst.
+		// Any bits of the last word beyond the count are cleared.
+		void Extract(const int x, const int y, const size_t count, uint64_t *dst) const
+		{
+			const size_t start = this->offset + y * this->row + x;
+
+			for (size_t i=0; i<count; i+=64)
+			{
+				const size_t bit	= start + i;
+				const size_t shift	= bit % 64;
+				const size_t length	= std::min<size_t>(count - i, 64);
+				const uint64_t *w	= this->words + bit / 64;
+
+				// Only read the next word if the bits extend into it, since it may not exist
+				uint64_t value = w[0] >> shift;
+
+				if (shift && shift + length > 64)
+				{
+					value |= w[1] << (64 - shift);
+				}
+
+				*dst++ = length < 64 ? value & ((1ull << length) - 1) : value;
+			}
+		}
+	};
+
+
+	// A mask with a bit per pixel, used to select the pixels to include in statistics. Each row
+	// starts on a word boundary and the unused bits at the end of a row are always clear.
+	//
+	//    image::Mask mask(frame.Width(), frame.Height());
+	//    mask.Set(x, y);
+	//    auto stats = frame.View().Stats(image::par, mask);
+	class Mask
+	{
+		public:
+
+			Mask() = default;
+
+
+			Mask(const int width, const int height, const bool value = false)
+			{
+				if (width > 0 && height > 0)
+				{
+					this->width		= width;
+					this->height	= height;
+					this->row		= (width + 63) / 64;
+					this->words.assign(this->row * height, value ? ~0ull : 0);
+
+					if (value && width % 64)
+					{
+						for (int y=0; y<height; y++)
+						{
+							this->words[(y + 1) * this->row - 1] = (1ull << (width % 64)) - 1;
+						}
+					}
+				}
+			}
+
+
+			// A mask of the pixels that have any channel that is not zero
+			template <typename T> explicit Mask(const ImageView<T> &image) : Mask(image.Width(), image.Height())
+			{
+				const byte depth = image.Depth();
+
+				for (int y=0; y<image.Height(); y++)
+				{
+					int x = 0;
+
+					for (auto *p : image.Row(y))
+					{
+						if (std::any_of(p, p + depth, [](auto v) { return v != 0; }))
+						{
+							this->Set(x, y);
+						}
+
+						x++;
+					}
+				}
+			}
+
+
+			int Width() const	{ return this->width; }
+			int Height() const	{ return this->height; }
+
+
+			// Whether the pixel is selected, the position must be within the mask
+			bool Test(const int x, const int y) const
+			{
+				return this->words[y * this->row + x / 64] >> (x % 64) & 1;
+			}
+
+
+			// Select or deselect the pixel, the position must be within the mask
+			void Set(const int x, const int y, const bool value = true)
+			{
+				auto &word			= this->words[y * this->row + x / 64];
+				const uint64_t bit	= 1ull << (x % 64);
+
+				word = value ? word | bit : word & ~bit;
+			}
+
+
+			// The number of selected pixels
+			size_t Count() const
+			{
+				size_t result = 0;
+
+				for (auto w : this->words)
+				{
+					result += std::popcount(w);
+				}
+
+				return result;
+			}
+
+
+			MaskView View() const
+			{
+				return { this->words.data(), 0, this->width, this->height, this->row * 64 };
+			}
+
+
+			// A view of a region of the mask, which matches the same region of an image view
+			MaskView View(const int rx, const int ry, const int rw, const int rh) const
+			{
+				return this->View().View(rx, ry, rw, rh);
+			}
+
+
+			operator MaskView() const { return this->View(); }
+
+
+		private:
+
+			std::vector<uint64_t> words;
+			size_t width	= 0;
+			size_t height	= 0;
+			size_t row		= 0;	// Words per row
+	};
+}
@@ -0,0 +1,322 @@
+#pragma once
+
+#include <emergent/image/ImageBase.hpp>
+
+#include <cmath>
+#include <vector>
+
+
+namespace emergent
+{
+	/// An image that stores each channel in a separate plane (RRR…GGG…BBB…) rather than interleaving
+	/// them. Operations on a single channel then read consecutive samples, so they run at the full
+	/// width of a vector instead of striding through pixels. Each plane is a view of depth 1, which
+	/// means that everything ImageView and image expressions provide works on it directly.
+	///
+	/// Every plane starts on an aligned boundary within a single buffer. Conversions to and from
+	/// interleaved images are vectorised with shuffles for 2, 3 and 4 channels.
+	///
+	///    PlanarImage<byte> planar(frame, image::par);
+	///    auto stats = planar.Stats(image::par);
+	///    planar.Plane(2).Threshold(128);
+	///    planar.Interleave(image::par, frame);
+	template <typename T = byte> class PlanarImage
+	{
+		static_assert(std::is_arithmetic<T>::value, "Image type must be numeric");
+
+		public:
+
+			PlanarImage(const byte depth = 1, const int width = 0, const int height = 0)
+			{
+				if (!depth)
+				{
+					throw std::runtime_error("Image depth must be greater than zero");
+				}
+
+				this->depth = depth;
+				this->Resize(width, height);
+			}
+
+
+			/// Convert an interleaved image, the depth of the source is copied.
+			explicit PlanarImage(const ImageView<const T> &image, const image::Policy &policy = image::seq)
+			{
+				this->Deinterleave(policy, image);
+			}
+
+
+			/// Convert a writable view, which would otherwise be ambiguous with the depth through its operator bool.
+			explicit PlanarImage(const ImageView<T> &image, const image::Policy &policy = image::seq)
+				: PlanarImage(ImageView<const T>(image), policy) {}
+
+
+			/// Convert an interleaved image, the depth of the source is copied.
+			explicit PlanarImage(const ImageBase<T> &image, const image::Policy &policy = image::seq)
+				: PlanarImage(image.View(), policy) {}
+
+
+			/// Return the image depth, which is the number of planes
+			byte Depth() const { return this->depth; }
+
+			/// Return the image width
+			int Width() const { return this->width; }
+
+			/// Return the image height
+			int Height() const { return this->height; }
+
+			/// Return the number of pixels
+			size_t Size() const { return this->width * this->height; }
+
+
+			/// Return a pointer to the start of a plane, or nullptr if there is no such channel
+			T *Data(const byte channel)
+			{
+				return channel < this->depth && this->Size() ? this->buffer.data() + channel * this->stride : nullptr;
+			}
+
+			const T *Data(const byte channel) const
+			{
+				return channel < this->depth && this->Size() ? this->buffer.data() + channel * this->stride : nullptr;
+			}
+
+
+			/// A view of a single channel. It is empty, and will test as false, if there is no such channel.
+			ImageView<T> Plane(const byte channel)
+			{
+				return { this->Data(channel), this->Data(channel) ? (int)this->width : 0, (int)this->height };
+			}
+
+			ImageView<const T> Plane(const byte channel) const
+			{
+				return { this->Data(channel), this->Data(channel) ? (int)this->width : 0, (int)this->height };
+			}
+
+
+			/// Resizes the planes but may destroy any existing image data.
+			/// A depth of 0 will keep the existing depth.
+			void Resize(const int width, const int height, const byte depth = 0)
+			{
+				constexpr size_t ALIGN = std::max<size_t>(image::Allocator::ALIGNMENT / sizeof(T), 1);
+
+				this->depth		= depth ? depth : this->depth;
+				this->width		= width > 0 && height > 0 ? width : 0;
+				this->height	= width > 0 && height > 0 ? height : 0;
+				this->stride	= (this->Size() + ALIGN - 1) / ALIGN * ALIGN;
+
+				this->buffer.resize(this->stride * this->depth);
+			}
+
+
+			/// Clear the image - sets all samples to 0 regardless of type
+			void Clear()
+			{
+				std::fill(this->buffer.begin(), this->buffer.end(), 0);
+			}
+
+
+			/// Split an interleaved image into planes, resizing this to match it.
+			void Deinterleave(const image::Policy &policy, const ImageView<const T> &image)
+			{
+				this->Resize(image.Width(), image.Height(), image.Depth());
+
+				this->Convert(policy, image, [&](const T *src, T *const *dst, const size_t pixels) {
+					image::simd::Deinterleave(src, dst, pixels, this->depth);
+				});
+			}
+
+			/// Split an interleaved image into planes, resizing this to match it.
+			void Deinterleave(const ImageView<const T> &image)
+			{
+				this->Deinterleave(image::seq, image);
+			}
+
+
+			/// Merge the planes into an interleaved view of the same dimensions and depth, returns false if they differ.
+			bool Interleave(const image::Policy &policy, const ImageView<T> &image) const
+			{
+				if (image.Width() != (int)this->width || image.Height() != (int)this->height || image.Depth() != this->depth)
+				{
+					return false;
+				}
+
+				this->Convert(policy, image, [&](T *dst, const T *const *src, const size_t pixels) {
+					image::simd::Interleave(src, dst, pixels, this->depth);
+				});
+
+				return true;
+			}
+
+			/// Merge the planes into an interleaved image, resizing it to match.
+			void Interleave(const image::Policy &policy, ImageBase<T> &image) const
+			{
+				image.Resize(this->width, this->height, this->depth);
+				this->Interleave(policy, image.View());
+			}
+
+			/// Merge the planes into an interleaved image, resizing it to match.
+			void Interleave(ImageBase<T> &image) const
+			{
+				this->Interleave(image::seq, image);
+			}
+
+
+			/// Calculate the distribution statistics of each channel. With a parallel policy the
+			/// stats of each band are merged which may differ from the serial result by rounding error.
+			std::vector<distribution> Stats(const image::Policy &policy = image::seq) const
+			{
+				std::vector<distribution> result(this->depth);
+
+				for (byte c=0; c<this->depth; c++)
+				{
+					result[c] = this->Plane(c).Stats(policy);
+				}
+
+				return result;
+			}
+
+
+			/// Calculate the distribution statistics of each channel of the pixels selected by a mask of
+			/// the same dimensions, the results are empty if the dimensions differ.
+			std::vector<distribution> Stats(const image::Policy &policy, const image::MaskView &mask) const
+			{
+				std::vector<distribution> result(this->depth);
+
+				for (byte c=0; c<this->depth; c++)
+				{
+					result[c] = this->Plane(c).Stats(policy, mask);
+				}
+
+				return result;
+			}
+
+
+			/// Clamp the values of every channel to the supplied lower and upper limits.
+			void Clamp(const image::Policy &policy, const T lower, const T upper)
+			{
+				this->Each([&](auto plane) { plane.Clamp(policy, lower, upper); });
+			}
+
+			/// Clamp the values of every channel to the supplied lower and upper limits.
+			void Clamp(const T lower, const T upper)
+			{
+				this->Clamp(image::seq, lower, upper);
+			}
+
+			/// Shift the values of every channel by the specified amount, saturating at the limits of the type.
+			void Shift(const image::Policy &policy, const int value)
+			{
+				this->Each([&](auto plane) { plane.Shift(policy, value); });
+			}
+
+			/// Shift the values of every channel by the specified amount, saturating at the limits of the type.
+			void Shift(const int value)
+			{
+				this->Shift(image::seq, value);
+			}
+
+			/// Threshold the values of every channel at the given value
+			void Threshold(const image::Policy &policy, const T threshold, const T high = 255, const T low = 0)
+			{
+				this->Each([&](auto plane) { plane.Threshold(policy, threshold, high, low); });
+			}
+
+			/// Threshold the values of every channel at the given value
+			void Threshold(const T threshold, const T high = 255, const T low = 0)
+			{
+				this->Threshold(image::seq, threshold, high, low);
+			}
+
+			/// Invert the values of every channel
+			void Invert(const image::Policy &policy = image::seq)
+			{
+				this->Each([&](auto plane) { plane.Invert(policy); });
+			}
+
+
+			/// Scale and shift each channel independently so that it has the target variance and mean,
+			/// saturating at the limits of the type. A channel without any variance is left unchanged.
+			/// Returns false if the image is empty.
+			bool VarianceNormalise(const image::Policy &policy, const double variance, const double mean = 128)
+			{
+				if (!this->Size())
+				{
+					return false;
+				}
+
+				const auto stats = this->Stats(policy);
+
+				// Results are truncated when converted to integers, so rounding is folded into the offset
+				const double round = std::is_integral_v<T> ? 0.5 : 0.0;
+
+				for (byte c=0; c<this->depth; c++)
+				{
+					if (stats[c].variance > 0)
+					{
+						const auto plane	= this->Plane(c);
+						const double scale	= std::sqrt(variance / stats[c].variance);
+						const double offset	= mean - stats[c].mean * scale + round;
+
+						image::Evaluate(policy, plane, plane * (float)scale + (float)offset);
+					}
+				}
+
+				return true;
+			}
+
+			/// Scale and shift each channel independently so that it has the target variance and mean,
+			/// saturating at the limits of the type. Returns false if the image is empty.
+			bool VarianceNormalise(const double variance, const double mean = 128)
+			{
+				return this->VarianceNormalise(image::seq, variance, mean);
+			}
+
+
+		private:
+
+			template <typename F> void Each(F &&fn)
+			{
+				for (byte c=0; c<this->depth; c++)
+				{
+					fn(this->Plane(c));
+				}
+			}
+
+
+			// Invoke fn(pixels, planes, count) over bands of rows, where the planes are offset to match the
+			// interleaved pixels. A contiguous image is converted a whole band at a time.
+			template <typename U, typename F> void Convert(const image::Policy &policy, const ImageView<U> &image, F &&fn) const
+			{
+				image::internal::Rows(policy, this->height, this->width * this->depth * sizeof(T), [&](const size_t begin, const size_t end) {
+					std::vector<T *> planes(this->depth);
+
+					auto at = [&](const size_t y) {
+						for (byte c=0; c<this->depth; c++)
+						{
+							planes[c] = (T *)this->buffer.data() + c * this->stride + y * this->width;
+						}
+
+						return planes.data();
+					};
+
+					if (image.Contiguous())
+					{
+						fn(image.Row(begin).data, at(begin), (end - begin) * this->width);
+					}
+					else
+					{
+						for (size_t y=begin; y<end; y++)
+						{
+							fn(image.Row(y).data, at(y), this->width);
+						}
+					}
+				});
+			}
+
+
+			image::Buffer<T> buffer;
+			byte depth		= 1;
+			size_t width	= 0;
+			size_t height	= 0;
+			size_t stride	= 0;	// Distance between the start of each plane in elements
+	};
+}
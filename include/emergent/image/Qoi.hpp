@@ -1,5 +1,6 @@
 #pragma once
 #include <emergent/image/ImageBase.hpp>
+#include <emergent/image/Planar.hpp>
 
 #if __has_include(<zstd.h>)
 	#include <zstd.h>
@@ -22,168 +23,51 @@ namespace emergent::image
 	// This algorithm is based on the assumption that HDR images contain more noise in the lower
 	// bits which makes this kind of encoding more difficult, so instead concentrate on shrinking
 	// the most significant bits instead.
+	//
+	// Encoding can be cancelled with a stop token, which is checked at the start of each row, in
+	// which case it returns false and the contents of the destination are undefined.
 	class Qoi
 	{
 		public:
 
-			template <typename T, typename C> static bool Encode(const ImageBase<T> &src, C &dst)
+			template <typename T, typename C> static bool Encode(const ImageBase<T> &src, C &dst, std::stop_token token = {})
 			{
-				static_assert(is_contiguous<C>, "destination must be a contiguous container type");
-				static_assert(sizeof(typename C::value_type) == 1, "destination must be a byte buffer");
-				static_assert(std::is_same_v<T, uint8_t> || std::is_same_v<T, uint16_t>, "image type must be uint8_t or uint16_t");
-
-				const size_t width	= src.Width();
-				const size_t height	= src.Height();
-				const byte depth	= src.Depth();
-
-				if (width == 0 || height == 0 || width * height > MAX_PIXELS)
-				{
-					return false;
-				}
-
-				if (depth == 1)
-				{
-					// If encoding a greyscale image simply write the raw bytes
-					Header header(width, height, 1, sizeof(T));
-
-					const size_t size = width * height * sizeof(T);
-
-					dst.resize(sizeof(Header) + size);
-					std::memcpy(dst.data(), &header, sizeof(Header));
-					std::memcpy(dst.data() + sizeof(Header), src.Data(), size);
-
-					return true;
-				}
-				else if (depth != 3)
-				{
-					return false;
-				}
+				return Encode(src.View(), dst, token);
+			}
 
-				Header header(width, height, depth, sizeof(T));
 
-				dst.resize(width * height * (depth + 1) * sizeof(T) + sizeof(Header) + sizeof(PADDING));
-				std::memcpy(dst.data(), &header, sizeof(Header));
-
-				std::array<Pixel, LOOKUP_SIZE> index = {{}};
-				std::array<Pixel, RUN_SIZE+1> residuals;
-				Pixel previous, current;
+			// Encode directly from a view, which may have padded rows, without copying it into an image first.
+			template <typename T, typename C> static bool Encode(const ImageView<T> &src, C &dst, std::stop_token token = {})
+			{
+				return EncodeRows<std::remove_const_t<T>>(src.Width(), src.Height(), src.Depth(), [&](const size_t y) {
+					return (const T *)src.Row(y).data;
+				}, dst, token);
+			}
 
-				byte *pd	= dst.data() + sizeof(Header);
-				int run		= 0;
 
-				// Write a run length + residuals block to the buffer when dealing with 16-bit images
-				auto Run = [](byte *dst, const int run, const std::array<Pixel, RUN_SIZE+1> &residuals) {
-					*dst++	= OP_RUN | (run - 1);
-
-					if constexpr (sizeof(T) == 2)
-					{
-						for (int i=0; i<run; i++)
-						{
-							*dst++ = residuals[i].rgb.r;
-							*dst++ = residuals[i].rgb.g;
-							*dst++ = residuals[i].rgb.b;
-						}
-					}
+			// Encode a planar image. Each row is interleaved into a scratch buffer when it is reached,
+			// so the whole image is never converted.
+			template <typename T, typename C> static bool Encode(const PlanarImage<T> &src, C &dst, std::stop_token token = {})
+			{
+				const size_t width = src.Width();
 
-					return dst;
-				};
+				std::vector<T> row(width * src.Depth());
+				std::vector<const T *> planes(src.Depth());
 
-				for (auto *p : src.Pixels())
-				{
-					if constexpr (sizeof(T) == 1)
-					{
-						current.rgb.r = p[0];
-						current.rgb.g = p[1];
-						current.rgb.b = p[2];
-
-						// We're not using alpha channels at all, so skip this
-						// if (depth == 4)
-						// {
-						// 	current.rgb.a = p[3];
-						// }
-					}
-					else
+				return EncodeRows<T>(width, src.Height(), src.Depth(), [&](const size_t y) {
+					for (byte c=0; c<src.Depth(); c++)
 					{
-						current.rgb.r			= p[0] >> 8;
-						current.rgb.g			= p[1] >> 8;
-						current.rgb.b			= p[2] >> 8;
-						residuals[run].rgb.r	= p[0] & 0xff;
-						residuals[run].rgb.g	= p[1] & 0xff;
-						residuals[run].rgb.b	= p[2] & 0xff;
+						planes[c] = src.Data(c) + y * width;
 					}
 
-					if (current.v == previous.v)
-					{
-						if (++run == RUN_SIZE)
-						{
-							pd	= Run(pd, run, residuals);
-							run	= 0;
-						}
-					}
-					else
+					if (src.Depth() == 1)
 					{
-						const auto &res	= residuals[run];
-
-						if (run)
-						{
-							pd	= Run(pd, run, residuals);
-							run	= 0;
-						}
-
-						const int lookup = Hash(current);
-
-						if (index[lookup].v == current.v)
-						{
-							*pd++ = OP_INDEX | lookup;
-						}
-						else
-						{
-							index[lookup] = current;
-
-							const signed char dr	= current.rgb.r - previous.rgb.r;
-							const signed char dg	= current.rgb.g - previous.rgb.g;
-							const signed char db	= current.rgb.b - previous.rgb.b;
-							const signed char dgr	= dr - dg;
-							const signed char dgb	= db - dg;
-
-							if (dr > -3 && dr < 2 && dg > -3 && dg < 2 && db > -3 && db < 2)
-							{
-								*pd++ = OP_DIFF | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2);
-							}
-							else if (dgr > -9 && dgr < 8 && dg > -33 && dg < 32 && dgb > -9 && dgb < 8)
-							{
-								*pd++ = OP_LUMA | (dg + 32);
-								*pd++ = (dgr + 8) << 4 | (dgb + 8);
-							}
-							else
-							{
-								*pd++ = OP_RGB;
-								*pd++ = current.rgb.r;
-								*pd++ = current.rgb.g;
-								*pd++ = current.rgb.b;
-							}
-						}
-
-						if constexpr (sizeof(T) == 2)
-						{
-							*pd++ = res.rgb.r;
-							*pd++ = res.rgb.g;
-							*pd++ = res.rgb.b;
-						}
+						return planes[0];
 					}
 
-					previous = current;
-				}
-
-				if (run)
-				{
-					pd = Run(pd, run, residuals);
-				}
-
-				std::memcpy(pd, PADDING.data(), sizeof(PADDING));
-				dst.resize(pd + sizeof(PADDING) - dst.data());
-
-				return true;
+					simd::Interleave(planes.data(), row.data(), width, src.Depth());
+					return (const T *)row.data();
+				}, dst, token);
 			}
 
 
@@ -305,6 +189,178 @@ namespace emergent::image
 
 		private:
 
+			// Encode rows of interleaved pixels where row(y) returns a pointer to the start of row y.
+			template <typename T, typename C, typename R> static bool EncodeRows(const size_t width, const size_t height, const byte depth, R &&row, C &dst, std::stop_token token)
+			{
+				static_assert(is_contiguous<C>, "destination must be a contiguous container type");
+				static_assert(sizeof(typename C::value_type) == 1, "destination must be a byte buffer");
+				static_assert(std::is_same_v<T, uint8_t> || std::is_same_v<T, uint16_t>, "image type must be uint8_t or uint16_t");
+
+				if (width == 0 || height == 0 || width * height > MAX_PIXELS)
+				{
+					return false;
+				}
+
+				if (depth == 1)
+				{
+					// If encoding a greyscale image simply write the raw bytes
+					Header header(width, height, 1, sizeof(T));
+
+					const size_t line = width * sizeof(T);
+
+					dst.resize(sizeof(Header) + height * line);
+					std::memcpy(dst.data(), &header, sizeof(Header));
+
+					for (size_t y=0; y<height; y++)
+					{
+						std::memcpy(dst.data() + sizeof(Header) + y * line, row(y), line);
+					}
+
+					return true;
+				}
+				else if (depth != 3)
+				{
+					return false;
+				}
+
+				Header header(width, height, depth, sizeof(T));
+
+				dst.resize(width * height * (depth + 1) * sizeof(T) + sizeof(Header) + sizeof(PADDING));
+				std::memcpy(dst.data(), &header, sizeof(Header));
+
+				std::array<Pixel, LOOKUP_SIZE> index = {{}};
+				std::array<Pixel, RUN_SIZE+1> residuals;
+				Pixel previous, current;
+
+				byte *pd	= dst.data() + sizeof(Header);
+				int run		= 0;
+
+				// Write a run length + residuals block to the buffer when dealing with 16-bit images
+				auto Run = [](byte *dst, const int run, const std::array<Pixel, RUN_SIZE+1> &residuals) {
+					*dst++	= OP_RUN | (run - 1);
+
+					if constexpr (sizeof(T) == 2)
+					{
+						for (int i=0; i<run; i++)
+						{
+							*dst++ = residuals[i].rgb.r;
+							*dst++ = residuals[i].rgb.g;
+							*dst++ = residuals[i].rgb.b;
+						}
+					}
+
+					return dst;
+				};
+
+				for (size_t y=0; y<height; y++)
+				{
+					if (token.stop_requested())
+					{
+						return false;
+					}
+
+					const T *p = row(y);
+
+					for (size_t x=0; x<width; x++, p += depth)
+					{
+						if constexpr (sizeof(T) == 1)
+						{
+							current.rgb.r = p[0];
+							current.rgb.g = p[1];
+							current.rgb.b = p[2];
+
+							// We're not using alpha channels at all, so skip this
+							// if (depth == 4)
+							// {
+							// 	current.rgb.a = p[3];
+							// }
+						}
+						else
+						{
+							current.rgb.r			= p[0] >> 8;
+							current.rgb.g			= p[1] >> 8;
+							current.rgb.b			= p[2] >> 8;
+							residuals[run].rgb.r	= p[0] & 0xff;
+							residuals[run].rgb.g	= p[1] & 0xff;
+							residuals[run].rgb.b	= p[2] & 0xff;
+						}
+
+						if (current.v == previous.v)
+						{
+							if (++run == RUN_SIZE)
+							{
+								pd	= Run(pd, run, residuals);
+								run	= 0;
+							}
+						}
+						else
+						{
+							const auto &res	= residuals[run];
+
+							if (run)
+							{
+								pd	= Run(pd, run, residuals);
+								run	= 0;
+							}
+
+							const int lookup = Hash(current);
+
+							if (index[lookup].v == current.v)
+							{
+								*pd++ = OP_INDEX | lookup;
+							}
+							else
+							{
+								index[lookup] = current;
+
+								const signed char dr	= current.rgb.r - previous.rgb.r;
+								const signed char dg	= current.rgb.g - previous.rgb.g;
+								const signed char db	= current.rgb.b - previous.rgb.b;
+								const signed char dgr	= dr - dg;
+								const signed char dgb	= db - dg;
+
+								if (dr > -3 && dr < 2 && dg > -3 && dg < 2 && db > -3 && db < 2)
+								{
+									*pd++ = OP_DIFF | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2);
+								}
+								else if (dgr > -9 && dgr < 8 && dg > -33 && dg < 32 && dgb > -9 && dgb < 8)
+								{
+									*pd++ = OP_LUMA | (dg + 32);
+									*pd++ = (dgr + 8) << 4 | (dgb + 8);
+								}
+								else
+								{
+									*pd++ = OP_RGB;
+									*pd++ = current.rgb.r;
+									*pd++ = current.rgb.g;
+									*pd++ = current.rgb.b;
+								}
+							}
+
+							if constexpr (sizeof(T) == 2)
+							{
+								*pd++ = res.rgb.r;
+								*pd++ = res.rgb.g;
+								*pd++ = res.rgb.b;
+							}
+						}
+
+						previous = current;
+					}
+				}
+
+				if (run)
+				{
+					pd = Run(pd, run, residuals);
+				}
+
+				std::memcpy(pd, PADDING.data(), sizeof(PADDING));
+				dst.resize(pd + sizeof(PADDING) - dst.data());
+
+				return true;
+			}
+
+
 			static constexpr byte OP_INDEX	= 0x00;
 			static constexpr byte OP_DIFF	= 0x40;
 			static constexpr byte OP_LUMA	= 0x80;
@@ -374,7 +430,8 @@ namespace emergent::image
 	{
 		public:
 
-			template <typename T, typename C> static bool Encode(const ImageBase<T> &src, C &dst, C &scratch, const int compression = 1)
+			// The token is passed through to Qoi::Encode and checked again before compression.
+			template <typename T, typename C> static bool Encode(const ImageBase<T> &src, C &dst, C &scratch, const int compression = 1, std::stop_token token = {})
 			{
 				static_assert(is_contiguous<C>, "source must be a contiguous container type");
 				static_assert(sizeof(typename C::value_type) == 1, "source must be a byte buffer");
@@ -384,7 +441,7 @@ namespace emergent::image
 					[](auto *c) { ZSTD_freeCCtx(c); }
 				);
 
-				if (!Qoi::Encode(src, scratch))
+				if (!Qoi::Encode(src, scratch, token) || token.stop_requested())
 				{
 					return false;
 				}
@@ -961,6 +1018,178 @@ namespace emergent::image
 
 		private:
 
+			// Encode rows of interleaved pixels where row(y) returns a pointer to the start of row y.
+			template <typename T, typename C, typename R> static bool EncodeRows(const size_t width, const size_t height, const byte depth, R &&row, C &dst, std::stop_token token)
+			{
+				static_assert(is_contiguous<C>, "destination must be a contiguous container type");
+				static_assert(sizeof(typename C::value_type) == 1, "destination must be a byte buffer");
+				static_assert(std::is_same_v<T, uint8_t> || std::is_same_v<T, uint16_t>, "image type must be uint8_t or uint16_t");
+
+				if (width == 0 || height == 0 || width * height > MAX_PIXELS)
+				{
+					return false;
+				}
+
+				if (depth == 1)
+				{
+					// If encoding a greyscale image simply write the raw bytes
+					Header header(width, height, 1, sizeof(T));
+
+					const size_t line = width * sizeof(T);
+
+					dst.resize(sizeof(Header) + height * line);
+					std::memcpy(dst.data(), &header, sizeof(Header));
+
+					for (size_t y=0; y<height; y++)
+					{
+						std::memcpy(dst.data() + sizeof(Header) + y * line, row(y), line);
+					}
+
+					return true;
+				}
+				else if (depth != 3)
+				{
+					return false;
+				}
+
+				Header header(width, height, depth, sizeof(T));
+
+				dst.resize(width * height * (depth + 1) * sizeof(T) + sizeof(Header) + sizeof(PADDING));
+				std::memcpy(dst.data(), &header, sizeof(Header));
+
+				std::array<Pixel, LOOKUP_SIZE> index = {{}};
+				std::array<Pixel, RUN_SIZE+1> residuals;
+				Pixel previous, current;
+
+				byte *pd	= dst.data() + sizeof(Header);
+				int run		= 0;
+
+				// Write a run length + residuals block to the buffer when dealing with 16-bit images
+				auto Run = [](byte *dst, const int run, const std::array<Pixel, RUN_SIZE+1> &residuals) {
+					*dst++	= OP_RUN | (run - 1);
+
+					if constexpr (sizeof(T) == 2)
+					{
+						for (int i=0; i<run; i++)
+						{
+							*dst++ = residuals[i].rgb.r;
+							*dst++ = residuals[i].rgb.g;
+							*dst++ = residuals[i].rgb.b;
+						}
+					}
+
+					return dst;
+				};
+
+				for (size_t y=0; y<height; y++)
+				{
+					if (token.stop_requested())
+					{
+						return false;
+					}
+
+					const T *p = row(y);
+
+					for (size_t x=0; x<width; x++, p += depth)
+					{
+						if constexpr (sizeof(T) == 1)
+						{
+							current.rgb.r = p[0];
+							current.rgb.g = p[1];
+							current.rgb.b = p[2];
+
+							// We're not using alpha channels at all, so skip this
+							// if (depth == 4)
+							// {
+							// 	current.rgb.a = p[3];
+							// }
+						}
+						else
+						{
+							current.rgb.r			= p[0] >> 8;
+							current.rgb.g			= p[1] >> 8;
+							current.rgb.b			= p[2] >> 8;
+							residuals[run].rgb.r	= p[0] & 0xff;
+							residuals[run].rgb.g	= p[1] & 0xff;
+							residuals[run].rgb.b	= p[2] & 0xff;
+						}
+
+						if (current.v == previous.v)
+						{
+							if (++run == RUN_SIZE)
+							{
+								pd	= Run(pd, run, residuals);
+								run	= 0;
+							}
+						}
+						else
+						{
+							const auto &res	= residuals[run];
+
+							if (run)
+							{
+								pd	= Run(pd, run, residuals);
+								run	= 0;
+							}
+
+							const int lookup = Hash(current);
+
+							if (index[lookup].v == current.v)
+							{
+								*pd++ = OP_INDEX | lookup;
+							}
+							else
+							{
+								index[lookup] = current;
+
+								const signed char dr	= current.rgb.r - previous.rgb.r;
+								const signed char dg	= current.rgb.g - previous.rgb.g;
+								const signed char db	= current.rgb.b - previous.rgb.b;
+								const signed char dgr	= dr - dg;
+								const signed char dgb	= db - dg;
+
+								if (dr > -3 && dr < 2 && dg > -3 && dg < 2 && db > -3 && db < 2)
+								{
+									*pd++ = OP_DIFF | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2);
+								}
+								else if (dgr > -9 && dgr < 8 && dg > -33 && dg < 32 && dgb > -9 && dgb < 8)
+								{
+									*pd++ = OP_LUMA | (dg + 32);
+									*pd++ = (dgr + 8) << 4 | (dgb + 8);
+								}
+								else
+								{
+									*pd++ = OP_RGB;
+									*pd++ = current.rgb.r;
+									*pd++ = current.rgb.g;
+									*pd++ = current.rgb.b;
+								}
+							}
+
+							if constexpr (sizeof(T) == 2)
+							{
+								*pd++ = res.rgb.r;
+								*pd++ = res.rgb.g;
+								*pd++ = res.rgb.b;
+							}
+						}
+
+						previous = current;
+					}
+				}
+
+				if (run)
+				{
+					pd = Run(pd, run, residuals);
+				}
+
+				std::memcpy(pd, PADDING.data(), sizeof(PADDING));
+				dst.resize(pd + sizeof(PADDING) - dst.data());
+
+				return true;
+			}
+
+
 			static constexpr byte OP_INDEX	= 0x00;	// 0b0000'0000;
 			static constexpr byte OP_DIFF	= 0x40; // 0b0100'0000;
 			static constexpr byte OP_LUMA	= 0x80; // 0b1000'0000;
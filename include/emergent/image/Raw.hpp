@@ -0,0 +1,404 @@
+#pragma once
+
+#include <emergent/image/ImageView.hpp>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+namespace emergent::image
+{
+	// Header of the raw image container. All values are stored in the native (little endian) byte order.
+	// The pixel data starts at the offset, which is aligned so that a mapped file can be used directly,
+	// and each row occupies stride bytes of which any beyond the pixels are padding. Readers must use
+	// the size, offset and stride from the header so that later versions are free to extend it.
+	struct RawHeader
+	{
+		static constexpr uint32_t MAGIC		= 'e' | 'm' << 8 | 'g' << 16 | 'r' << 24;
+		static constexpr uint16_t VERSION	= 1;
+
+		// Type of the samples, which distinguishes types of the same size
+		enum Format : byte
+		{
+			Unsigned,
+			Signed,
+			Float
+		};
+
+		// Bit flags
+		static constexpr byte CHECKSUM = 0x01;	// The checksum of the pixel data is present
+
+		uint32_t magic		= MAGIC;
+		uint16_t version	= VERSION;
+		uint16_t size		= sizeof(RawHeader);	// Size of this header
+		uint32_t width		= 0;
+		uint32_t height		= 0;
+		uint64_t stride		= 0;	// Bytes from the start of one row to the next
+		uint64_t offset		= 0;	// Bytes from the start of the file to the pixel data
+		uint64_t checksum	= 0;	// Fletcher-64 of the pixels in each row, excluding padding
+		byte depth			= 1;
+		byte typesize		= 1;
+		byte format			= Unsigned;
+		byte flags			= 0;
+		uint32_t reserved	= 0;
+
+
+		template <typename T> static constexpr byte FormatOf()
+		{
+			return std::is_floating_point_v<T> ? Float : std::is_signed_v<T> ? Signed : Unsigned;
+		}
+
+		// Whether the samples are of type T
+		template <typename T> bool Holds() const
+		{
+			return this->typesize == sizeof(T) && this->format == FormatOf<std::remove_const_t<T>>();
+		}
+	};
+
+	static_assert(sizeof(RawHeader) == 48, "Raw header layout must not change");
+
+
+	struct RawOptions
+	{
+		size_t alignment	= 4096;	// Alignment of the pixel data within the file, a page allows it to be mapped directly
+		size_t row			= 64;	// Alignment of the stride, so that every row of a mapped file is aligned for vectors
+		bool checksum		= false;
+	};
+
+
+	// Read and write the raw image container. Writing gathers the rows directly from the image with
+	// pwritev and loading is done with RawFile, which maps the file so that it can be viewed without
+	// copying it.
+	class Raw
+	{
+		public:
+
+			// Write the image to the given path, returning false on failure.
+			template <typename T> static bool Save(const ImageView<T> &image, const std::string &path, const RawOptions &options = {})
+			{
+				using V = std::remove_const_t<T>;
+
+				const size_t line	= image.Width() * image.Depth() * sizeof(V);
+				const size_t row	= std::max<size_t>(options.row, 1);
+
+				RawHeader header;
+				header.width	= image.Width();
+				header.height	= image.Height();
+				header.depth	= image.Depth();
+				header.typesize	= sizeof(V);
+				header.format	= RawHeader::FormatOf<V>();
+				header.stride	= (line + row - 1) / row * row;
+				header.offset	= Align(sizeof(RawHeader), std::max<size_t>(options.alignment, 1));
+
+				if (options.checksum)
+				{
+					header.flags	|= RawHeader::CHECKSUM;
+					header.checksum	= Checksum(image);
+				}
+
+				// Padding is written from a single buffer of zeroes
+				const std::vector<byte> zeroes(std::max<size_t>(header.offset - sizeof(RawHeader), header.stride - line));
+				std::vector<iovec> parts;
+
+				parts.reserve(2 + image.Height() * 2);
+				parts.push_back({ &header, sizeof(RawHeader) });
+				parts.push_back({ (void *)zeroes.data(), header.offset - sizeof(RawHeader) });
+
+				for (int y=0; y<image.Height(); y++)
+				{
+					parts.push_back({ (void *)image.Row(y).data, line });
+					parts.push_back({ (void *)zeroes.data(), header.stride - line });
+				}
+
+				const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+				if (fd < 0)
+				{
+					return false;
+				}
+
+				const bool result = Write(fd, parts) && ftruncate(fd, header.offset + header.stride * header.height) == 0;
+
+				return close(fd) == 0 && result;
+			}
+
+
+			// A Fletcher-64 checksum of the pixels of each row, excluding any padding
+			template <typename T> static uint64_t Checksum(const ImageView<T> &image)
+			{
+				const size_t line	= image.Width() * image.Depth() * sizeof(T);
+				uint64_t a			= 0;
+				uint64_t b			= 0;
+				uint32_t word		= 0;
+				size_t filled		= 0;
+
+				// The sums are reduced before they can overflow, which for b is after 92681 words
+				constexpr size_t BLOCK	= 65536;
+				constexpr uint64_t MOD	= 0xffffffff;
+				size_t count			= 0;
+
+				auto add = [&](const uint32_t w) {
+					a += w;
+					b += a;
+
+					if (++count == BLOCK)
+					{
+						a %= MOD;
+						b %= MOD;
+						count = 0;
+					}
+				};
+
+				for (int y=0; y<image.Height(); y++)
+				{
+					auto *data	= (const byte *)image.Row(y).data;
+					size_t i	= 0;
+
+					// Complete any word left over from the previous row
+					for (; filled && i < line; i++)
+					{
+						word |= (uint32_t)data[i] << (8 * filled);
+
+						if (++filled == 4)
+						{
+							add(word);
+							word	= 0;
+							filled	= 0;
+						}
+					}
+
+					for (; i + 4 <= line; i += 4)
+					{
+						uint32_t w;
+						std::memcpy(&w, data + i, 4);
+						add(w);
+					}
+
+					for (; i < line; i++)
+					{
+						word |= (uint32_t)data[i] << (8 * filled++);
+					}
+				}
+
+				if (filled)
+				{
+					add(word);
+				}
+
+				return (b % MOD) << 32 | (a % MOD);
+			}
+
+
+		private:
+
+			static size_t Align(const size_t value, const size_t alignment)
+			{
+				return (value + alignment - 1) / alignment * alignment;
+			}
+
+
+			// Write all of the parts in order, coping with partial writes and the limit on the
+			// number of parts per call.
+			static bool Write(const int fd, std::vector<iovec> &parts)
+			{
+				off_t offset	= 0;
+				size_t i		= 0;
+
+				while (i < parts.size())
+				{
+					if (!parts[i].iov_len)
+					{
+						i++;
+						continue;
+					}
+
+					const auto written = pwritev(fd, parts.data() + i, std::min<size_t>(parts.size() - i, IOV_MAX), offset);
+
+					if (written < 0)
+					{
+						if (errno == EINTR) continue;
+						return false;
+					}
+
+					offset += written;
+
+					for (size_t remaining = written; remaining; )
+					{
+						const size_t n = std::min(remaining, parts[i].iov_len);
+
+						parts[i].iov_base	= (byte *)parts[i].iov_base + n;
+						parts[i].iov_len	-= n;
+						remaining			-= n;
+
+						if (!parts[i].iov_len) i++;
+					}
+				}
+
+				return true;
+			}
+	};
+
+
+	// A raw image file mapped into memory. Views of the pixel data refer directly to the mapping and
+	// so they are only valid while the file remains open. A file opened as writable is mapped shared,
+	// so changes made through a view are written back to the file.
+	//
+	//    image::RawFile file("panorama.raw");
+	//    auto view = file.View<byte>();
+	//    auto stats = view.Stats(image::par);
+	class RawFile
+	{
+		public:
+
+			RawFile() = default;
+
+			explicit RawFile(const std::string &path, const bool writable = false)
+			{
+				this->Open(path, writable);
+			}
+
+			RawFile(const RawFile &) = delete;
+			RawFile &operator=(const RawFile &) = delete;
+
+			RawFile(RawFile &&other)
+			{
+				*this = std::move(other);
+			}
+
+			RawFile &operator=(RawFile &&other)
+			{
+				std::swap(this->data, other.data);
+				std::swap(this->length, other.length);
+				std::swap(this->writable, other.writable);
+				return *this;
+			}
+
+			~RawFile()
+			{
+				this->Close();
+			}
+
+
+			// Map the file, returning false if it cannot be opened or is not a valid raw container
+			bool Open(const std::string &path, const bool writable = false)
+			{
+				this->Close();
+
+				const int fd = open(path.c_str(), (writable ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+
+				if (fd < 0)
+				{
+					return false;
+				}
+
+				struct stat info;
+
+				if (fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(RawHeader))
+				{
+					void *map = mmap(nullptr, info.st_size, writable ? PROT_READ | PROT_WRITE : PROT_READ, writable ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+
+					if (map != MAP_FAILED)
+					{
+						this->data		= (byte *)map;
+						this->length	= info.st_size;
+						this->writable	= writable;
+					}
+				}
+
+				close(fd);
+
+				if (this->data && !this->Valid())
+				{
+					this->Close();
+				}
+
+				return this->data;
+			}
+
+
+			void Close()
+			{
+				if (this->data)
+				{
+					munmap(this->data, this->length);
+					this->data		= nullptr;
+					this->length	= 0;
+				}
+			}
+
+
+			operator bool() const { return this->data; }
+
+
+			// The header of the open file
+			const RawHeader &Header() const
+			{
+				return *(const RawHeader *)this->data;
+			}
+
+
+			// A view of the pixel data, which is empty if the file is not open, the samples are not of
+			// type T or a writable view is requested of a read-only file.
+			template <typename T> ImageView<T> View() const
+			{
+				if (!this->data || !this->Header().template Holds<T>() || (!std::is_const_v<T> && !this->writable))
+				{
+					return {};
+				}
+
+				const auto &h = this->Header();
+
+				return { (T *)(this->data + h.offset), (int)h.width, (int)h.height, h.depth, h.stride };
+			}
+
+
+			// Check the pixel data against the checksum, a file without one is always valid
+			bool Verify() const
+			{
+				if (!this->data || !(this->Header().flags & RawHeader::CHECKSUM))
+				{
+					return this->data;
+				}
+
+				const auto &h = this->Header();
+
+				// Viewed as bytes since only the extent of each row matters
+				const ImageView<const byte> bytes(this->data + h.offset, h.width * h.depth * h.typesize, h.height, 1, h.stride);
+
+				return Raw::Checksum(bytes) == h.checksum;
+			}
+
+
+		private:
+
+			bool Valid() const
+			{
+				const auto &h		= this->Header();
+				const uint64_t line	= (uint64_t)h.width * h.depth * h.typesize;
+
+				return h.magic == RawHeader::MAGIC
+					&& h.version >= 1 && h.size >= sizeof(RawHeader)
+					&& h.depth && h.typesize && h.format <= RawHeader::Float
+					&& h.stride >= line && h.stride % h.typesize == 0
+					&& h.offset >= h.size && h.offset % h.typesize == 0
+					&& h.offset <= this->length && h.stride <= this->length
+					// Written as a division since the extent of the rows could overflow
+					&& (!h.stride || h.height <= (this->length - h.offset) / h.stride)
+					&& line <= INT_MAX && h.height <= INT_MAX && h.width <= INT_MAX;
+			}
+
+
+			byte *data		= nullptr;
+			size_t length	= 0;
+			bool writable	= false;
+	};
+}
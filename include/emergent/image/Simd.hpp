@@ -0,0 +1,763 @@
+#pragma once
+
+#include <limits>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <type_traits>
+
+
+namespace emergent::image::simd
+{
+	// Vectorised kernels for the point operations of ImageBase and the layout conversions of
+	// PlanarImage. The kernels are written once using the GCC/Clang vector extensions and compiled
+	// for each instruction set, the best of which is selected at runtime from the CPUID flags.
+	// Saturating arithmetic is used in place of clamping and any remainder that does not fill a
+	// vector is handled by a scalar loop.
+	//
+	// Only byte, uint16_t and float data are supported, ImageBase falls back to the scalar
+	// implementations for other types.
+
+
+	// Instruction sets in order of preference
+	enum class Isa
+	{
+		Sse2,		// Also used for the 128-bit vectors of other architectures such as NEON
+		Avx2,
+		Avx512
+	};
+
+
+	template <typename T> constexpr bool Supported = std::is_same_v<T, uint8_t> || std::is_same_v<T, uint16_t> || std::is_same_v<T, float>;
+
+	// Types that also support the bitwise and saturating operations
+	template <typename T> constexpr bool Integral = Supported<T> && std::is_integral_v<T>;
+
+
+	// Moments of a set of samples. For the integral types the sums are exact, which holds for up to
+	// 2^32 samples of 16-bit data. For float they are sums of the differences from the shift, which
+	// should be close to the mean so that the variance does not suffer from cancellation.
+	template <typename T> struct Moments
+	{
+		using A = std::conditional_t<std::is_integral_v<T>, std::uint64_t, double>;
+
+		T min		= std::numeric_limits<T>::max();
+		T max		= std::numeric_limits<T>::lowest();
+		A sum		= 0;
+		A squared	= 0;
+		T shift		= 0;
+	};
+
+
+	// Unsigned integers of the same size as T, used for masks
+	template <typename T> using Bits = std::conditional_t<sizeof(T) == 1, std::uint8_t, std::conditional_t<sizeof(T) == 2, std::uint16_t, std::uint32_t>>;
+
+
+	// The best instruction set available on this CPU, which is only detected once.
+	inline Isa Detect()
+	{
+		#if defined(__x86_64__) || defined(__i386__)
+			static const Isa isa = __builtin_cpu_supports("avx512bw") ? Isa::Avx512
+				: __builtin_cpu_supports("avx2") ? Isa::Avx2
+				: Isa::Sse2;
+		#else
+			static const Isa isa = Isa::Sse2;
+		#endif
+
+		return isa;
+	}
+
+
+	// The kernels for vectors of W bytes. Everything is inlined into the dispatching function
+	// for an instruction set, so the vector types are lowered to the registers of that set.
+	template <std::size_t W, typename T> struct Kernel
+	{
+		typedef T V __attribute__((vector_size(W)));
+
+		// Unaligned vector used to load and store the data, which may alias the element type
+		typedef T U __attribute__((vector_size(W), aligned(sizeof(T)), may_alias));
+
+		// Comparisons produce a mask vector of signed integers (E) the same size as T
+		using M = decltype(V {} < V {});
+		using E = std::conditional_t<sizeof(T) == 1, int8_t, std::conditional_t<sizeof(T) == 2, int16_t, int32_t>>;
+
+		// Number of elements in a vector
+		static constexpr std::size_t N = W / sizeof(T);
+
+		// There are deliberately no helper functions that take or return vectors by value, since
+		// the compiler warns about their ABI wherever the kernels are instantiated.
+
+
+		static void Threshold(T *data, const std::size_t size, const T threshold, const T high, const T low)
+		{
+			const V t = V {} + threshold, h = V {} + high, l = V {} + low;
+			std::size_t i = 0;
+
+			for (; i + N <= size; i += N)
+			{
+				const V v = *(const U *)(data + i);
+				*(U *)(data + i) = v < t ? l : h;
+			}
+
+			for (; i < size; i++)
+			{
+				data[i] = data[i] < threshold ? low : high;
+			}
+		}
+
+
+		static void Clamp(T *data, const std::size_t size, const T lower, const T upper)
+		{
+			const V l = V {} + lower, u = V {} + upper;
+			std::size_t i = 0;
+
+			for (; i + N <= size; i += N)
+			{
+				const V v = *(const U *)(data + i);
+				const V c = v < l ? l : v;
+				*(U *)(data + i) = u < c ? u : c;
+			}
+
+			for (; i < size; i++)
+			{
+				data[i] = data[i] < lower ? lower : (upper < data[i] ? upper : data[i]);
+			}
+		}
+
+
+		// Add (or subtract if negative) a value with saturation, integral types only. For the
+		// addition the headroom is ~v, so adding the smaller of that and the value saturates.
+		static void Shift(T *data, const std::size_t size, const long value)
+		{
+			const T magnitude	= (T)std::min<unsigned long>(value < 0 ? -(unsigned long)value : value, std::numeric_limits<T>::max());
+			const V m			= V {} + magnitude;
+			std::size_t i		= 0;
+
+			if (value >= 0)
+			{
+				for (; i + N <= size; i += N)
+				{
+					const V v = *(const U *)(data + i);
+					const V h = ~v;
+					*(U *)(data + i) = v + (h < m ? h : m);
+				}
+
+				for (; i < size; i++)
+				{
+					data[i] += std::min<T>((T)~data[i], magnitude);
+				}
+			}
+			else
+			{
+				for (; i + N <= size; i += N)
+				{
+					const V v = *(const U *)(data + i);
+					*(U *)(data + i) = v - (v < m ? v : m);
+				}
+
+				for (; i < size; i++)
+				{
+					data[i] -= std::min<T>(data[i], magnitude);
+				}
+			}
+		}
+
+
+		// Bitwise operations, integral types only. The operator is one of '~', '|' or '&' where
+		// the modifier is ignored for '~'.
+		template <char O> static void Bitwise(T *data, const T *modifier, const std::size_t size)
+		{
+			std::size_t i = 0;
+
+			for (; i + N <= size; i += N)
+			{
+				const V v = *(const U *)(data + i);
+
+				if constexpr (O == '|')			*(U *)(data + i) = v | *(const U *)(modifier + i);
+				else if constexpr (O == '&')	*(U *)(data + i) = v & *(const U *)(modifier + i);
+				else							*(U *)(data + i) = ~v;
+			}
+
+			for (; i < size; i++)
+			{
+				if constexpr (O == '|')			data[i] |= modifier[i];
+				else if constexpr (O == '&')	data[i] &= modifier[i];
+				else							data[i] = ~data[i];
+			}
+		}
+
+
+		// The smallest and largest values. The size must not be zero.
+		static std::pair<T, T> Range(const T *data, const std::size_t size)
+		{
+			T low			= data[0];
+			T high			= data[0];
+			std::size_t i	= 0;
+
+			if (size >= N)
+			{
+				V l = *(const U *)data;
+				V h = l;
+
+				for (i = N; i + N <= size; i += N)
+				{
+					const V v = *(const U *)(data + i);
+					l = v < l ? v : l;
+					h = h < v ? v : h;
+				}
+
+				for (std::size_t j=0; j<N; j++)
+				{
+					low		= std::min<T>(low, l[j]);
+					high	= std::max<T>(high, h[j]);
+				}
+			}
+
+			for (; i < size; i++)
+			{
+				low		= std::min(low, data[i]);
+				high	= std::max(high, data[i]);
+			}
+
+			return { low, high };
+		}
+
+
+		// Count the elements equal to the value. Each match adds -1 to a lane of the accumulator
+		// which is flushed before it can overflow.
+		static std::size_t Count(const T *data, const std::size_t size, const T value)
+		{
+			constexpr std::size_t LIMIT = std::min<std::size_t>(std::numeric_limits<E>::max(), 1 << 20);
+
+			const V s			= V {} + value;
+			std::size_t result	= 0;
+			std::size_t i		= 0;
+
+			while (i + N <= size)
+			{
+				M a = {};
+
+				for (std::size_t j=0; j<LIMIT && i + N <= size; j++, i += N)
+				{
+					a += *(const U *)(data + i) == s;
+				}
+
+				for (std::size_t j=0; j<N; j++)
+				{
+					result -= a[j];
+				}
+			}
+
+			for (; i < size; i++)
+			{
+				result += data[i] == value;
+			}
+
+			return result;
+		}
+
+
+		// Check whether every element equals the value, exiting early once a difference is found.
+		static bool Uniform(const T *data, const std::size_t size, const T value)
+		{
+			constexpr std::size_t BLOCK = 16;
+
+			const V s		= V {} + value;
+			std::size_t i	= 0;
+
+			while (i + N <= size)
+			{
+				M a = {};
+
+				for (std::size_t j=0; j<BLOCK && i + N <= size; j++, i += N)
+				{
+					a |= *(const U *)(data + i) != s;
+				}
+
+				for (std::size_t j=0; j<N; j++)
+				{
+					if (a[j]) return false;
+				}
+			}
+
+			for (; i < size; i++)
+			{
+				if (data[i] != value) return false;
+			}
+
+			return true;
+		}
+
+
+		// Accumulate the moments of the samples. A mask, if given, has an element for each sample
+		// which is either zero or all bits set, where only the samples with bits set are included.
+		//
+		// The integral samples are loaded as 32-bit lanes and extracted with shifts, since widening
+		// them by conversion needs several shuffles per vector. The sums of each block of lanes are
+		// flushed before they can overflow. Float samples are accumulated as doubles.
+		static void Accumulate(const T *data, const Bits<T> *mask, const std::size_t size, Moments<T> &result)
+		{
+			Accumulate(data, mask, size, result, std::make_index_sequence<N / 2> {});
+		}
+
+
+		// Split pixels of D interleaved channels, where D is 2, 3 or 4, into a plane per channel.
+		// Each vector of a plane is gathered from D consecutive vectors of the source with shuffles.
+		template <std::size_t D> static void Deinterleave(const T *src, T *const *dst, const std::size_t pixels)
+		{
+			Deinterleave<D>(src, dst, pixels, std::make_index_sequence<N> {});
+		}
+
+
+		// Merge a plane per channel into pixels of D interleaved channels, the inverse of the above.
+		template <std::size_t D> static void Interleave(const T *const *src, T *dst, const std::size_t pixels)
+		{
+			Interleave<D>(src, dst, pixels, std::make_index_sequence<N> {});
+		}
+
+
+		private:
+
+			// Vectors used to accumulate moments: masks of the same width as T, 32-bit lanes, half
+			// vectors and 64-bit lanes.
+			typedef Bits<T> I __attribute__((vector_size(W)));
+			typedef Bits<T> IU __attribute__((vector_size(W), aligned(sizeof(T)), may_alias));
+			typedef std::uint32_t Q __attribute__((vector_size(W)));
+			typedef T H __attribute__((vector_size(W / 2)));
+			typedef std::uint64_t L64 __attribute__((vector_size(W)));
+			typedef double F64 __attribute__((vector_size(W)));
+
+
+			// Add the elements of a vector to the total. This is a template so that GCC accepts
+			// vectors with a dependent size.
+			template <typename X, typename R> static void Total(const X &x, R &total)
+			{
+				for (std::size_t j=0; j<sizeof(X) / sizeof(x[0]); j++)
+				{
+					total += x[j];
+				}
+			}
+
+
+			// Shuffle indices for gathering channel k of lane j. Three channels are gathered from the
+			// first two vectors and then filled in from the third, four channels are gathered from
+			// each pair of vectors into the lower half and the halves are then joined.
+			static constexpr int First(const std::size_t j, const std::size_t k)
+			{
+				return 3 * j + k < 2 * N ? (int)(3 * j + k) : -1;
+			}
+
+			static constexpr int Second(const std::size_t j, const std::size_t k)
+			{
+				return 3 * j + k < 2 * N ? (int)j : (int)(N + 3 * j + k - 2 * N);
+			}
+
+			static constexpr int Lower(const std::size_t j, const std::size_t k)
+			{
+				return j < N / 2 ? (int)(4 * j + k) : -1;
+			}
+
+			static constexpr int Join(const std::size_t j)
+			{
+				return j < N / 2 ? (int)j : (int)(N + j - N / 2);
+			}
+
+
+			// Shuffle indices for lane i of output vector m when interleaving. Sample g of the output
+			// is channel g % D of pixel g / D, where the pixel is the lane of that channel's vector.
+			// Pairs of channels (c, c + 1) are merged first and the result is completed from the rest.
+			static constexpr int Pair(const std::size_t d, const std::size_t m, const std::size_t i, const std::size_t c)
+			{
+				const std::size_t g = m * N + i;
+				return g % d == c ? (int)(g / d) : g % d == c + 1 ? (int)(N + g / d) : -1;
+			}
+
+			static constexpr int Fill(const std::size_t m, const std::size_t i)
+			{
+				const std::size_t g = m * N + i;
+				return g % 3 < 2 ? (int)i : (int)(N + g / 3);
+			}
+
+			static constexpr int Merge(const std::size_t m, const std::size_t i)
+			{
+				const std::size_t g = m * N + i;
+				return g % 4 < 2 ? (int)i : (int)(N + i);
+			}
+
+
+			template <std::size_t... L> static void Accumulate(const T *data, const Bits<T> *mask, const std::size_t size, Moments<T> &result, std::index_sequence<L...>)
+			{
+				const bool masked	= mask;
+				V low				= V {} + result.min;
+				V high				= V {} + result.max;
+				std::size_t i		= 0;
+
+				// Masked samples are replaced by the limits of the type, or by zero, so that they
+				// never change the extremes or the sums.
+				auto load = [&](V &v, V &lower, V &upper) {
+					v = *(const U *)(data + i);
+
+					if (masked)
+					{
+						const I m = *(const IU *)(mask + i);
+
+						lower	= (V)(((I)v & m) | ((I)(V {} + std::numeric_limits<T>::max()) & ~m));
+						upper	= (V)(((I)v & m) | ((I)(V {} + std::numeric_limits<T>::lowest()) & ~m));
+					}
+					else
+					{
+						lower = upper = v;
+					}
+
+					low		= lower < low ? lower : low;
+					high	= high < upper ? upper : high;
+				};
+
+				if constexpr (std::is_integral_v<T>)
+				{
+					using D = L64;
+
+					constexpr std::size_t P		= 4 / sizeof(T);
+					constexpr std::uint32_t ONE	= (1ull << (8 * sizeof(T))) - 1;
+					constexpr std::size_t BLOCK	= 4096;
+
+					while (i + N <= size)
+					{
+						Q s = {}, q = {};
+						D wide = {};
+
+						for (std::size_t j=0; j<BLOCK && i + N <= size; j++, i += N)
+						{
+							V v, lower, upper;
+							load(v, lower, upper);
+
+							// Masked samples are zero, which is also the lowest value of the unsigned types
+							const Q x = (Q)upper;
+
+							for (std::size_t k=0; k<P; k++)
+							{
+								const Q b = (x >> (8 * sizeof(T) * k)) & ONE;
+								s += b;
+
+								// The square of a 16-bit sample only just fits so it is widened immediately
+								if constexpr (sizeof(T) == 1)	q += b * b;
+								else							wide += ((D)(b * b) & 0xffffffff) + ((D)(b * b) >> 32);
+							}
+						}
+
+						Total(s, result.sum);
+						Total(q, result.squared);
+						Total(wide, result.squared);
+					}
+
+					for (; i < size; i++)
+					{
+						if (!mask || mask[i])
+						{
+							result.sum		+= data[i];
+							result.squared	+= (std::uint64_t)data[i] * data[i];
+						}
+					}
+				}
+				else
+				{
+					using D = F64;
+
+					const V shift = V {} + result.shift;
+					D s = {}, q = {};
+
+					for (; i + N <= size; i += N)
+					{
+						V v, lower, upper;
+						load(v, lower, upper);
+
+						V d = v - shift;
+
+						if (masked)
+						{
+							d = (V)((I)d & *(const IU *)(mask + i));
+						}
+
+						const D a = __builtin_convertvector((H)__builtin_shufflevector(d, d, L...), D);
+						const D b = __builtin_convertvector((H)__builtin_shufflevector(d, d, (L + N / 2)...), D);
+
+						s += a + b;
+						q += a * a + b * b;
+					}
+
+					Total(s, result.sum);
+					Total(q, result.squared);
+
+					for (; i < size; i++)
+					{
+						if (!mask || mask[i])
+						{
+							const double d	= (double)data[i] - result.shift;
+							result.sum		+= d;
+							result.squared	+= d * d;
+						}
+					}
+				}
+
+				for (std::size_t j=0; j<N; j++)
+				{
+					result.min = std::min<T>(result.min, low[j]);
+					result.max = std::max<T>(result.max, high[j]);
+				}
+
+				for (i = size - size % N; i < size; i++)
+				{
+					if (!mask || mask[i])
+					{
+						result.min = std::min(result.min, data[i]);
+						result.max = std::max(result.max, data[i]);
+					}
+				}
+			}
+
+
+			template <std::size_t D, std::size_t... L> static void Deinterleave(const T *src, T *const *dst, const std::size_t pixels, std::index_sequence<L...>)
+			{
+				static_assert(D >= 2 && D <= 4, "Only 2, 3 or 4 channels are supported");
+
+				std::size_t i = 0;
+
+				for (; i + N <= pixels; i += N, src += D * N)
+				{
+					V p[D];
+
+					for (std::size_t k=0; k<D; k++)
+					{
+						p[k] = *(const U *)(src + k * N);
+					}
+
+					if constexpr (D == 2)
+					{
+						*(U *)(dst[0] + i) = __builtin_shufflevector(p[0], p[1], (2 * L)...);
+						*(U *)(dst[1] + i) = __builtin_shufflevector(p[0], p[1], (2 * L + 1)...);
+					}
+					else if constexpr (D == 3)
+					{
+						*(U *)(dst[0] + i) = __builtin_shufflevector(__builtin_shufflevector(p[0], p[1], First(L, 0)...), p[2], Second(L, 0)...);
+						*(U *)(dst[1] + i) = __builtin_shufflevector(__builtin_shufflevector(p[0], p[1], First(L, 1)...), p[2], Second(L, 1)...);
+						*(U *)(dst[2] + i) = __builtin_shufflevector(__builtin_shufflevector(p[0], p[1], First(L, 2)...), p[2], Second(L, 2)...);
+					}
+					else
+					{
+						*(U *)(dst[0] + i) = __builtin_shufflevector(__builtin_shufflevector(p[0], p[1], Lower(L, 0)...), __builtin_shufflevector(p[2], p[3], Lower(L, 0)...), Join(L)...);
+						*(U *)(dst[1] + i) = __builtin_shufflevector(__builtin_shufflevector(p[0], p[1], Lower(L, 1)...), __builtin_shufflevector(p[2], p[3], Lower(L, 1)...), Join(L)...);
+						*(U *)(dst[2] + i) = __builtin_shufflevector(__builtin_shufflevector(p[0], p[1], Lower(L, 2)...), __builtin_shufflevector(p[2], p[3], Lower(L, 2)...), Join(L)...);
+						*(U *)(dst[3] + i) = __builtin_shufflevector(__builtin_shufflevector(p[0], p[1], Lower(L, 3)...), __builtin_shufflevector(p[2], p[3], Lower(L, 3)...), Join(L)...);
+					}
+				}
+
+				for (; i < pixels; i++, src += D)
+				{
+					for (std::size_t k=0; k<D; k++)
+					{
+						dst[k][i] = src[k];
+					}
+				}
+			}
+
+
+			template <std::size_t D, std::size_t... L> static void Interleave(const T *const *src, T *dst, const std::size_t pixels, std::index_sequence<L...>)
+			{
+				static_assert(D >= 2 && D <= 4, "Only 2, 3 or 4 channels are supported");
+
+				std::size_t i = 0;
+
+				for (; i + N <= pixels; i += N, dst += D * N)
+				{
+					V c[D];
+
+					for (std::size_t k=0; k<D; k++)
+					{
+						c[k] = *(const U *)(src[k] + i);
+					}
+
+					if constexpr (D == 2)
+					{
+						*(U *)dst		= __builtin_shufflevector(c[0], c[1], Pair(2, 0, L, 0)...);
+						*(U *)(dst + N)	= __builtin_shufflevector(c[0], c[1], Pair(2, 1, L, 0)...);
+					}
+					else if constexpr (D == 3)
+					{
+						*(U *)dst			= __builtin_shufflevector(__builtin_shufflevector(c[0], c[1], Pair(3, 0, L, 0)...), c[2], Fill(0, L)...);
+						*(U *)(dst + N)		= __builtin_shufflevector(__builtin_shufflevector(c[0], c[1], Pair(3, 1, L, 0)...), c[2], Fill(1, L)...);
+						*(U *)(dst + 2 * N)	= __builtin_shufflevector(__builtin_shufflevector(c[0], c[1], Pair(3, 2, L, 0)...), c[2], Fill(2, L)...);
+					}
+					else
+					{
+						*(U *)dst			= __builtin_shufflevector(__builtin_shufflevector(c[0], c[1], Pair(4, 0, L, 0)...), __builtin_shufflevector(c[2], c[3], Pair(4, 0, L, 2)...), Merge(0, L)...);
+						*(U *)(dst + N)		= __builtin_shufflevector(__builtin_shufflevector(c[0], c[1], Pair(4, 1, L, 0)...), __builtin_shufflevector(c[2], c[3], Pair(4, 1, L, 2)...), Merge(1, L)...);
+						*(U *)(dst + 2 * N)	= __builtin_shufflevector(__builtin_shufflevector(c[0], c[1], Pair(4, 2, L, 0)...), __builtin_shufflevector(c[2], c[3], Pair(4, 2, L, 2)...), Merge(2, L)...);
+						*(U *)(dst + 3 * N)	= __builtin_shufflevector(__builtin_shufflevector(c[0], c[1], Pair(4, 3, L, 0)...), __builtin_shufflevector(c[2], c[3], Pair(4, 3, L, 2)...), Merge(3, L)...);
+					}
+				}
+
+				for (; i < pixels; i++, dst += D)
+				{
+					for (std::size_t k=0; k<D; k++)
+					{
+						dst[k] = src[k][i];
+					}
+				}
+			}
+	};
+
+
+	// Entry points for each instruction set. Flattening inlines the kernel, and everything it
+	// calls, so that the whole operation is compiled for that instruction set.
+	template <typename F> [[gnu::flatten]] inline decltype(auto) Generic(F &&kernel)
+	{
+		return kernel(std::integral_constant<std::size_t, 16> {});
+	}
+
+	#if defined(__x86_64__) || defined(__i386__)
+		template <typename F> [[gnu::target("avx2"), gnu::flatten]] inline decltype(auto) Avx2(F &&kernel)
+		{
+			return kernel(std::integral_constant<std::size_t, 32> {});
+		}
+
+		template <typename F> [[gnu::target("avx512bw"), gnu::flatten]] inline decltype(auto) Avx512(F &&kernel)
+		{
+			return kernel(std::integral_constant<std::size_t, 64> {});
+		}
+	#endif
+
+
+	// Run the kernel with the given instruction set, which must be supported by this CPU.
+	template <typename F> decltype(auto) Run(const Isa isa, F &&kernel)
+	{
+		#if defined(__x86_64__) || defined(__i386__)
+			switch (isa)
+			{
+				case Isa::Avx512:	return Avx512(kernel);
+				case Isa::Avx2:		return Avx2(kernel);
+				default:			return Generic(kernel);
+			}
+		#else
+			return Generic(kernel);
+		#endif
+	}
+
+
+	// The operations are available with an explicit instruction set so that each of them can be
+	// tested against the scalar implementations, otherwise the detected one is used.
+
+	template <typename T> void Threshold(T *data, const std::size_t size, const T threshold, const T high, const T low, const Isa isa = Detect())
+	{
+		Run(isa, [&](auto w) { Kernel<w, T>::Threshold(data, size, threshold, high, low); });
+	}
+
+	template <typename T> void Clamp(T *data, const std::size_t size, const T lower, const T upper, const Isa isa = Detect())
+	{
+		Run(isa, [&](auto w) { Kernel<w, T>::Clamp(data, size, lower, upper); });
+	}
+
+	template <typename T> void Shift(T *data, const std::size_t size, const long value, const Isa isa = Detect())
+	{
+		static_assert(Integral<T>);
+		Run(isa, [&](auto w) { Kernel<w, T>::Shift(data, size, value); });
+	}
+
+	template <typename T> void Invert(T *data, const std::size_t size, const Isa isa = Detect())
+	{
+		static_assert(Integral<T>);
+		Run(isa, [&](auto w) { Kernel<w, T>::template Bitwise<'~'>(data, nullptr, size); });
+	}
+
+	template <typename T> void Or(T *data, const T *modifier, const std::size_t size, const Isa isa = Detect())
+	{
+		static_assert(Integral<T>);
+		Run(isa, [&](auto w) { Kernel<w, T>::template Bitwise<'|'>(data, modifier, size); });
+	}
+
+	template <typename T> void And(T *data, const T *modifier, const std::size_t size, const Isa isa = Detect())
+	{
+		static_assert(Integral<T>);
+		Run(isa, [&](auto w) { Kernel<w, T>::template Bitwise<'&'>(data, modifier, size); });
+	}
+
+	// The smallest and largest values, the size must not be zero
+	template <typename T> std::pair<T, T> MinMax(const T *data, const std::size_t size, const Isa isa = Detect())
+	{
+		return Run(isa, [&](auto w) { return Kernel<w, T>::Range(data, size); });
+	}
+
+	// The size must not be zero
+	template <typename T> T Max(const T *data, const std::size_t size, const Isa isa = Detect())
+	{
+		return MinMax(data, size, isa).second;
+	}
+
+	// The size must not be zero
+	template <typename T> T Min(const T *data, const std::size_t size, const Isa isa = Detect())
+	{
+		return MinMax(data, size, isa).first;
+	}
+
+	template <typename T> std::size_t Count(const T *data, const std::size_t size, const T value, const Isa isa = Detect())
+	{
+		return Run(isa, [&](auto w) { return Kernel<w, T>::Count(data, size, value); });
+	}
+
+	template <typename T> bool Uniform(const T *data, const std::size_t size, const T value, const Isa isa = Detect())
+	{
+		return Run(isa, [&](auto w) { return Kernel<w, T>::Uniform(data, size, value); });
+	}
+
+	// Accumulate the moments of the samples, where a mask (which may be null) selects those with
+	// all bits set. The shift of the result must already be set for float samples.
+	template <typename T> void Accumulate(const T *data, const Bits<T> *mask, const std::size_t size, Moments<T> &result, const Isa isa = Detect())
+	{
+		Run(isa, [&](auto w) { Kernel<w, T>::Accumulate(data, mask, size, result); });
+	}
+
+	// Split interleaved pixels into a plane per channel, or merge them back again. The shuffles
+	// are only used for the supported types with 2, 3 or 4 channels, anything else is copied
+	// sample by sample.
+	template <typename T> void Deinterleave(const T *src, T *const *dst, const std::size_t pixels, const std::size_t depth, const Isa isa = Detect())
+	{
+		if constexpr (Supported<T>)
+		{
+			switch (depth)
+			{
+				case 2:	return Run(isa, [&](auto w) { Kernel<w, T>::template Deinterleave<2>(src, dst, pixels); });
+				case 3:	return Run(isa, [&](auto w) { Kernel<w, T>::template Deinterleave<3>(src, dst, pixels); });
+				case 4:	return Run(isa, [&](auto w) { Kernel<w, T>::template Deinterleave<4>(src, dst, pixels); });
+			}
+		}
+
+		for (std::size_t i=0; i<pixels; i++, src += depth)
+		{
+			for (std::size_t k=0; k<depth; k++)
+			{
+				dst[k][i] = src[k];
+			}
+		}
+	}
+
+	template <typename T> void Interleave(const T *const *src, T *dst, const std::size_t pixels, const std::size_t depth, const Isa isa = Detect())
+	{
+		if constexpr (Supported<T>)
+		{
+			switch (depth)
+			{
+				case 2:	return Run(isa, [&](auto w) { Kernel<w, T>::template Interleave<2>(src, dst, pixels); });
+				case 3:	return Run(isa, [&](auto w) { Kernel<w, T>::template Interleave<3>(src, dst, pixels); });
+				case 4:	return Run(isa, [&](auto w) { Kernel<w, T>::template Interleave<4>(src, dst, pixels); });
+			}
+		}
+
+		for (std::size_t i=0; i<pixels; i++, dst += depth)
+		{
+			for (std::size_t k=0; k<depth; k++)
+			{
+				dst[k] = src[k][i];
+			}
+		}
+	}
+}
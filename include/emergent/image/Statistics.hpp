@@ -0,0 +1,189 @@
+#pragma once
+
+#include <emergent/image/Simd.hpp>
+#include <emergent/struct/Distribution.hpp>
+
+#include <bit>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+
+
+namespace emergent::image::internal
+{
+	// Accumulates the statistics of spans of samples, which are converted to a distribution once
+	// complete. The supported types are accumulated by the vectorised kernel, exactly in the case of
+	// integers, so spans can be added in any order without affecting the result. Other types fall
+	// back to merging the distribution of each span.
+	template <typename T> class Statistics
+	{
+		public:
+
+			// Elements of a mask, which have all bits set for the samples to include
+			using M = std::conditional_t<simd::Supported<T>, simd::Bits<T>, byte>;
+
+
+			// Add all of the samples
+			void Add(const T *data, const size_t size)
+			{
+				if (!size)
+				{
+					return;
+				}
+
+				if constexpr (simd::Supported<T>)
+				{
+					this->Start(data);
+					simd::Accumulate(data, (const simd::Bits<T> *)nullptr, size, this->moments);
+					this->count += size;
+				}
+				else
+				{
+					this->other.merge(distribution(data, size));
+				}
+			}
+
+
+			// Add the samples selected by a mask from Expand, where the number of selected samples is given
+			void Add(const T *data, const size_t size, const M *mask, const size_t selected)
+			{
+				if (selected == size)
+				{
+					return this->Add(data, size);
+				}
+
+				if (!selected)
+				{
+					return;
+				}
+
+				if constexpr (simd::Supported<T>)
+				{
+					this->Start(data);
+					simd::Accumulate(data, mask, size, this->moments);
+					this->count += selected;
+				}
+				else
+				{
+					this->other.merge(distribution(data, size, (M *)mask));
+				}
+			}
+
+
+			// Expand the bits of `size` samples into a mask, with all bits set for the selected samples,
+			// where the first sample corresponds to bit 0 of the first word. Any bits beyond the size must
+			// be clear. Returns the number of selected samples. The mask can be shared by the accumulators
+			// of every channel.
+			static size_t Expand(const uint64_t *bits, const size_t size, std::vector<M> &mask)
+			{
+				const size_t words	= (size + 63) / 64;
+				size_t selected		= 0;
+
+				for (size_t w=0; w<words; w++)
+				{
+					selected += std::popcount(bits[w]);
+				}
+
+				// The mask is not used when all or none of the samples are selected
+				if (selected == size || !selected)
+				{
+					return selected;
+				}
+
+				mask.resize(words * 64);
+
+				for (size_t w=0; w<words; w++)
+				{
+					for (size_t b=0; b<8; b++)
+					{
+						// Spread each bit of the byte into a byte of its own, which is then all bits set or clear
+						uint64_t spread = (bits[w] >> (8 * b) & 0xff) * 0x0101010101010101ull & 0x8040201008040201ull;
+						spread = (((spread + 0x7f7f7f7f7f7f7f7full) | spread) >> 7 & 0x0101010101010101ull) * 0xff;
+
+						M *dst = mask.data() + w * 64 + b * 8;
+
+						if constexpr (sizeof(M) == 1 && std::endian::native == std::endian::little)
+						{
+							std::memcpy(dst, &spread, 8);
+						}
+						else
+						{
+							for (size_t k=0; k<8; k++)
+							{
+								dst[k] = (M)(int8_t)(spread >> (8 * k));
+							}
+						}
+					}
+				}
+
+				return selected;
+			}
+
+
+			distribution Result() const
+			{
+				if constexpr (simd::Supported<T>)
+				{
+					distribution result;
+
+					if (!this->count)
+					{
+						return result;
+					}
+
+					const auto &m	= this->moments;
+					const double n	= this->count;
+
+					result.samples	= n;
+					result.min		= m.min;
+					result.max		= m.max;
+
+					if constexpr (std::is_integral_v<T>)
+					{
+						// The centred sum of squares, n * squared - sum², is exact in 128 bits
+						__extension__ using Wide = unsigned __int128;
+
+						const Wide s = m.sum;
+						const Wide c = (Wide)this->count * m.squared - s * s;
+
+						result.sum		= m.sum;
+						result.squared	= m.squared;
+						result.mean		= m.sum / n;
+						result.variance	= (double)c / n / n;
+					}
+					else
+					{
+						const double shift = m.shift;
+
+						result.mean		= shift + m.sum / n;
+						result.variance	= std::max((m.squared - m.sum * m.sum / n) / n, 0.0);
+						result.sum		= shift * n + m.sum;
+						result.squared	= m.squared + shift * (2.0 * m.sum + shift * n);
+					}
+
+					return result;
+				}
+				else
+				{
+					return this->other;
+				}
+			}
+
+
+		private:
+
+			// Float samples are accumulated relative to the first one
+			void Start(const T *data)
+			{
+				if (!this->count)
+				{
+					this->moments.shift = std::is_integral_v<T> ? 0 : *data;
+				}
+			}
+
+
+			simd::Moments<T> moments;
+			size_t count = 0;
+			distribution other;
+	};
+}
@@ -23,7 +23,7 @@ namespace emergent { namespace image
 		// and provide a pointer to the current position which gives access to all channels.
 		image::Iterator<T> Row(const int y)
 		{
-			return y >= 0 && y < height
+			return y >= 0 && (size_t)y < this->height
 				? image::Iterator<T>(this->data + y * this->row, this->width, this->depth)
 				: image::Iterator<T>();
 		}
@@ -32,7 +32,7 @@ namespace emergent { namespace image
 		// and provide a pointer to the current position which gives access to all channels.
 		image::Iterator<const T> Row(const int y) const
 		{
-			return y >= 0 && y < this->height
+			return y >= 0 && (size_t)y < this->height
 				? image::Iterator<const T>(this->data + y * this->row, this->width, this->depth)
 				: image::Iterator<const T>();
 		}
@@ -41,7 +41,7 @@ namespace emergent { namespace image
 		// and provide a pointer to the current position which gives access to all channels.
 		image::Iterator<T> Columns(const int x)
 		{
-			return x >= 0 && x < this->width
+			return x >= 0 && (size_t)x < this->width
 				? image::Iterator<T>(this->data + x * this->depth, this->height, this->row)
 				: image::Iterator<T>();
 		}
@@ -50,7 +50,7 @@ namespace emergent { namespace image
 		// and provide a pointer to the current position which gives access to all channels.
 		image::Iterator<const T> Columns(const int x) const
 		{
-			return x >= 0 && x < this->width
+			return x >= 0 && (size_t)x < this->width
 				? image::Iterator<const T>(this->data + x * this->depth, this->height, this->row)
 				: image::Iterator<const T>();
 		}
@@ -6,6 +6,7 @@
 #include <emergent/concurrentqueue.h>
 #include <emergent/logger/Sinks.hpp>
 #include <emergent/String.hpp>
+#include <emergent/thread/Attributes.hpp>
 
 
 namespace emergent
@@ -61,6 +62,14 @@ namespace emergent
 			}
 
 
+			// Set the attributes of the logging thread, for example to keep it away from the cores
+			// used by latency critical threads. This must be done before initialisation.
+			static void Attributes(const ThreadAttributes &attributes)
+			{
+				Instance().attributes = attributes;
+			}
+
+
 			// Return the current verbosity setting
 			static Severity Verbosity()
 			{
@@ -150,6 +159,8 @@ namespace emergent
 				Item last;
 				int count = 0;
 
+				this->attributes.Apply();
+
 				while (this->run)
 				{
 					// Only sleep if there is nothing in the queue
@@ -195,5 +206,6 @@ namespace emergent
 			// Threading members
 			std::atomic<bool> run;
 			std::thread thread;
+			ThreadAttributes attributes;
 	};
 }
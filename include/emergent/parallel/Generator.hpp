@@ -5,7 +5,8 @@
 namespace emergent
 {
 	// Lazy generation of an integral number sequence. Useful for the C++17 parallel execution functions
-	// when dealing with images since it avoids creating lookup vectors.
+	// when dealing with images since it avoids creating lookup vectors. It is also used by
+	// ParallelFor and ParallelReduce (Parallel.hpp) which do not depend on std::execution.
 	template <typename T> struct Generator
 	{
 		static_assert(std::is_integral_v<T>, "Generator must use an integral type");
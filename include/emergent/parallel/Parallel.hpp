@@ -0,0 +1,246 @@
+#pragma once
+
+#include <emergent/parallel/Generator.hpp>
+#include <emergent/thread/Pool.hpp>
+#include <exception>
+#include <vector>
+
+
+namespace emergent
+{
+	// How a range is divided into chunks for parallel execution.
+	//   Static:	The range is split into one equally sized chunk per participating
+	//				thread (the pool workers plus the calling thread).
+	//   Dynamic:	The range is split into many smaller chunks of "grain" elements
+	//				which are claimed by threads as they become free, which balances
+	//				the load when the cost per element varies.
+	enum class Chunking
+	{
+		Static,
+		Dynamic
+	};
+
+
+	struct Partition
+	{
+		Chunking chunking	= Chunking::Dynamic;
+		std::size_t grain	= 0;	// Minimum number of elements (or rows/columns of a tile) per chunk, 0 is automatic
+	};
+
+
+	namespace internal
+	{
+		// Invoke body(i) for every chunk index in [0, chunks) using the calling thread and
+		// up to one helper job per pool worker. Chunks are claimed through an atomic counter
+		// so the calling thread will always make progress, even if the pool is saturated or
+		// this is called from within one of its own jobs. Returns once all chunks have been
+		// processed and rethrows the first exception thrown by the body (if any).
+		template <typename F> void Distribute(Executor &pool, const std::size_t chunks, F &&body)
+		{
+			if (chunks < 2)
+			{
+				if (chunks) body(0);
+				return;
+			}
+
+			struct State
+			{
+				std::atomic<std::size_t> next	= 0;
+				std::atomic<std::size_t> done	= 0;
+				std::atomic<bool> failed		= false;
+				std::exception_ptr error;
+			};
+
+			// Helper jobs may be started after this function has returned (once all of the chunks
+			// have been claimed) and so the state is shared, but the body is only ever accessed by
+			// a helper that has claimed a chunk which guarantees that it is still alive.
+			auto state	= std::make_shared<State>();
+			auto work	= [state, chunks, &body] {
+				for (std::size_t i = state->next++; i < chunks; i = state->next++)
+				{
+					if (!state->failed)
+					{
+						try
+						{
+							body(i);
+						}
+						catch (...)
+						{
+							if (!state->failed.exchange(true))
+							{
+								state->error = std::current_exception();
+							}
+						}
+					}
+
+					if (++state->done == chunks)
+					{
+						state->done.notify_all();
+					}
+				}
+			};
+
+			const auto helpers = std::min(pool.Size(), chunks - 1);
+
+			for (std::size_t i=0; i<helpers; i++)
+			{
+				pool.Post(work);
+			}
+
+			work();
+
+			for (auto done = state->done.load(); done < chunks; done = state->done.load())
+			{
+				state->done.wait(done);
+			}
+
+			if (state->error)
+			{
+				std::rethrow_exception(state->error);
+			}
+		}
+
+
+		// Number of elements per chunk for a range of the given size
+		inline std::size_t ChunkSize(const Executor &pool, const std::size_t count, const Partition &partition)
+		{
+			const std::size_t participants = pool.Size() + 1;
+
+			if (partition.chunking == Chunking::Static)
+			{
+				return std::max<std::size_t>((count + participants - 1) / participants, std::max<std::size_t>(partition.grain, 1));
+			}
+
+			// Aim for several chunks per thread to smooth out any imbalance
+			return partition.grain ? partition.grain : std::max<std::size_t>(count / (participants * 4), 1);
+		}
+
+
+		template <typename T> Generator<T> Slice(const Generator<T> &range, const std::size_t begin, const std::size_t end)
+		{
+			return Generator<T>(range.first + (T)begin * range.step, (T)(end - begin), range.step);
+		}
+	}
+
+
+	// Invoke fn for every value in the range using the pool. The function may either accept a
+	// single value, or a Generator<T> covering a contiguous chunk of the range which allows the
+	// per-chunk overhead to be amortised (for example when processing image rows).
+	//
+	//    ParallelFor(pool, Generator<int>(0, image.Height()), [&](int y) {
+	//        for (auto p : image.Row(y)) ...
+	//    });
+	template <typename T, typename F> void ParallelFor(Executor &pool, const Generator<T> &range, F &&fn, const Partition &partition = {})
+	{
+		const std::size_t count		= range.count > 0 ? range.count : 0;
+		const std::size_t size		= internal::ChunkSize(pool, count, partition);
+		const std::size_t chunks	= (count + size - 1) / size;
+
+		internal::Distribute(pool, chunks, [&](const std::size_t chunk) {
+			const auto slice = internal::Slice(range, chunk * size, std::min(count, (chunk + 1) * size));
+
+			if constexpr (std::is_invocable_v<F &, Generator<T>>)
+			{
+				fn(slice);
+			}
+			else
+			{
+				for (auto v : slice) fn(v);
+			}
+		});
+	}
+
+
+	// Invoke fn for every (x, y) pair of the columns and rows ranges using the pool. The 2D range
+	// is split into tiles, favouring whole rows where there are enough of them to keep all of
+	// the threads busy. The function may either accept individual (x, y) values, or a pair of
+	// Generator<T> (columns, rows) covering a single tile.
+	template <typename T, typename F> void ParallelFor(Executor &pool, const Generator<T> &columns, const Generator<T> &rows, F &&fn, const Partition &partition = {})
+	{
+		const std::size_t width		= columns.count > 0 ? columns.count : 0;
+		const std::size_t height	= rows.count > 0 ? rows.count : 0;
+
+		if (!width || !height)
+		{
+			return;
+		}
+
+		std::size_t tw = width;
+		std::size_t th = 0;
+
+		if (partition.grain)
+		{
+			tw = std::min(width, partition.grain);
+			th = std::min(height, partition.grain);
+		}
+		else
+		{
+			const std::size_t target	= (pool.Size() + 1) * (partition.chunking == Chunking::Static ? 1 : 4);
+			const std::size_t across	= std::min(width, (target + height - 1) / height);
+
+			th = std::max<std::size_t>(height / std::min(height, target), 1);
+			tw = (width + across - 1) / across;
+		}
+
+		const std::size_t tx = (width + tw - 1) / tw;
+		const std::size_t ty = (height + th - 1) / th;
+
+		internal::Distribute(pool, tx * ty, [&](const std::size_t tile) {
+			const std::size_t x = (tile % tx) * tw;
+			const std::size_t y = (tile / tx) * th;
+			const auto c		= internal::Slice(columns, x, std::min(width, x + tw));
+			const auto r		= internal::Slice(rows, y, std::min(height, y + th));
+
+			if constexpr (std::is_invocable_v<F &, Generator<T>, Generator<T>>)
+			{
+				fn(c, r);
+			}
+			else
+			{
+				for (auto j : r)
+				{
+					for (auto i : c) fn(i, j);
+				}
+			}
+		});
+	}
+
+
+	// Reduce the range in parallel. Each chunk is reduced independently starting with the identity
+	// value, using fn(V accumulator, T value) -> V, and the partial results are then combined
+	// in order with combine(V, V) -> V. Since the chunk boundaries only depend on the partition
+	// and the size of the pool, the result is deterministic regardless of thread scheduling, which
+	// matters for floating-point accumulation.
+	template <typename T, typename V, typename F, typename C> V ParallelReduce(
+		Executor &pool, const Generator<T> &range, const V &identity, F &&fn, C &&combine, const Partition &partition = {}
+	)
+	{
+		const std::size_t count		= range.count > 0 ? range.count : 0;
+		const std::size_t size		= internal::ChunkSize(pool, count, partition);
+		const std::size_t chunks	= (count + size - 1) / size;
+
+		// Wrapped so that a vector<bool> specialisation cannot cause concurrent writes to share storage
+		struct Partial { V value; };
+		std::vector<Partial> partials(chunks, { identity });
+
+		internal::Distribute(pool, chunks, [&](const std::size_t chunk) {
+			V result = identity;
+
+			for (auto v : internal::Slice(range, chunk * size, std::min(count, (chunk + 1) * size)))
+			{
+				result = fn(std::move(result), v);
+			}
+
+			partials[chunk].value = std::move(result);
+		});
+
+		V result = identity;
+
+		for (auto &p : partials)
+		{
+			result = combine(std::move(result), std::move(p.value));
+		}
+
+		return result;
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <emergent/profile/Aggregation.hpp>
+#include <emergent/thread/Metrics.hpp>
+
+
+namespace emergent
+{
+	namespace profile
+	{
+		/// Convert a snapshot of runtime timings (in microseconds) into aggregate statistics.
+		inline AggregateStatistics Statistics(const Timings &timings)
+		{
+			AggregateStatistics result;
+
+			result.samples	= timings.samples;
+			result.sum		= timings.sum;
+			result.squared	= timings.squared;
+			result.minimum	= timings.minimum;
+			result.maximum	= timings.maximum;
+			result.Update();
+
+			return result;
+		}
+
+
+		/// Add the timings from a thread pool snapshot to an aggregation using the
+		/// given name as a prefix, for example "pool.latency" and "pool.execution".
+		/// The aggregation can then be passed to any profile Storage.
+		inline void Append(Aggregation &aggregation, const std::string &name, const PoolMetrics &metrics)
+		{
+			aggregation.statistics[name + ".latency"]	= Statistics(metrics.latency);
+			aggregation.statistics[name + ".execution"]	= Statistics(metrics.execution);
+		}
+
+
+		/// Add the poll timings from an agent snapshot to an aggregation.
+		inline void Append(Aggregation &aggregation, const std::string &name, const AgentMetrics &metrics)
+		{
+			aggregation.statistics[name + ".poll"] = Statistics(metrics.poll);
+		}
+
+
+		/// Add the execution timings from a persistent thread snapshot to an aggregation.
+		inline void Append(Aggregation &aggregation, const std::string &name, const ThreadMetrics &metrics)
+		{
+			aggregation.statistics[name + ".execution"] = Statistics(metrics.execution);
+		}
+	}
+}
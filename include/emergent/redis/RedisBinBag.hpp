@@ -100,9 +100,19 @@ namespace redis
 
 			template <typename T> bool Set(const string &key, const ImageBase<T> &image)
 			{
-				ImageHeader header = { image.Depth(), sizeof(T), (uint16_t)image.Width(), (uint16_t)image.Height() };
+				return this->Set(key, image.View());
+			}
+
 
-				return Command("SET %s %b%b", key.c_str(), &header, sizeof(ImageHeader), image.Data(), (size_t)(image.Size() * image.Depth() * sizeof(T))).Ok();
+			// Store an image view, such as a frame from a camera SDK, without copying it into an image
+			// first. Views with padded rows are packed into a temporary buffer.
+			template <typename T> bool Set(const string &key, const ImageView<T> &image)
+			{
+				ImageHeader header	= { image.Depth(), sizeof(T), (uint16_t)image.Width(), (uint16_t)image.Height() };
+				std::vector<byte> packed;
+				auto [data, size]	= Pack(image, packed);
+
+				return Command("SET %s %b%b", key.c_str(), &header, sizeof(ImageHeader), data, size).Ok();
 			}
 
 
@@ -135,14 +145,44 @@ namespace redis
 
 			template <typename T> long Publish(const string &channel, const ImageBase<T> &image)
 			{
-				ImageHeader header = { image.Depth(), sizeof(T), (uint16_t)image.Width(), (uint16_t)image.Height() };
+				return this->Publish(channel, image.View());
+			}
+
+
+			template <typename T> long Publish(const string &channel, const ImageView<T> &image)
+			{
+				ImageHeader header	= { image.Depth(), sizeof(T), (uint16_t)image.Width(), (uint16_t)image.Height() };
+				std::vector<byte> packed;
+				auto [data, size]	= Pack(image, packed);
 
-				return Command("PUBLISH %s %b%b", channel.c_str(), &header, sizeof(ImageHeader), image.Data(), (size_t)(image.Size() * image.Depth() * sizeof(T))).AsLong();
+				return Command("PUBLISH %s %b%b", channel.c_str(), &header, sizeof(ImageHeader), data, size).AsLong();
 			}
 
 
 		protected:
 
+			// The pixel data of a view and its size in bytes. A view with padded rows is packed into
+			// the scratch buffer, otherwise it is used directly.
+			template <typename T> static std::pair<const void *, size_t> Pack(const ImageView<T> &image, std::vector<byte> &scratch)
+			{
+				const size_t line = image.Width() * image.Depth() * sizeof(T);
+
+				if (image.Contiguous())
+				{
+					return { image.Data(), line * image.Height() };
+				}
+
+				scratch.resize(line * image.Height());
+
+				for (int y=0; y<image.Height(); y++)
+				{
+					std::memcpy(scratch.data() + y * line, image.Row(y).data, line);
+				}
+
+				return { scratch.data(), scratch.size() };
+			}
+
+
 			redisReply *GetBinary(const string &key)
 			{
 				auto reply = this->InvokeCommand("GET %s", key.c_str());
@@ -5,6 +5,7 @@
 #include <atomic>
 #include <condition_variable>
 #include <emergent/redis/RedisBinBag.hpp>
+#include <emergent/thread/Attributes.hpp>
 
 
 namespace emergent {
@@ -38,6 +39,13 @@ namespace redis
 			}
 
 
+			// Set the attributes of the multiplexer thread, which must be done before initialisation.
+			void Attributes(const ThreadAttributes &attributes)
+			{
+				this->attributes = attributes;
+			}
+
+
 			bool Initialise(bool socket = false, const string &connection = "127.0.0.1", int port = 6379) override
 			{
 				if (!this->run)
@@ -115,6 +123,9 @@ namespace redis
 			{
 				int result;
 				redisReply *reply;
+
+				this->attributes.Apply();
+
 				std::unique_lock<std::mutex> lock(this->cs);
 
 				bool connected = this->context || this->Connect();
@@ -159,6 +170,7 @@ namespace redis
 
 			std::queue<std::shared_ptr<Expectation>> expectations;
 			std::condition_variable condition;
+			ThreadAttributes attributes;
 			std::atomic<bool> run;
 			std::thread thread;
 			std::mutex cs;
@@ -7,6 +7,7 @@
 #include <memory>
 #include <future>
 #include <chrono>
+#include <vector>
 #include <list>
 
 #include <sys/socket.h>
@@ -23,12 +24,15 @@ namespace usock
 
 	// A multi-threaded unix socket implementation. Each connection is assumed to be
 	// long-lived and so a thread is allocated to manage the read/write cycle of a
-	// single connection.
+	// single connection. The maximum number of connections (including the listening
+	// socket) can be chosen at runtime, the template argument is only the default, and
+	// threads are created as connections arrive and then kept for reuse.
 	template <std::size_t CONNECTIONS = 64> class Server
 	{
 		public:
 
-			Server()
+			explicit Server(const std::size_t connections = CONNECTIONS)
+				: threads(std::max<std::size_t>(connections, 2)), watchlist(threads.size())
 			{
 				this->run = false;
 			}
@@ -48,7 +52,7 @@ namespace usock
 					return false;
 				}
 
-				this->watchlist.fill({ -1, 0, 0 });
+				std::fill(this->watchlist.begin(), this->watchlist.end(), pollfd { -1, 0, 0 });
 
 				auto &primary	= this->watchlist[0];
 				primary.fd		= socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
@@ -70,7 +74,7 @@ namespace usock
 
 							this->used			= 1;
 							this->run			= true;
-							this->threads[0].Run(std::bind(&Server::Entry, this));
+							this->Thread(0).Run(std::bind(&Server::Entry, this));
 
 							return true;
 						}
@@ -93,11 +97,16 @@ namespace usock
 
 				Log::Info("usock::Server waiting for threads to finish");
 
-				while (std::any_of(
-					this->threads.begin(),
-					this->threads.end(),
-					[](auto &t) { return !t.Ready(); }
-				))
+				auto busy = [](auto &t) { return t && !t->Ready(); };
+
+				// The listener creates the threads of the other slots as clients connect, so it
+				// must have exited before those slots can be inspected.
+				while (busy(this->threads[0]))
+				{
+					std::this_thread::sleep_for(10ms);
+				}
+
+				while (std::any_of(this->threads.begin() + 1, this->threads.end(), busy))
 				{
 					std::this_thread::sleep_for(10ms);
 				}
@@ -106,6 +115,18 @@ namespace usock
 
 		private:
 
+			// Create the thread for a connection slot on first use
+			PersistentThread &Thread(const std::size_t index)
+			{
+				if (!this->threads[index])
+				{
+					this->threads[index] = std::make_unique<PersistentThread>();
+				}
+
+				return *this->threads[index];
+			}
+
+
 			void Entry()
 			{
 				const int primary = this->watchlist[0].fd;
@@ -142,7 +163,7 @@ namespace usock
 				}
 
 				// Close any remaining connections
-				for (int i=1; i<CONNECTIONS; i++)
+				for (std::size_t i=1; i<this->watchlist.size(); i++)
 				{
 					if (this->watchlist[i].fd >= 0)
 					{
@@ -161,11 +182,11 @@ namespace usock
 				if (client != -1)
 				{
 					// First watchlist item is the primary
-					for (int i=1; i<CONNECTIONS; i++)
+					for (int i=1; i<(int)this->watchlist.size(); i++)
 					{
 						auto *watch = &this->watchlist[i];
 
-						if (watch->fd < 0 && this->threads[i].Ready())
+						if (watch->fd < 0 && this->Thread(i).Ready())
 						{
 							// Set a timeout for reads on this socket so that recv does
 							// not block indefinitely when the server is exiting with
@@ -178,7 +199,7 @@ namespace usock
 							// see the POLLHUP event when the client disconnects.
 							*watch = { client, 0, 0 };
 
-							this->threads[i].Run([watch, i, this] {
+							this->threads[i]->Run([watch, i, this] {
 
 								Log::Info("usock::Server client %d connected on thread %d", watch->fd, i);
 
@@ -208,7 +229,7 @@ namespace usock
 			{
 				this->used = 1;
 
-				for (int i=CONNECTIONS-1; i>0; i--)
+				for (int i=(int)this->watchlist.size()-1; i>0; i--)
 				{
 					if (this->watchlist[i].fd >= 0)
 					{
@@ -310,8 +331,8 @@ namespace usock
 
 
 			std::function<bool(const std::string&, std::string&)> onMessage;
-			std::array<PersistentThread, CONNECTIONS> threads;
-			std::array<pollfd, CONNECTIONS> watchlist;
+			std::vector<std::unique_ptr<PersistentThread>> threads;
+			std::vector<pollfd> watchlist;
 			std::atomic<bool> run;
 			int used = 0;
 	};
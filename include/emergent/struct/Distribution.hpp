@@ -1,6 +1,7 @@
 #pragma once
 
 #include <emergent/Maths.hpp>
+#include <algorithm>
 #include <vector>
 
 
@@ -51,56 +52,83 @@ namespace emergent
 
 
 		/// Generate the distribution stats
-		/// If mask is used it MUST be the same size as data.
+		/// If mask is used it MUST be the same size as data and only values where the mask is non-zero
+		/// are included. Returns false if there are no values to include.
 		template <class T> bool analyse(T *data, int size, byte *mask = nullptr)
 		{
-			if (!size) return false;
+			int i = 0;
 
-			double value	= (double)*data++;
-			double sum		= value;
-			double max		= value;
-			double min		= value;
-			double squared	= value * value;
-
-			if (!mask)
+			// Skip to the first value that is included
+			while (mask && i < size && !mask[i])
 			{
-				for (int i=1; i<size; i++)
-				{
-					value		 = (double)*data++;
-					sum			+= value;
-					squared		+= value * value;
-					if (value < min) min = value;
-					if (value > max) max = value;
-				}
+				i++;
 			}
-			else
+
+			if (i >= size)
 			{
-				int count = 0;
+				*this = {};
+				return false;
+			}
+
+			// The sums are of the differences from the first value, which keeps them small so that
+			// the variance does not suffer from the cancellation of `squared / n - mean²`.
+			const double shift	= (double)data[i];
+			double max			= shift;
+			double min			= shift;
+			double sum			= 0;
+			double squared		= 0;
+			int count			= 0;
 
-				for (int i=1; i<size; i++, mask++, data++)
+			for (; i<size; i++)
+			{
+				if (!mask || mask[i])
 				{
-					if (*mask)
-					{
-						value		 = (double)*data;
-						sum			+= value;
-						squared		+= value * value;
-						if (value < min) min = value;
-						if (value > max) max = value;
-						count++;
-					}
+					const double value	= (double)data[i];
+					const double delta	= value - shift;
+
+					sum		+= delta;
+					squared	+= delta * delta;
+					count++;
+
+					if (value < min) min = value;
+					if (value > max) max = value;
 				}
-				size = count;
 			}
 
-			this->sum		= sum;
-			this->squared	= squared;
-			this->samples	= size;
+			this->samples	= count;
 			this->min		= min;
 			this->max		= max;
-			this->mean		= size ? sum / size : 0;
-			this->variance	= size ? (squared / size) - (this->mean * this->mean) : 0;
+			this->mean		= shift + sum / count;
+			this->variance	= std::max((squared - sum * sum / count) / count, 0.0);
+			this->sum		= shift * count + sum;
+			this->squared	= squared + shift * (2.0 * sum + shift * count);
 
 			return true;
 		}
+
+
+		/// Combine with the stats of another set of data, as if both had been analysed together.
+		/// The means and variances are combined pairwise (Chan et al.) rather than being derived
+		/// from the sums, which would lose precision as they grow.
+		distribution &merge(const distribution &other)
+		{
+			if (!other.samples) return *this;
+			if (!this->samples) return *this = other;
+
+			const double samples	= this->samples + other.samples;
+			const double delta		= other.mean - this->mean;
+			const double m2			= this->variance * this->samples + other.variance * other.samples
+				+ delta * delta * this->samples * other.samples / samples;
+
+			this->mean		+= delta * other.samples / samples;
+			this->variance	= m2 / samples;
+			this->samples	= samples;
+			this->sum		+= other.sum;
+			this->squared	+= other.squared;
+			this->min		= std::min(this->min, other.min);
+			this->max		= std::max(this->max, other.max);
+
+			return *this;
+		}
 	};
 }
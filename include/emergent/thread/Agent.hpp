@@ -2,8 +2,65 @@
 
 #include <thread>
 #include <atomic>
+#include <future>
+#include <new>
+#include <cstdint>
 #include <condition_variable>
 #include <emergent/Type.hpp>
+#include <emergent/concurrentqueue.h>
+#include <emergent/thread/Scheduler.hpp>
+#include <emergent/thread/Task.hpp>
+#include <emergent/thread/Metrics.hpp>
+#include <emergent/thread/Attributes.hpp>
+
+
+namespace emergent::internal
+{
+	// A job held in the mailbox of an agent. The queue stores its elements in plain byte arrays
+	// that only guarantee the alignment of a pointer, which is less than a job requires, so the
+	// job is placed at the first suitably aligned position within the storage of the letter.
+	class Letter
+	{
+		public:
+
+			Letter() { new (this->Address()) Job(); }
+			explicit Letter(Job &&job) { new (this->Address()) Job(std::move(job)); }
+			Letter(Letter &&other) noexcept { new (this->Address()) Job(std::move(*other)); }
+
+			Letter(const Letter &) = delete;
+			Letter &operator=(const Letter &) = delete;
+
+
+			Letter &operator=(Letter &&other) noexcept
+			{
+				**this = std::move(*other);
+				return *this;
+			}
+
+
+			~Letter()
+			{
+				(**this).~Job();
+			}
+
+
+			Job &operator*()
+			{
+				return *std::launder(static_cast<Job *>(this->Address()));
+			}
+
+
+		private:
+
+			void *Address()
+			{
+				return this->storage + (-reinterpret_cast<std::uintptr_t>(this->storage) & (alignof(Job) - 1));
+			}
+
+
+			alignas(void *) std::byte storage[sizeof(Job) + alignof(Job) - alignof(void *)];
+	};
+}
 
 
 namespace emergent
@@ -31,7 +88,16 @@ namespace emergent
 	// 			void OnExit();
 	// 			void Poll();
 	// }
-	template <typename T> class Agent
+	//
+	// An agent may either own a dedicated thread or, when initialised with a Scheduler,
+	// share the threads of that scheduler with many other agents. The subject interface
+	// and the behaviour of each mode are the same in both cases, although a scheduled
+	// agent will invoke OnExit on the thread that destroys the agent.
+	//
+	// Commands can be sent to the subject through a lock-free mailbox (see Send and Call)
+	// which is drained by the agent between polls, including while it is waiting for the
+	// next poll, so a caller never has to wait for a poll to complete.
+	template <typename T> class Agent : private internal::Schedulable
 	{
 		public:
 
@@ -42,14 +108,31 @@ namespace emergent
 			}
 
 
+			// Any commands that are still in the mailbox are executed before the subject is exited.
 			~Agent()
 			{
 				if (this->run)
 				{
 					this->run 			= false;
 					this->allowExecute	= false;
-					this->condition.notify_one();
-					this->thread.join();
+
+					if (this->scheduler)
+					{
+						this->scheduler->Remove(this);
+
+						std::lock_guard<std::mutex> lock(this->cs);
+
+						if (this->entered)
+						{
+							this->Drain();
+							this->subject->OnExit();
+						}
+					}
+					else
+					{
+						this->Signal();
+						this->thread.join();
+					}
 				}
 			}
 
@@ -60,6 +143,15 @@ namespace emergent
 			}
 
 
+			// Set the attributes for the dedicated thread, which must be done before initialisation.
+			// They are not used when the agent is driven by a scheduler since the scheduler owns
+			// the threads.
+			void Attributes(const ThreadAttributes &attributes)
+			{
+				this->attributes = attributes;
+			}
+
+
 			// Attempts to construct a derivative subject of T given the type name. If
 			// successful the additional arguments are passed to the initialisation
 			// function of the subject and then the thread is started in the selected mode.
@@ -73,15 +165,34 @@ namespace emergent
 					// If subject initialisation fails then the thread is not started.
 					if (this->subject && this->subject->Initialise(std::forward<Args>(args)...))
 					{
-						this->run = true;
+						this->run	= true;
+						this->mode	= mode;
+						this->thread = std::thread(&Agent::Entry, this);
 
-						switch (mode)
-						{
-							case AgentMode::Sleep:		this->thread = std::thread(&Agent::Sleep, this);	break;
-							case AgentMode::Interval:	this->thread = std::thread(&Agent::Interval, this);	break;
-							case AgentMode::Blocking:	this->thread = std::thread(&Agent::Blocking, this);	break;
-							case AgentMode::Timeout:	this->thread = std::thread(&Agent::Timeout, this);	break;
-						}
+						return true;
+					}
+				}
+
+				return false;
+			}
+
+
+			// As above, but rather than starting a dedicated thread the agent is driven by the
+			// threads of the given scheduler, which must outlive this agent.
+			template <typename R, typename P, class... Args> bool Initialise(Scheduler &scheduler, AgentMode mode, const std::chrono::duration<R, P> &duration, const std::string &type, Args&&... args)
+			{
+				if (!this->run)
+				{
+					this->duration	= duration;
+					this->subject	= emg::Type<T>::Create(type);
+
+					if (this->subject && this->subject->Initialise(std::forward<Args>(args)...))
+					{
+						this->run		= true;
+						this->mode		= mode;
+						this->scheduler	= &scheduler;
+
+						scheduler.Add(this);
 
 						return true;
 					}
@@ -94,8 +205,8 @@ namespace emergent
 			// Thread-safe execution of function on the subject and guarantees
 			// that the thread is not in the process of polling. If the action
 			// returns true then the thread is awoken to perform the next poll.
-			// It can only be used in Blocking and Timeout modes and will not
-			// perform the action if this agent is in Sleep or Interval mode.
+			// This blocks until any poll in progress has completed, so prefer
+			// Send or Call where the caller should not be held up by the subject.
 			void Execute(std::function<bool(T*)> action)
 			{
 				if (this->subject && this->allowExecute)
@@ -106,12 +217,52 @@ namespace emergent
 
 					if (result)
 					{
-						this->condition.notify_one();
+						this->requested = true;
+						this->Signal();
 					}
 				}
 			}
 
 
+			// Queue an action to be invoked on the subject by the agent between polls and return
+			// immediately. If the action returns true then the next poll is performed as soon as
+			// the mailbox has been drained rather than waiting for the normal schedule. Actions
+			// may be queued before the agent is initialised and are executed in the order sent.
+			template <typename F> void Send(F &&action)
+			{
+				this->mailbox.enqueue(internal::Letter(internal::Job([this, action = std::forward<F>(action)]() mutable {
+					if (action(this->subject.get()))
+					{
+						this->requested = true;
+					}
+				})));
+
+				this->Signal();
+			}
+
+
+			// Queue a function to be invoked on the subject by the agent between polls and return
+			// a future for the result (or any exception thrown). This does not trigger a poll.
+			template <typename F> auto Call(F &&function)
+			{
+				auto [job, future] = internal::Package([this, function = std::forward<F>(function)]() mutable {
+					return function(this->subject.get());
+				});
+
+				this->mailbox.enqueue(internal::Letter(std::move(job)));
+				this->Signal();
+
+				return std::move(future);
+			}
+
+
+			// Take a snapshot of the runtime metrics for this agent.
+			AgentMetrics Metrics() const
+			{
+				return { this->polls.Read(), this->commands.Read(), this->overruns.Read(), this->timings.Read() };
+			}
+
+
 			// UNSAFE: Allows access to the underlying subject directly, but this
 			// is asynchronous to the agent thread. If a guarantee of thread safety
 			// is required for an operation on the subject then use the Execute helper
@@ -124,79 +275,193 @@ namespace emergent
 
 		private:
 
-			void Sleep()
+			using Clock = std::chrono::steady_clock;
+
+
+			// The time at which the next poll is due following a poll that was due at the given time
+			Clock::time_point Next(const Clock::time_point due)
 			{
-				this->subject->OnEntry();
+				const auto now = Clock::now();
 
-				while (this->run)
+				switch (this->mode)
 				{
-					this->subject->Poll();
-					std::this_thread::sleep_for(this->duration);
+					case AgentMode::Sleep:		return now + this->duration;
+					case AgentMode::Blocking:	return Clock::time_point::max();
+					case AgentMode::Timeout:	return now + this->duration;
+					case AgentMode::Interval:	break;
 				}
 
-				this->subject->OnExit();
+				// The period is measured from when the poll was due rather than when it actually
+				// started, so that scheduling latency does not accumulate. If the poll overran then
+				// the next one starts immediately.
+				return std::max(due + this->duration, now);
 			}
 
 
-			void Interval()
+			// Poll the subject and record the metrics. Must be called while holding the subject lock.
+			void Poll(const Clock::time_point due)
 			{
-				std::chrono::time_point<std::chrono::steady_clock> wait;
+				const auto start = Clock::now();
 
-				this->subject->OnEntry();
+				this->subject->Poll();
 
-				while (this->run)
+				const auto end = Clock::now();
+
+				this->timings.Record(end - start);
+				this->polls.Increment();
+
+				if (this->mode == AgentMode::Interval && end > due + this->duration)
 				{
-					wait = std::chrono::steady_clock::now() + this->duration;
+					this->overruns.Increment();
+				}
+			}
+
 
-					this->subject->Poll();
+			// Invoke all of the commands in the mailbox, returns true if a poll has been requested.
+			// Must be called while holding the subject lock.
+			bool Drain()
+			{
+				internal::Letter letter;
 
-					std::this_thread::sleep_until(wait);
+				while (this->mailbox.try_dequeue(letter))
+				{
+					internal::Invoke(*letter);
+					this->commands.Increment();
 				}
 
-				this->subject->OnExit();
+				return this->requested.exchange(false);
 			}
 
 
-			void Blocking()
+			// Wake the agent so that it drains the mailbox
+			void Signal()
 			{
-				std::unique_lock<std::mutex> lock(this->cs);
+				if (this->scheduler)
+				{
+					if (this->run) this->scheduler->Wake(this);
+				}
+				else
+				{
+					this->signal.lock();
+						this->signalled = true;
+					this->signal.unlock();
+					this->condition.notify_one();
+				}
+			}
+
+
+			// Invoked by the scheduler to drain the mailbox and, if due or requested, perform
+			// a single poll. Returns when the next poll is due.
+			Clock::time_point Fire(const Clock::time_point due) override
+			{
+				std::lock_guard<std::mutex> lock(this->cs);
+
+				if (!this->entered)
+				{
+					this->subject->OnEntry();
+					this->entered		= true;
+					this->allowExecute	= true;
+				}
+
+				// Woken early by a command that did not request a poll
+				if (!this->Drain() && due < this->next)
+				{
+					return this->next;
+				}
+
+				this->Poll(due);
+
+				return this->next = this->Next(due);
+			}
+
 
-				this->allowExecute = true;
-				this->subject->OnEntry();
+			// Wait until the deadline, draining the mailbox whenever signalled. Returns the time that
+			// the next poll is due, which is earlier than the deadline if a command requested it.
+			Clock::time_point Wait(const Clock::time_point deadline)
+			{
+				std::unique_lock<std::mutex> lock(this->signal);
 
 				while (this->run)
 				{
-					this->subject->Poll();
-					this->condition.wait(lock);
+					if (this->signalled)
+					{
+						this->signalled = false;
+
+						lock.unlock();
+							this->cs.lock();
+								const bool poll = this->Drain();
+							this->cs.unlock();
+						lock.lock();
+
+						if (poll)
+						{
+							return Clock::now();
+						}
+					}
+					else if (deadline == Clock::time_point::max())
+					{
+						this->condition.wait(lock);
+					}
+					else if (this->condition.wait_until(lock, deadline) == std::cv_status::timeout && !this->signalled)
+					{
+						break;
+					}
 				}
 
-				this->subject->OnExit();
+				return deadline;
 			}
 
 
-			void Timeout()
+			// Dedicated thread used when the agent is not driven by a scheduler
+			void Entry()
 			{
-				std::unique_lock<std::mutex> lock(this->cs);
+				this->attributes.Apply();
 
-				this->allowExecute = true;
-				this->subject->OnEntry();
+				this->cs.lock();
+					this->subject->OnEntry();
+					this->allowExecute = true;
+				this->cs.unlock();
+
+				auto due = Clock::now();
 
 				while (this->run)
 				{
-					this->subject->Poll();
-					this->condition.wait_for(lock, this->duration);
+					this->cs.lock();
+						this->Drain();
+						this->Poll(due);
+					this->cs.unlock();
+
+					due = this->Wait(this->Next(due));
 				}
 
+				std::lock_guard<std::mutex> lock(this->cs);
+
+				this->Drain();
 				this->subject->OnExit();
 			}
 
 
-			bool allowExecute = false;
+			std::atomic<bool> allowExecute = false;
+			bool entered = false;
+			bool signalled = false;
+			AgentMode mode = AgentMode::Sleep;
+			Scheduler *scheduler = nullptr;
+			Clock::time_point next = Clock::time_point::min();
 			std::chrono::microseconds duration { 1000 };
+			ThreadAttributes attributes;
 			std::unique_ptr<T> subject;
+			moodycamel::ConcurrentQueue<internal::Letter> mailbox;
+			std::atomic<bool> requested = false;
 			std::condition_variable condition;
 			std::atomic<bool> run;
 			std::thread thread;
+			std::mutex signal;
 			std::mutex cs;
+
+			// Instrumentation, only written while holding the subject lock
+			Counter polls;
+			Counter commands;
+			Counter overruns;
+			Histogram timings;
 	};
 }
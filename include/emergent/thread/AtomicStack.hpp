@@ -1,88 +1,301 @@
 #pragma once
-// #include <memory>
-// #include <utility>
+
+#include <bit>
+#include <new>
+#include <array>
 #include <atomic>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
 #include <optional>
+#include <stdexcept>
 
 
-namespace emergent::experimental
+namespace emergent
 {
+	// A lock-free stack (LIFO) which is suitable for use as a free-list of reusable objects,
+	// such as image buffers, that are shared between threads.
+	//
+	// Nodes are referred to by a 32-bit index rather than a pointer, which allows the head of
+	// the stack to pack the index alongside a 32-bit tag into a single 64-bit atomic. The tag
+	// is incremented on every change to the head, so a compare-exchange will fail if the head
+	// has been popped and pushed back in the meantime (the ABA problem). Nodes are never returned
+	// to the system while the stack exists, instead they are recycled through an internal free
+	// list (which uses the same tagged head) so a thread that reads a node which has just been
+	// popped by another thread is still reading valid memory, and once the stack has warmed up
+	// pushing and popping does not allocate.
 	template <typename T> class AtomicStack
 	{
 		public:
+
 			AtomicStack() = default;
 			AtomicStack(const AtomicStack &) = delete;
 			AtomicStack &operator=(const AtomicStack &) = delete;
 
 
+			~AtomicStack()
+			{
+				for (auto index = Index(this->head.load()); index != NIL; index = this->At(index).next)
+				{
+					this->At(index).Value()->~T();
+				}
+
+				for (std::size_t i=0; i<SEGMENTS; i++)
+				{
+					delete [] this->segments[i].load();
+				}
+			}
+
+
 			void Push(const T &value)
 			{
-				this->Push(new Node(value));
+				this->Emplace(value);
 			}
 
+
 			void Push(T &&value)
 			{
-				this->Push(new Node(value));
+				this->Emplace(std::move(value));
 			}
 
 
-			std::optional<T> Pop()
+			// Construct a value in place on the top of the stack.
+			template <typename... Args> void Emplace(Args&&... args)
 			{
-				Node *node = this->head.load(std::memory_order_relaxed);
+				const auto index = this->Acquire();
 
-				while (!this->head.compare_exchange_strong(node, node->next, std::memory_order_release, std::memory_order_relaxed))
+				new (this->At(index).storage) T(std::forward<Args>(args)...);
+
+				this->Link(this->head, index, index);
+				this->size++;
+			}
+
+
+			// Push all of the values from a range with a single update to the head of the stack, so
+			// they will appear atomically to other threads. The last value in the range will end
+			// up on the top of the stack. The values are moved if the iterators allow it.
+			template <typename Iterator> void PushRange(Iterator begin, Iterator end)
+			{
+				uint32_t first	= NIL;
+				uint32_t last	= NIL;
+				std::size_t n	= 0;
+
+				for (; begin != end; ++begin, n++)
 				{
-					// empty loop
+					const auto index	= this->Acquire();
+					auto &node			= this->At(index);
+
+					new (node.storage) T(*begin);
+
+					node.next	= first;
+					first		= index;
+
+					if (last == NIL)
+					{
+						last = index;
+					}
 				}
 
-				if (node)
+				if (n)
 				{
-					this->size--;
+					this->Link(this->head, first, last);
+					this->size += n;
+				}
+			}
 
-					// const auto value = std::move(node->data);
-					const auto value = node->data;
 
-					delete node;
+			std::optional<T> Pop()
+			{
+				const auto index = this->Unlink(this->head);
+
+				if (index == NIL)
+				{
+					return std::nullopt;
+				}
+
+				this->size--;
+
+				auto *value		= this->At(index).Value();
+				auto result		= std::optional<T>(std::move(*value));
+
+				value->~T();
+				this->Release(index, index);
+
+				return result;
+			}
+
+
+			// Atomically take every value from the stack, the result is ordered from the top of
+			// the stack down.
+			std::vector<T> PopAll()
+			{
+				std::vector<T> result;
+
+				auto current = this->head.load(std::memory_order_acquire);
+
+				while (Index(current) != NIL && !this->head.compare_exchange_weak(
+					current, Pack(NIL, Tag(current) + 1), std::memory_order_acquire, std::memory_order_acquire
+				));
+
+				uint32_t last = NIL;
+
+				// The detached chain is now owned exclusively by this thread
+				for (auto index = Index(current); index != NIL; index = this->At(index).next.load(std::memory_order_relaxed))
+				{
+					auto *value = this->At(index).Value();
 
-					return value;
+					result.push_back(std::move(*value));
+					value->~T();
+					last = index;
 				}
 
-				return std::nullopt;
+				if (last != NIL)
+				{
+					this->size -= result.size();
+					this->Release(Index(current), last);
+				}
+
+				return result;
 			}
 
 
-			size_t Size() const
+			// Approximate number of values in the stack.
+			std::size_t Size() const
 			{
 				return this->size;
 			}
 
 
+			bool Empty() const
+			{
+				return Index(this->head.load(std::memory_order_relaxed)) == NIL;
+			}
+
+
 		private:
 
 			struct Node
 			{
-				T data;
-
-				Node *next = nullptr;
+				std::atomic<uint32_t> next = NIL;
+				alignas(T) std::byte storage[sizeof(T)];
 
-				Node(const T &data) : data(data) {}
-				Node(T &&data) : data(std::move(data)) {}
+				T *Value() { return std::launder(reinterpret_cast<T *>(this->storage)); }
 			};
 
-			std::atomic<Node *> head = nullptr;
-			std::atomic<size_t> size = 0;
+
+			static constexpr uint32_t NIL			= UINT32_MAX;
+			static constexpr int BASE_BITS			= 6;	// The first segment holds 64 nodes
+			static constexpr std::size_t SEGMENTS	= 32 - BASE_BITS;	// and each subsequent segment doubles in size
+
+
+			static constexpr uint32_t Index(const uint64_t value)	{ return (uint32_t)value; }
+			static constexpr uint32_t Tag(const uint64_t value)		{ return (uint32_t)(value >> 32); }
+
+			static constexpr uint64_t Pack(const uint32_t index, const uint32_t tag)
+			{
+				return (uint64_t)tag << 32 | index;
+			}
+
+
+			Node &At(const uint32_t index)
+			{
+				const uint64_t v	= (uint64_t)index + (1u << BASE_BITS);
+				const int segment	= std::bit_width(v) - 1 - BASE_BITS;
+
+				return this->segments[segment].load(std::memory_order_acquire)[v - ((uint64_t)1 << (segment + BASE_BITS))];
+			}
 
 
-			void Push(Node *node)
+			// Link a chain of nodes (already connected via next, from first to last) onto a list
+			void Link(std::atomic<uint64_t> &list, const uint32_t first, const uint32_t last)
 			{
-				node->next = this->head.load(std::memory_order_relaxed);
+				auto &tail		= this->At(last);
+				auto current	= list.load(std::memory_order_relaxed);
 
-				while (!this->head.compare_exchange_strong(node->next, node, std::memory_order_release, std::memory_order_relaxed))
+				do
 				{
-					// empty loop
+					tail.next.store(Index(current), std::memory_order_relaxed);
 				}
+				while (!list.compare_exchange_weak(current, Pack(first, Tag(current) + 1), std::memory_order_release, std::memory_order_relaxed));
+			}
 
-				this->size++;
+
+			// Remove the node at the top of a list, returns NIL if the list is empty. If another thread
+			// pops this node first then the "next" value that was read may be stale but the tag will
+			// have changed so the exchange will fail and the loop try again.
+			uint32_t Unlink(std::atomic<uint64_t> &list)
+			{
+				auto current = list.load(std::memory_order_acquire);
+
+				while (Index(current) != NIL)
+				{
+					const auto next = this->At(Index(current)).next.load(std::memory_order_relaxed);
+
+					if (list.compare_exchange_weak(current, Pack(next, Tag(current) + 1), std::memory_order_acquire, std::memory_order_acquire))
+					{
+						return Index(current);
+					}
+				}
+
+				return NIL;
 			}
+
+
+			// Take a node from the free list or, if that is empty, a fresh node from the segments.
+			uint32_t Acquire()
+			{
+				const auto index = this->Unlink(this->free);
+
+				return index != NIL ? index : this->Allocate();
+			}
+
+
+			void Release(const uint32_t first, const uint32_t last)
+			{
+				this->Link(this->free, first, last);
+			}
+
+
+			uint32_t Allocate()
+			{
+				const auto index	= this->allocated++;
+				const uint64_t v	= (uint64_t)index + (1u << BASE_BITS);
+				const int segment	= std::bit_width(v) - 1 - BASE_BITS;
+
+				if (index == NIL || segment >= (int)SEGMENTS)
+				{
+					throw std::length_error("AtomicStack has exhausted the available nodes");
+				}
+
+				// The first thread to need a segment allocates it, any others that race to do
+				// the same will discard their own allocation.
+				if (!this->segments[segment].load(std::memory_order_acquire))
+				{
+					Node *expected	= nullptr;
+					Node *created	= new Node[(std::size_t)1 << (segment + BASE_BITS)];
+
+					if (!this->segments[segment].compare_exchange_strong(expected, created, std::memory_order_acq_rel))
+					{
+						delete [] created;
+					}
+				}
+
+				return index;
+			}
+
+
+			alignas(64) std::atomic<uint64_t> head	= Pack(NIL, 0);
+			alignas(64) std::atomic<uint64_t> free	= Pack(NIL, 0);
+			std::atomic<uint32_t> allocated			= 0;
+			std::atomic<std::size_t> size			= 0;
+
+			std::array<std::atomic<Node *>, SEGMENTS> segments = {};
 	};
+
+
+	namespace experimental
+	{
+		// Retained for backwards compatibility
+		template <typename T> using AtomicStack = emergent::AtomicStack<T>;
+	}
 }
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+
+#ifdef __linux__
+	#include <sched.h>
+	#include <pthread.h>
+	#include <unistd.h>
+	#include <sys/syscall.h>
+#endif
+
+
+namespace emergent::internal
+{
+	// The number of threads that have failed to apply some of their attributes
+	inline std::atomic<std::size_t> &AttributeFailures()
+	{
+		static std::atomic<std::size_t> counter = 0;
+		return counter;
+	}
+}
+
+
+namespace emergent
+{
+	enum class SchedulingPolicy
+	{
+		Default,	// Normal time-sharing scheduling (SCHED_OTHER)
+		Fifo,		// Real-time first-in first-out (SCHED_FIFO)
+		RoundRobin	// Real-time round-robin (SCHED_RR)
+	};
+
+
+	// Placement and scheduling attributes for a thread. Every field is optional and the
+	// default attributes leave a thread untouched. The attributes are applied by the thread
+	// itself when it starts, so the memory policy applies to all allocations made by that
+	// thread. Currently only supported under Linux, elsewhere applying them does nothing.
+	//
+	//    ThreadAttributes attributes;
+	//    attributes.node = 1;
+	//    attributes.name = "grabber";
+	//    ThreadPool<4> pool(ThreadPool<4>::CAPACITY, attributes);
+	struct ThreadAttributes
+	{
+		std::vector<int> cpus;		// CPUs that the thread may run on, empty for no restriction
+		bool distribute = false;	// Threads of a pool are each pinned to a single CPU from the set in turn
+		int node		= -1;		// NUMA node to bind the thread and its memory allocations to, -1 for none
+		SchedulingPolicy policy = SchedulingPolicy::Default;
+		int priority	= 0;		// Priority for the real-time policies (1 to 99)
+		std::string name;			// Name of the thread (truncated to 15 characters under Linux)
+
+
+		// The attributes for the thread at the given index of a group of threads, such as the
+		// workers in a pool. The name is suffixed with the index and, if distributing, the CPU
+		// set is reduced to a single CPU.
+		ThreadAttributes For(const std::size_t index) const
+		{
+			ThreadAttributes result = *this;
+
+			if (!this->name.empty())
+			{
+				result.name = this->name + "/" + std::to_string(index);
+			}
+
+			if (this->distribute)
+			{
+				const auto cpus = this->Cpus();
+
+				if (!cpus.empty())
+				{
+					result.cpus = { cpus[index % cpus.size()] };
+				}
+			}
+
+			return result;
+		}
+
+
+		// The CPU set, which is that of the NUMA node if no CPUs have been specified explicitly.
+		std::vector<int> Cpus() const
+		{
+			return this->cpus.empty() && this->node >= 0 ? NodeCpus(this->node) : this->cpus;
+		}
+
+
+		// Apply the attributes to the calling thread. Returns false if any of them could not be
+		// applied, for example due to insufficient privileges for a real-time policy, in which
+		// case the thread simply continues with the remaining attributes. Since the threads that
+		// apply attributes are usually owned by a class, each failure is also counted (see Failures).
+		bool Apply() const
+		{
+			bool result = true;
+
+			#ifdef __linux__
+				const auto self = pthread_self();
+
+				if (!this->name.empty())
+				{
+					result &= pthread_setname_np(self, this->name.substr(0, 15).c_str()) == 0;
+				}
+
+				if (const auto cpus = this->Cpus(); !cpus.empty())
+				{
+					cpu_set_t set;
+					CPU_ZERO(&set);
+
+					for (auto c : cpus)
+					{
+						if (c >= 0 && c < CPU_SETSIZE) CPU_SET(c, &set);
+					}
+
+					result &= pthread_setaffinity_np(self, sizeof(set), &set) == 0;
+				}
+
+				if (this->node >= 0)
+				{
+					// Bind allocations to the node using the raw system call to avoid a dependency on libnuma
+					static constexpr int MPOL_BIND	= 2;
+					static constexpr int BITS		= sizeof(unsigned long) * 8;
+
+					std::vector<unsigned long> mask(this->node / BITS + 1, 0);
+					mask[this->node / BITS] |= 1ul << (this->node % BITS);
+
+					result &= syscall(SYS_set_mempolicy, MPOL_BIND, mask.data(), mask.size() * BITS + 1) == 0;
+				}
+
+				if (this->policy != SchedulingPolicy::Default)
+				{
+					sched_param parameters = {};
+					parameters.sched_priority = this->priority;
+
+					result &= pthread_setschedparam(self, this->policy == SchedulingPolicy::Fifo ? SCHED_FIFO : SCHED_RR, &parameters) == 0;
+				}
+			#endif
+
+			if (!result)
+			{
+				internal::AttributeFailures()++;
+			}
+
+			return result;
+		}
+
+
+		// The number of threads that have failed to apply some of their attributes since the
+		// process started.
+		static std::size_t Failures()
+		{
+			return internal::AttributeFailures();
+		}
+
+
+		// Read the list of CPUs that belong to a NUMA node, which is in the form "0-3,8,10-11".
+		static std::vector<int> NodeCpus(const int node)
+		{
+			std::vector<int> result;
+			std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+			std::string range;
+
+			while (std::getline(file, range, ','))
+			{
+				try
+				{
+					const auto dash		= range.find('-');
+					const int first		= std::stoi(range.substr(0, dash));
+					const int last		= dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+
+					for (int c = first; c <= last; c++)
+					{
+						result.push_back(c);
+					}
+				}
+				catch (...) {}
+			}
+
+			return result;
+		}
+	};
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+
+namespace emergent
+{
+	// A lock-free, fixed capacity, multi-producer multi-consumer queue based on
+	// the bounded queue design by Dmitry Vyukov. Each cell carries a sequence number
+	// that tells producers and consumers whether it is ready to be written or read,
+	// so the only shared contention is a single compare-exchange on each end of the
+	// queue. Values are only moved out of the arguments when an operation succeeds.
+	// The sequence scheme cannot distinguish a full cell from an empty one when there
+	// is only a single cell, so the capacity is always at least 2.
+	template <typename T> class BoundedQueue
+	{
+		public:
+
+			explicit BoundedQueue(const std::size_t capacity) : cells(std::max<std::size_t>(capacity, 2))
+			{
+				for (std::size_t i=0; i<this->cells.size(); i++)
+				{
+					this->cells[i].sequence.store(i, std::memory_order_relaxed);
+				}
+			}
+
+			BoundedQueue(const BoundedQueue &) = delete;
+			BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+
+			// Attempt to add a value to the queue, returns false if the queue is full.
+			bool TryPush(T &&value)
+			{
+				Cell *cell;
+				std::size_t position = this->tail.load(std::memory_order_relaxed);
+
+				while (true)
+				{
+					cell = &this->cells[position % this->cells.size()];
+
+					const auto sequence	= cell->sequence.load(std::memory_order_acquire);
+					const auto diff		= (std::ptrdiff_t)sequence - (std::ptrdiff_t)position;
+
+					if (diff == 0)
+					{
+						if (this->tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+						{
+							break;
+						}
+					}
+					else if (diff < 0)
+					{
+						return false;
+					}
+					else position = this->tail.load(std::memory_order_relaxed);
+				}
+
+				cell->data = std::move(value);
+				cell->sequence.store(position + 1, std::memory_order_release);
+
+				return true;
+			}
+
+
+			// Attempt to remove a value from the queue, returns false if the queue is empty.
+			bool TryPop(T &value)
+			{
+				Cell *cell;
+				std::size_t position = this->head.load(std::memory_order_relaxed);
+
+				while (true)
+				{
+					cell = &this->cells[position % this->cells.size()];
+
+					const auto sequence	= cell->sequence.load(std::memory_order_acquire);
+					const auto diff		= (std::ptrdiff_t)sequence - (std::ptrdiff_t)(position + 1);
+
+					if (diff == 0)
+					{
+						if (this->head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+						{
+							break;
+						}
+					}
+					else if (diff < 0)
+					{
+						return false;
+					}
+					else position = this->head.load(std::memory_order_relaxed);
+				}
+
+				value = std::move(cell->data);
+				cell->data = T {};
+				cell->sequence.store(position + this->cells.size(), std::memory_order_release);
+
+				return true;
+			}
+
+
+			// The maximum number of values that the queue can hold.
+			std::size_t Capacity() const
+			{
+				return this->cells.size();
+			}
+
+
+			// Approximate number of values in the queue, it may be stale by the time it is used.
+			std::size_t SizeApprox() const
+			{
+				const auto t = this->tail.load(std::memory_order_relaxed);
+				const auto h = this->head.load(std::memory_order_relaxed);
+
+				return t > h ? t - h : 0;
+			}
+
+
+		private:
+
+			struct alignas(64) Cell
+			{
+				std::atomic<std::size_t> sequence;
+				T data;
+			};
+
+			std::vector<Cell> cells;
+
+			// Producers and consumers are kept on separate cache lines
+			alignas(64) std::atomic<std::size_t> tail = 0;
+			alignas(64) std::atomic<std::size_t> head = 0;
+	};
+}
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <optional>
+#include <utility>
+#include <exception>
+#include <stdexcept>
+#include <coroutine>
+#include <emergent/thread/Future.hpp>
+#include <emergent/thread/Scheduler.hpp>
+#include <emergent/thread/ResetEvent.hpp>
+
+
+namespace emergent
+{
+	template <typename T = void> class Task;
+
+
+	namespace internal
+	{
+		// Storage for the result of a coroutine task
+		template <typename T> struct TaskResult
+		{
+			std::optional<T> value;
+
+			template <typename V> void return_value(V &&value)
+			{
+				this->value.emplace(std::forward<V>(value));
+			}
+
+			T Take()
+			{
+				return std::move(*this->value);
+			}
+		};
+
+
+		template <> struct TaskResult<void>
+		{
+			void return_void() {}
+			void Take() {}
+		};
+
+
+		template <typename T> struct TaskPromise : TaskResult<T>
+		{
+			// The coroutine that is awaiting this task, which is resumed once it has finished
+			std::coroutine_handle<> continuation = std::noop_coroutine();
+			std::exception_ptr error;
+
+
+			struct Final
+			{
+				bool await_ready() const noexcept { return false; }
+
+				template <typename P> std::coroutine_handle<> await_suspend(std::coroutine_handle<P> handle) noexcept
+				{
+					return handle.promise().continuation;
+				}
+
+				void await_resume() const noexcept {}
+			};
+
+
+			Task<T> get_return_object() noexcept;
+			std::suspend_always initial_suspend() const noexcept	{ return {}; }
+			Final final_suspend() const noexcept					{ return {}; }
+			void unhandled_exception() noexcept						{ this->error = std::current_exception(); }
+		};
+
+
+		// A coroutine that starts immediately and destroys itself on completion, used to
+		// launch a task from ordinary code.
+		struct Detached
+		{
+			struct promise_type
+			{
+				Detached get_return_object() const noexcept				{ return {}; }
+				std::suspend_never initial_suspend() const noexcept	{ return {}; }
+				std::suspend_never final_suspend() const noexcept		{ return {}; }
+				void return_void() const noexcept						{}
+				void unhandled_exception() const noexcept				{ std::terminate(); }
+			};
+		};
+	}
+
+
+	// A lazily started coroutine that produces a value of type T. A task does nothing until it
+	// is awaited by another coroutine, or launched on a pool with Spawn, and any exception thrown
+	// by the coroutine is rethrown to the awaiter. Combined with the awaitables provided by
+	// Executor::Schedule, Scheduler::Sleep and ResetEvent, a stage that would otherwise block
+	// can be suspended without holding on to a thread.
+	//
+	//    Task<int> Analyse(Executor &pool, Scheduler &scheduler)
+	//    {
+	//        co_await scheduler.Sleep(10ms);
+	//        co_await pool.Schedule();
+	//        co_return 42;
+	//    }
+	//
+	//    auto result = Spawn(pool, Analyse(pool, scheduler)).Get();
+	template <typename T> class Task
+	{
+		public:
+
+			using promise_type = internal::TaskPromise<T>;
+
+
+			Task() = default;
+			Task(const Task &) = delete;
+			Task &operator=(const Task &) = delete;
+
+			Task(Task &&other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+
+
+			Task &operator=(Task &&other) noexcept
+			{
+				if (this != &other)
+				{
+					if (this->handle) this->handle.destroy();
+					this->handle = std::exchange(other.handle, nullptr);
+				}
+
+				return *this;
+			}
+
+
+			~Task()
+			{
+				if (this->handle)
+				{
+					this->handle.destroy();
+				}
+			}
+
+
+			bool Valid() const
+			{
+				return (bool)this->handle;
+			}
+
+
+			// Awaiting a task starts it and resumes the awaiting coroutine once the task has finished.
+			// Throws std::logic_error if the task is not valid (default constructed or moved from).
+			auto operator co_await() &&
+			{
+				if (!this->handle)
+				{
+					throw std::logic_error("awaiting a task that is not valid");
+				}
+
+				struct Awaiter
+				{
+					std::coroutine_handle<promise_type> handle;
+
+					bool await_ready() const { return this->handle.done(); }
+
+					std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting)
+					{
+						this->handle.promise().continuation = awaiting;
+						return this->handle;
+					}
+
+					T await_resume()
+					{
+						if (this->handle.promise().error)
+						{
+							std::rethrow_exception(this->handle.promise().error);
+						}
+
+						return this->handle.promise().Take();
+					}
+				};
+
+				return Awaiter { this->handle };
+			}
+
+
+		private:
+
+			friend struct internal::TaskPromise<T>;
+
+			explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+			std::coroutine_handle<promise_type> handle;
+	};
+
+
+	namespace internal
+	{
+		template <typename T> Task<T> TaskPromise<T>::get_return_object() noexcept
+		{
+			return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+		}
+
+
+		template <typename T> Detached Launch(Executor &pool, Task<T> task, Promise<T> promise)
+		{
+			co_await pool.Schedule();
+
+			try
+			{
+				if constexpr (std::is_void_v<T>)
+				{
+					co_await std::move(task);
+					promise.Set();
+				}
+				else promise.Set(co_await std::move(task));
+			}
+			catch (...)
+			{
+				promise.Fail(std::current_exception());
+			}
+		}
+	}
+
+
+	// Start a task on the pool and return a future for the result, which bridges coroutines
+	// with ordinary code and with the continuations in Future.hpp.
+	template <typename T> Future<T> Spawn(Executor &pool, Task<T> task)
+	{
+		Promise<T> promise;
+		auto result = promise.GetFuture();
+
+		internal::Launch(pool, std::move(task), std::move(promise));
+
+		return result;
+	}
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <emergent/thread/Futex.hpp>
+
+
+namespace emergent
+{
+	namespace internal
+	{
+		// The state of an event packed into a single word, where bit 0 is the signalled flag and the
+		// remaining bits count the threads that are parked (or about to park) in the kernel. Setting
+		// the event and waiting on an event that is already set are a single atomic operation, and
+		// a system call is only made when there is actually a thread to wake or nothing to consume.
+		class EventState
+		{
+			public:
+
+				// Returns true if the event was not already set. All parked threads are woken when
+				// "all" is set, otherwise a single thread is woken.
+				bool Set(const bool all)
+				{
+					const auto previous = this->state.fetch_or(SIGNALLED);
+
+					if (previous >> 1)
+					{
+						FutexWake(this->state, all ? INT32_MAX : 1);
+					}
+
+					return !(previous & SIGNALLED);
+				}
+
+
+				void Reset()
+				{
+					this->state.fetch_and(~SIGNALLED);
+				}
+
+
+				bool IsSet() const
+				{
+					return this->state.load() & SIGNALLED;
+				}
+
+
+				// Consume the signal if "reset" is enabled, otherwise just check it
+				bool TryWait(const bool reset)
+				{
+					auto current = this->state.load();
+
+					while (current & SIGNALLED)
+					{
+						if (!reset || this->state.compare_exchange_weak(current, current & ~SIGNALLED))
+						{
+							return true;
+						}
+					}
+
+					return false;
+				}
+
+
+				// Spin briefly before parking. Returns false if the deadline passed before the event was set.
+				bool Wait(const Clock::time_point deadline, const bool reset)
+				{
+					for (int i=0; i<SPINS; i++)
+					{
+						if (this->TryWait(reset))
+						{
+							return true;
+						}
+
+						Pause();
+					}
+
+					this->state.fetch_add(WAITER);
+
+					bool result = false;
+
+					while (!(result = this->TryWait(reset)))
+					{
+						const auto current = this->state.load();
+
+						if (!(current & SIGNALLED) && !FutexWait(this->state, current, deadline))
+						{
+							result = this->TryWait(reset);
+							break;
+						}
+					}
+
+					this->state.fetch_sub(WAITER);
+
+					return result;
+				}
+
+
+			private:
+
+				static constexpr uint32_t SIGNALLED	= 1;
+				static constexpr uint32_t WAITER	= 2;
+
+				std::atomic<uint32_t> state = 0;
+		};
+	}
+
+
+	// An event that, once set, releases every waiting thread and remains set until it is reset.
+	class ManualResetEvent
+	{
+		public:
+
+			void Set()			{ this->state.Set(true); }
+			void Reset()		{ this->state.Reset(); }
+			bool IsSet() const	{ return this->state.IsSet(); }
+
+			void Wait()			{ this->state.Wait(internal::Clock::time_point::max(), false); }
+
+			template <typename R, typename P> bool WaitFor(const std::chrono::duration<R, P> &timeout)
+			{
+				return this->state.Wait(internal::Deadline(timeout), false);
+			}
+
+			template <typename C, typename D> bool WaitUntil(const std::chrono::time_point<C, D> &deadline)
+			{
+				return this->WaitFor(deadline - C::now());
+			}
+
+		private:
+
+			internal::EventState state;
+	};
+
+
+	// An event that releases a single waiting thread each time it is set, after which it
+	// is automatically reset. Setting an event that is already set has no effect.
+	class AutoResetEvent
+	{
+		public:
+
+			void Set()		{ this->state.Set(false); }
+			void Reset()	{ this->state.Reset(); }
+
+			void Wait()		{ this->state.Wait(internal::Clock::time_point::max(), true); }
+
+			// Consume the event without blocking, returns false if it was not set.
+			bool TryWait()	{ return this->state.TryWait(true); }
+
+			template <typename R, typename P> bool WaitFor(const std::chrono::duration<R, P> &timeout)
+			{
+				return this->state.Wait(internal::Deadline(timeout), true);
+			}
+
+			template <typename C, typename D> bool WaitUntil(const std::chrono::time_point<C, D> &deadline)
+			{
+				return this->WaitFor(deadline - C::now());
+			}
+
+		private:
+
+			internal::EventState state;
+	};
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cstdint>
+#include <algorithm>
+
+#ifdef __linux__
+	#include <ctime>
+	#include <unistd.h>
+	#include <linux/futex.h>
+	#include <sys/syscall.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+	#include <immintrin.h>
+#endif
+
+
+namespace emergent::internal
+{
+	using Clock = std::chrono::steady_clock;
+
+	// Number of times a waiter checks for a state change before parking in the kernel
+	static constexpr int SPINS = 64;
+
+
+	// Hint to the processor that this is a spin-wait loop
+	inline void Pause()
+	{
+		#if defined(__x86_64__) || defined(__i386__)
+			_mm_pause();
+		#elif defined(__aarch64__)
+			asm volatile("yield");
+		#endif
+	}
+
+
+	// Block while the word still holds the expected value, until woken or the deadline passes
+	// (time_point::max() waits indefinitely). Spurious wake-ups are possible so the caller must
+	// re-check its condition. Returns false if the deadline has passed.
+	inline bool FutexWait(std::atomic<uint32_t> &word, const uint32_t expected, const Clock::time_point deadline)
+	{
+		#ifdef __linux__
+			static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) && std::atomic<uint32_t>::is_always_lock_free);
+
+			timespec timeout, *pointer = nullptr;
+
+			if (deadline != Clock::time_point::max())
+			{
+				const auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - Clock::now()).count();
+
+				if (remaining <= 0)
+				{
+					return false;
+				}
+
+				timeout.tv_sec	= remaining / 1'000'000'000;
+				timeout.tv_nsec	= remaining % 1'000'000'000;
+				pointer			= &timeout;
+			}
+
+			syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT_PRIVATE, expected, pointer, nullptr, 0);
+		#else
+			if (deadline == Clock::time_point::max())
+			{
+				word.wait(expected);
+			}
+			else
+			{
+				// std::atomic::wait does not support timeouts so fall back to polling
+				const auto now = Clock::now();
+
+				if (now >= deadline)
+				{
+					return false;
+				}
+
+				std::this_thread::sleep_for(std::min<Clock::duration>(deadline - now, std::chrono::microseconds(100)));
+			}
+		#endif
+
+		return deadline == Clock::time_point::max() || Clock::now() < deadline;
+	}
+
+
+	// Wake up to count threads that are blocked on the word
+	inline void FutexWake(std::atomic<uint32_t> &word, const int count)
+	{
+		#ifdef __linux__
+			syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+		#else
+			if (count == 1) word.notify_one();
+			else			word.notify_all();
+		#endif
+	}
+
+
+	// Convert a relative timeout into a deadline without overflowing
+	template <typename R, typename P> Clock::time_point Deadline(const std::chrono::duration<R, P> &timeout)
+	{
+		const auto now = Clock::now();
+
+		return timeout >= std::chrono::duration_cast<std::chrono::duration<R, P>>(Clock::time_point::max() - now)
+			? Clock::time_point::max()
+			: now + std::chrono::ceil<Clock::duration>(timeout);
+	}
+}
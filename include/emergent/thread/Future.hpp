@@ -0,0 +1,391 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <vector>
+#include <variant>
+#include <optional>
+#include <exception>
+#include <stdexcept>
+#include <condition_variable>
+#include <emergent/thread/Pool.hpp>
+
+
+namespace emergent
+{
+	template <typename T> class Future;
+	template <typename T> class Promise;
+
+
+	namespace internal
+	{
+		// The state shared between a Promise and its Futures. Continuations are held as jobs which
+		// are invoked by whichever thread completes the state, or immediately if a continuation is
+		// attached after completion.
+		template <typename T> struct Shared
+		{
+			using Value = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+			std::mutex cs;
+			std::condition_variable condition;
+			std::vector<Job> continuations;
+			std::optional<Value> value;
+			std::exception_ptr error;
+			bool ready = false;
+
+
+			template <typename F> void Subscribe(F &&continuation)
+			{
+				Job job(std::forward<F>(continuation));
+
+				this->cs.lock();
+
+					if (!this->ready)
+					{
+						this->continuations.push_back(std::move(job));
+						this->cs.unlock();
+						return;
+					}
+
+				this->cs.unlock();
+
+				Invoke(job);
+			}
+
+
+			// The result must have been stored before this is called
+			void Complete()
+			{
+				std::vector<Job> continuations;
+
+				this->cs.lock();
+					this->ready = true;
+					std::swap(continuations, this->continuations);
+				this->cs.unlock();
+				this->condition.notify_all();
+
+				for (auto &c : continuations)
+				{
+					Invoke(c);
+				}
+			}
+		};
+
+
+		// Invoke the function and fulfil the promise with the result or the exception thrown.
+		template <typename T, typename F> void Fulfil(Promise<T> &promise, F &&function)
+		{
+			try
+			{
+				if constexpr (std::is_void_v<T>)
+				{
+					function();
+					promise.Set();
+				}
+				else promise.Set(function());
+			}
+			catch (...)
+			{
+				promise.Fail(std::current_exception());
+			}
+		}
+	}
+
+
+	// The producing side of a Future. A promise can only be fulfilled once, subsequent
+	// attempts are ignored. If it is destroyed without being fulfilled then the future
+	// fails with a broken_promise error, in the same way as std::promise.
+	template <typename T> class Promise
+	{
+		public:
+
+			Promise() : state(std::make_shared<internal::Shared<T>>()) {}
+
+			Promise(Promise &&) noexcept = default;
+			Promise &operator=(Promise &&) noexcept = default;
+
+
+			~Promise()
+			{
+				if (this->state && !this->fulfilled)
+				{
+					this->Fail(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+				}
+			}
+
+
+			Future<T> GetFuture() const
+			{
+				return Future<T>(this->state);
+			}
+
+
+			template <typename... V> void Set(V&&... value)
+			{
+				if (!this->fulfilled)
+				{
+					this->fulfilled = true;
+					this->state->value.emplace(std::forward<V>(value)...);
+					this->state->Complete();
+				}
+			}
+
+
+			void Fail(std::exception_ptr error)
+			{
+				if (!this->fulfilled)
+				{
+					this->fulfilled		= true;
+					this->state->error	= error;
+					this->state->Complete();
+				}
+			}
+
+
+		private:
+
+			std::shared_ptr<internal::Shared<T>> state;
+			bool fulfilled = false;
+	};
+
+
+	// A future which, unlike std::future, can be shared and supports non-blocking continuations
+	// so that stages of a pipeline can be chained without a worker having to wait on a result.
+	//
+	//    auto decoded	= Async(pool, [&] { return Decode(frame); });
+	//    auto analysed	= decoded.Then(pool, [](const Image &image) { return Analyse(image); });
+	//
+	// If a stage throws, the exception is passed along the chain without invoking any of the
+	// subsequent continuations and is rethrown by Get().
+	template <typename T> class Future
+	{
+		public:
+
+			Future() = default;
+
+
+			bool Valid() const
+			{
+				return (bool)this->state;
+			}
+
+
+			bool Ready() const
+			{
+				std::lock_guard<std::mutex> lock(this->state->cs);
+				return this->state->ready;
+			}
+
+
+			// Block until the result is available. Prefer a continuation where possible.
+			void Wait() const
+			{
+				std::unique_lock<std::mutex> lock(this->state->cs);
+				this->state->condition.wait(lock, [&] { return this->state->ready; });
+			}
+
+
+			// Wait for and return the result, rethrowing any exception.
+			decltype(auto) Get() const
+			{
+				this->Wait();
+
+				if (this->state->error)
+				{
+					std::rethrow_exception(this->state->error);
+				}
+
+				if constexpr (!std::is_void_v<T>)
+				{
+					return static_cast<const T &>(*this->state->value);
+				}
+			}
+
+
+			// Queue a function on the pool once this future has completed successfully, it is passed the
+			// result (or no arguments for a void future). Returns a future for the result of the function.
+			template <typename F> auto Then(Executor &pool, F &&function)
+			{
+				using R = typename Result<F>::type;
+
+				Promise<R> promise;
+				auto result = promise.GetFuture();
+
+				this->state->Subscribe([state = this->state, &pool, promise = std::move(promise), function = std::forward<F>(function)]() mutable {
+					if (state->error)
+					{
+						promise.Fail(state->error);
+					}
+					else pool.Post([state, promise = std::move(promise), function = std::move(function)]() mutable {
+						internal::Fulfil(promise, [&] { return Call(function, *state); });
+					});
+				});
+
+				return result;
+			}
+
+
+			// As above but the function is invoked directly on the thread that completes this future,
+			// which is only suitable for functions that are cheap and do not block.
+			template <typename F> auto Then(F &&function)
+			{
+				using R = typename Result<F>::type;
+
+				Promise<R> promise;
+				auto result = promise.GetFuture();
+
+				this->state->Subscribe([state = this->state, promise = std::move(promise), function = std::forward<F>(function)]() mutable {
+					if (state->error)
+					{
+						promise.Fail(state->error);
+					}
+					else internal::Fulfil(promise, [&] { return Call(function, *state); });
+				});
+
+				return result;
+			}
+
+
+			// Invoke the continuation once this future has completed, whether it succeeded or failed.
+			// Used to build combinators such as WhenAll.
+			template <typename F> void Subscribe(F &&continuation) const
+			{
+				this->state->Subscribe(std::forward<F>(continuation));
+			}
+
+
+		private:
+
+			template <typename> friend class Promise;
+
+			explicit Future(std::shared_ptr<internal::Shared<T>> state) : state(std::move(state)) {}
+
+
+			template <typename F, typename V = T> struct Result				{ using type = std::invoke_result_t<F &, const V &>; };
+			template <typename F> struct Result<F, void>					{ using type = std::invoke_result_t<F &>; };
+
+
+			template <typename F> static decltype(auto) Call(F &function, internal::Shared<T> &state)
+			{
+				if constexpr (std::is_void_v<T>)
+				{
+					return function();
+				}
+				else return function(static_cast<const T &>(*state.value));
+			}
+
+
+			std::shared_ptr<internal::Shared<T>> state;
+	};
+
+
+	// Run a function on the pool and return a future for the result.
+	template <typename F> auto Async(Executor &pool, F &&function)
+	{
+		using R = std::invoke_result_t<std::decay_t<F> &>;
+
+		Promise<R> promise;
+		auto result = promise.GetFuture();
+
+		// If the pool refuses the job then it is destroyed along with the promise, breaking it
+		pool.Post([promise = std::move(promise), function = std::forward<F>(function)]() mutable {
+			internal::Fulfil(promise, function);
+		});
+
+		return result;
+	}
+
+
+	// A future that completes once all of the given futures have completed. The result is the
+	// values in the same order (or void), or the exception from the first future in the list
+	// that failed.
+	template <typename T> auto WhenAll(std::vector<Future<T>> futures)
+	{
+		using R = std::conditional_t<std::is_void_v<T>, void, std::vector<T>>;
+
+		struct State
+		{
+			Promise<R> promise;
+			std::vector<Future<T>> futures;
+			std::atomic<std::size_t> remaining;
+		};
+
+		auto state			= std::make_shared<State>();
+		auto result			= state->promise.GetFuture();
+		state->futures		= std::move(futures);
+		state->remaining	= state->futures.size();
+
+		auto complete = [](State &state) {
+			internal::Fulfil(state.promise, [&] {
+				if constexpr (std::is_void_v<T>)
+				{
+					for (auto &f : state.futures) f.Get();
+				}
+				else
+				{
+					std::vector<T> values;
+					values.reserve(state.futures.size());
+
+					for (auto &f : state.futures) values.push_back(f.Get());
+
+					return values;
+				}
+			});
+
+			// Break the reference cycle between the futures and their continuations
+			state.futures.clear();
+		};
+
+		if (state->futures.empty())
+		{
+			complete(*state);
+		}
+
+		// Iterate over a copy since the last continuation to run clears the list
+		for (auto f : std::vector<Future<T>>(state->futures))
+		{
+			f.Subscribe([state, complete] {
+				if (--state->remaining == 0)
+				{
+					complete(*state);
+				}
+			});
+		}
+
+		return result;
+	}
+
+
+	// A future that completes with the index of the first of the given futures to complete,
+	// whether it succeeded or failed.
+	template <typename T> Future<std::size_t> WhenAny(const std::vector<Future<T>> &futures)
+	{
+		struct State
+		{
+			Promise<std::size_t> promise;
+			std::atomic<bool> done = false;
+		};
+
+		auto state	= std::make_shared<State>();
+		auto result	= state->promise.GetFuture();
+
+		if (futures.empty())
+		{
+			state->promise.Fail(std::make_exception_ptr(std::invalid_argument("WhenAny requires at least one future")));
+		}
+
+		for (std::size_t i=0; i<futures.size(); i++)
+		{
+			futures[i].Subscribe([state, i] {
+				if (!state->done.exchange(true))
+				{
+					state->promise.Set(i);
+				}
+			});
+		}
+
+		return result;
+	}
+}
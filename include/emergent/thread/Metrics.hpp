@@ -0,0 +1,203 @@
+#pragma once
+
+#include <bit>
+#include <cmath>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+
+namespace emergent
+{
+	// A snapshot of a histogram of durations (in microseconds). The buckets are powers of two
+	// where bucket 0 holds durations of less than 1us and bucket i holds [2^(i-1), 2^i) us.
+	// Snapshots from different threads can be combined with the += operator.
+	struct Timings
+	{
+		static constexpr std::size_t BUCKETS = 32;
+
+		uint64_t samples	= 0;
+		uint64_t sum		= 0;
+		uint64_t squared	= 0;
+		uint64_t minimum	= 0;
+		uint64_t maximum	= 0;
+		std::array<uint64_t, BUCKETS> buckets = {};
+
+
+		Timings &operator+=(const Timings &other)
+		{
+			if (other.samples)
+			{
+				this->minimum = this->samples ? std::min(this->minimum, other.minimum) : other.minimum;
+				this->maximum = this->samples ? std::max(this->maximum, other.maximum) : other.maximum;
+			}
+
+			this->samples	+= other.samples;
+			this->sum		+= other.sum;
+			this->squared	+= other.squared;
+
+			for (std::size_t i=0; i<BUCKETS; i++)
+			{
+				this->buckets[i] += other.buckets[i];
+			}
+
+			return *this;
+		}
+
+
+		double Mean() const
+		{
+			return this->samples ? (double)this->sum / this->samples : 0.0;
+		}
+
+
+		// An upper bound for the given percentile (0 to 100) of durations, limited to the resolution
+		// of the buckets but clamped to the actual maximum.
+		uint64_t Percentile(const double percentile) const
+		{
+			const auto target	= (uint64_t)std::ceil(this->samples * std::clamp(percentile, 0.0, 100.0) / 100.0);
+			uint64_t count		= 0;
+
+			for (std::size_t i=0; i<BUCKETS; i++)
+			{
+				count += this->buckets[i];
+
+				if (count && count >= target)
+				{
+					return std::min<uint64_t>(i ? (uint64_t)1 << i : 1, this->maximum);
+				}
+			}
+
+			return this->maximum;
+		}
+	};
+
+
+	// A histogram of durations that is owned by a single writer thread, which means that
+	// recording does not need any read-modify-write atomics. Other threads may read a snapshot
+	// at any time, although it is not guaranteed to be consistent across the individual fields.
+	class Histogram
+	{
+		public:
+
+			void Record(const std::chrono::steady_clock::duration duration)
+			{
+				const auto us	= (uint64_t)std::max<int64_t>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count(), 0);
+				const auto n	= this->samples.load(std::memory_order_relaxed);
+
+				Add(this->sum, us);
+				Add(this->squared, us * us);
+				Add(this->buckets[std::min<std::size_t>(std::bit_width(us), Timings::BUCKETS - 1)], 1);
+
+				if (!n || us < this->minimum.load(std::memory_order_relaxed)) this->minimum.store(us, std::memory_order_relaxed);
+				if (!n || us > this->maximum.load(std::memory_order_relaxed)) this->maximum.store(us, std::memory_order_relaxed);
+
+				this->samples.store(n + 1, std::memory_order_relaxed);
+			}
+
+
+			Timings Read() const
+			{
+				Timings result;
+
+				result.samples	= this->samples.load(std::memory_order_relaxed);
+				result.sum		= this->sum.load(std::memory_order_relaxed);
+				result.squared	= this->squared.load(std::memory_order_relaxed);
+				result.minimum	= this->minimum.load(std::memory_order_relaxed);
+				result.maximum	= this->maximum.load(std::memory_order_relaxed);
+
+				for (std::size_t i=0; i<Timings::BUCKETS; i++)
+				{
+					result.buckets[i] = this->buckets[i].load(std::memory_order_relaxed);
+				}
+
+				return result;
+			}
+
+
+		private:
+
+			// Only valid for a single writer
+			static void Add(std::atomic<uint64_t> &counter, const uint64_t value)
+			{
+				counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+			}
+
+			std::atomic<uint64_t> samples	= 0;
+			std::atomic<uint64_t> sum		= 0;
+			std::atomic<uint64_t> squared	= 0;
+			std::atomic<uint64_t> minimum	= 0;
+			std::atomic<uint64_t> maximum	= 0;
+			std::array<std::atomic<uint64_t>, Timings::BUCKETS> buckets = {};
+	};
+
+
+	// A counter that is owned by a single writer thread.
+	class Counter
+	{
+		public:
+
+			void Increment(const uint64_t value = 1)
+			{
+				this->value.store(this->value.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+			}
+
+			uint64_t Read() const
+			{
+				return this->value.load(std::memory_order_relaxed);
+			}
+
+		private:
+
+			std::atomic<uint64_t> value = 0;
+	};
+
+
+	// Snapshot of the metrics for a thread pool. Timings are only recorded while
+	// instrumentation is enabled on the pool but the counters are always maintained.
+	struct PoolMetrics
+	{
+		struct Worker
+		{
+			uint64_t executed	= 0;	// Jobs executed by this worker
+			uint64_t stolen		= 0;	// Jobs taken from the deque of another worker
+			Timings latency;			// Time from submission to the start of execution
+			Timings execution;			// Time spent executing jobs
+		};
+
+		std::size_t queued		= 0;	// Approximate number of jobs in the shared lanes
+		std::size_t pending		= 0;	// Approximate number of jobs waiting anywhere in the pool
+		std::size_t timers		= 0;	// Delayed and periodic jobs that are waiting to fire
+		std::size_t threads		= 0;	// Workers currently running
+		uint64_t grown			= 0;	// Workers added by an elastic pool
+		uint64_t retired		= 0;	// Idle workers retired by an elastic pool
+		double utilisation		= 0;	// Fraction of worker time spent executing jobs (only while instrumented)
+		uint64_t rejected		= 0;	// Submissions that were refused because the shared queue was full
+		uint64_t executed		= 0;
+		Timings latency;
+		Timings execution;
+		std::vector<Worker> workers;
+	};
+
+
+	// Snapshot of the metrics for an agent.
+	struct AgentMetrics
+	{
+		uint64_t polls		= 0;
+		uint64_t commands	= 0;	// Commands executed from the mailbox
+		uint64_t overruns	= 0;	// Interval mode polls that took longer than the period
+		Timings poll;				// Time spent in Poll()
+	};
+
+
+	// Snapshot of the metrics for a persistent thread.
+	struct ThreadMetrics
+	{
+		uint64_t executed	= 0;
+		uint64_t rejected	= 0;	// Assignments refused because the thread was busy
+		Timings execution;
+	};
+}
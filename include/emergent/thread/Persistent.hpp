@@ -3,38 +3,13 @@
 #include <mutex>
 #include <thread>
 #include <future>
+#include <emergent/thread/Task.hpp>
+#include <emergent/thread/Metrics.hpp>
+#include <emergent/thread/Attributes.hpp>
 
 
 namespace emergent
 {
-	namespace internal
-	{
-		// A base class allows the thread pool to queue tasks of arbitrary return type.
-		struct TaskBase { virtual void Run() = 0; };
-
-		// Task is separated out from the ThreadPool class since it requires
-		// a specialisation to handle the "void" case for promise.
-		template <typename T> struct Task : public TaskBase
-		{
-			std::promise<T> promise;
-			std::function<T()> job;
-
-			Task(std::function<T()> &&job) : job(std::move(job)) {}
-
-			inline void Run()
-			{
-				this->promise.set_value(this->job());
-			}
-		};
-
-		template <> inline void Task<void>::Run()
-		{
-			this->job();
-			this->promise.set_value();
-		}
-	}
-
-
 	// A thread that does not exit when it has finished executing but waits
 	// until it is assigned another job. An alternative to using std::async() where
 	// a new thread is created each time (under gcc/clang).
@@ -42,11 +17,13 @@ namespace emergent
 	{
 		public:
 
-			PersistentThread()
+			explicit PersistentThread(const ThreadAttributes &attributes = {})
 			{
 				using namespace std::chrono;
 
-				this->thread = std::thread([&] {
+				this->thread = std::thread([this, attributes] {
+					attributes.Apply();
+
 					std::unique_lock<std::mutex> lock(this->cs);
 
 					this->run	= true;
@@ -54,11 +31,17 @@ namespace emergent
 
 					while (this->run)
 					{
-						if (this->task)
+						if (this->job)
 						{
-							this->task->Run();
-							this->task = nullptr;
-							this->ready = true;
+							const auto start = steady_clock::now();
+
+							internal::Invoke(this->job);
+
+							this->execution.Record(steady_clock::now() - start);
+							this->executed.Increment();
+
+							this->job	= {};
+							this->ready	= true;
 						}
 
 						this->condition.wait(lock);
@@ -91,18 +74,32 @@ namespace emergent
 			// assign the second task.
 			template <typename T> auto Run(T &&job) -> std::future<decltype(job())>
 			{
-				std::lock_guard<std::mutex> lock(this->cs);
+				auto [task, result] = internal::Package(std::forward<T>(job));
 
-				if (this->Ready())
-				{
-					this->task	= std::make_shared<internal::Task<decltype(job())>>(std::move(job));
-					this->ready	= false;
-					this->condition.notify_one();
+				return this->Assign(std::move(task)) ? std::move(result) : std::future<decltype(job())> {};
+			}
+
+
+			// Fire-and-forget version of Run which does not create a promise and future.
+			// Returns false if unable to assign the job.
+			template <typename T> bool Post(T &&job)
+			{
+				return this->Assign(internal::Job(std::forward<T>(job)));
+			}
 
-					return std::static_pointer_cast<internal::Task<decltype(job())>>(this->task)->promise.get_future();
-				}
 
-				return {};
+			// Cancellable versions of Run and Post. If a stop has been requested before the thread
+			// starts the job then it is skipped (and the future throws Cancelled), a job that
+			// accepts a std::stop_token is passed the token so that it can finish early.
+			template <typename T> auto Run(std::stop_token token, T &&job)
+			{
+				return this->Run(internal::Cancellable(std::move(token), std::forward<T>(job)));
+			}
+
+
+			template <typename T> bool Post(std::stop_token token, T &&job)
+			{
+				return this->Post(internal::Cancellable(std::move(token), std::forward<T>(job)));
 			}
 
 
@@ -112,28 +109,49 @@ namespace emergent
 			}
 
 
-			// Directly assign a task to the thread and wake it up. This can be used
-			// by a thread pool to allocate tasks but the Run function is the
-			// recommended method in other situations.
-			void Assign(std::shared_ptr<internal::TaskBase> task)
+			// Directly assign a job to the thread and wake it up. This can be used
+			// by a thread pool to allocate jobs but the Run function is the
+			// recommended method in other situations. Returns false if the thread
+			// is busy.
+			bool Assign(internal::Job &&job)
 			{
 				std::lock_guard<std::mutex> lock(this->cs);
 
-				this->task	= task;
-				this->ready	= false;
-				this->condition.notify_one();
+				if (this->Ready())
+				{
+					this->job	= std::move(job);
+					this->ready	= false;
+					this->condition.notify_one();
+
+					return true;
+				}
+
+				this->rejected.Increment();
+
+				return false;
 			}
 
 
+			// Take a snapshot of the runtime metrics for this thread.
+			ThreadMetrics Metrics() const
+			{
+				return { this->executed.Read(), this->rejected.Read(), this->execution.Read() };
+			}
+
 
 		private:
 
 			std::mutex cs;
 			std::thread thread;
 			std::condition_variable condition;
-			std::shared_ptr<internal::TaskBase> task;
+			internal::Job job;
 			std::atomic<bool> run	= false;
 			std::atomic<bool> ready = false;
 
+			// Instrumentation, the rejected count is only written while holding the mutex
+			Counter executed;
+			Counter rejected;
+			Histogram execution;
+
 	};
 }
@@ -1,60 +1,173 @@
 #pragma once
 
-#include <queue>
+#include <array>
+#include <memory>
+#include <vector>
+#include <optional>
+#include <coroutine>
+#include <algorithm>
 #include <emergent/thread/Persistent.hpp>
+#include <emergent/thread/BoundedQueue.hpp>
+#include <emergent/thread/Metrics.hpp>
+#include <emergent/thread/Attributes.hpp>
 
 
 namespace emergent
 {
-	// A simple thread pool implementation. The size of the pool is determined
-	// by the first template argument.
-	template <std::size_t N> class ThreadPool
+	// Priority classes for jobs submitted to a pool, each of which has a separate lane.
+	enum class Priority
+	{
+		High,		// Latency critical work such as real-time frame processing
+		Normal,
+		Low			// Bulk or background work such as archival encoding
+	};
+
+
+	// How a job is ordered relative to the others waiting in a pool. Within a lane, jobs with
+	// a deadline are taken earliest-deadline-first ahead of those without one. The deadline
+	// only affects ordering, a job is still run if its deadline has passed.
+	struct Precedence
+	{
+		Priority priority = Priority::Normal;
+		std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+
+		Precedence(const Priority priority = Priority::Normal, const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max())
+			: priority(priority), deadline(deadline) {}
+	};
+
+
+	// A handle to a job scheduled with Executor::RunAt, RunAfter or RunEvery. Copies of a
+	// handle refer to the same timer and dropping the handle does not cancel it.
+	class TimerHandle
 	{
 		public:
 
-			// The ThreadPool launches an additional thread to manage the queue.
-			ThreadPool()
+			TimerHandle() = default;
+
+
+			// Prevent the job from running, or from running again if it is periodic. Returns false
+			// if the job has already run (or is running) or the timer was already cancelled.
+			// It does not wait for a job that is currently executing.
+			bool Cancel()
 			{
-				using namespace std::chrono;
+				auto expected = ARMED;
+				return this->state && this->state->compare_exchange_strong(expected, CANCELLED);
+			}
 
-				this->thread = std::thread([&]{
 
-					std::unique_lock<std::mutex> lock(this->cs);
+			bool Cancelled() const
+			{
+				return this->state && *this->state == CANCELLED;
+			}
 
-					while (this->run)
-					{
-						if (!this->queue.empty())
-						{
-							for (auto &t : this->threads)
-							{
-								if (t.Ready())
-								{
-									t.Assign(this->queue.front());
-									this->queue.pop();
-									break;
-								}
-							}
 
-							// Allow this thread to sleep and items to be added to
-							// the queue even if there are no available threads.
-							this->condition.wait_for(lock, 10us);
-						}
-						else this->condition.wait(lock);
-					}
+			bool Valid() const
+			{
+				return (bool)this->state;
+			}
+
+
+		private:
+
+			friend class Executor;
 
-				});
+			static constexpr int ARMED		= 0;
+			static constexpr int FIRED		= 1;
+			static constexpr int CANCELLED	= 2;
+
+			explicit TimerHandle(std::shared_ptr<std::atomic<int>> state) : state(std::move(state)) {}
+
+			std::shared_ptr<std::atomic<int>> state;
+	};
+
+
+	// The bounds for the number of workers in an elastic pool. Workers are added, up to the
+	// maximum, while jobs continue to queue up with none of the workers idle, and a worker
+	// that has been idle for the keep-alive period is retired if there are more than the
+	// minimum running.
+	struct Elasticity
+	{
+		std::size_t minimum = 1;
+		std::size_t maximum = 1;
+		std::chrono::steady_clock::duration keepAlive = std::chrono::seconds(30);
+	};
+
+
+	// A work-stealing thread pool where the number of workers is determined at runtime.
+	// Each worker owns a deque of tasks: jobs submitted from within a worker are pushed
+	// to (and popped from) the back of that worker's own deque, whilst idle workers steal
+	// from the front of the other deques. Jobs submitted from outside of the pool are placed
+	// in shared lanes of fixed capacity, one per priority, which provide backpressure to
+	// producers. Workers look for high priority work first but, so that a constant stream
+	// of high priority jobs cannot starve the lower lanes, every few searches are made in
+	// reverse order. Workers that cannot find anything to do will park until notified rather
+	// than polling, so an idle pool does not consume any CPU. Delayed and periodic jobs are
+	// kept in a timer heap that is serviced by the workers themselves, with one of the parked
+	// workers sleeping until the earliest timer is due. The pool can either have a fixed number
+	// of workers or be elastic, growing and shrinking between bounds to suit the hardware and
+	// the load.
+	//
+	//    Executor pool({ 2, std::thread::hardware_concurrency(), 10s });
+	//    auto timeout = pool.RunAfter(500ms, [&] { Abort(); });
+	//    auto flush   = pool.RunEvery(1s, [&] { log.Flush(); });
+	//    timeout.Cancel();
+	class Executor
+	{
+		public:
+
+			// Default capacity of each shared lane
+			static const std::size_t CAPACITY = 1024;
+
+
+			// The capacity is the maximum number of jobs that can be waiting in each shared lane.
+			// The attributes are applied to every worker (see ThreadAttributes::For).
+			explicit Executor(const std::size_t size, const std::size_t capacity = CAPACITY, const ThreadAttributes &attributes = {})
+				: Executor(Elasticity { size, size }, capacity, attributes) {}
+
+
+			// An elastic pool which starts with the minimum number of workers.
+			explicit Executor(const Elasticity &elasticity, const std::size_t capacity = CAPACITY, const ThreadAttributes &attributes = {})
+				: lanes { Lane(capacity), Lane(capacity), Lane(capacity) },
+				  minimum(std::max<std::size_t>(elasticity.minimum, 1)),
+				  maximum(std::max(elasticity.maximum, this->minimum)),
+				  keepAlive(elasticity.keepAlive),
+				  attributes(attributes),
+				  workers(this->maximum)
+			{
+				std::lock_guard<std::mutex> lock(this->resize);
+
+				for (std::size_t i=0; i<this->minimum; i++)
+				{
+					this->Spawn(i);
+				}
 			}
 
 
 			// Whilst the futures returned by Run() will not block, the destruction
 			// of the pool will wait for all threads to complete their current tasks.
-			~ThreadPool()
+			// Any tasks still queued are discarded and their futures will be broken.
+			~Executor()
 			{
+				// Holding the resize mutex ensures that no more workers are spawned
+				this->resize.lock();
+					this->park.lock();
+						this->run = false;
+					this->park.unlock();
+				this->resize.unlock();
+
+				this->condition.notify_all();
+
 				this->cs.lock();
-					this->run = false;
 				this->cs.unlock();
-				this->condition.notify_one();
-				this->thread.join();
+				this->space.notify_all();
+
+				for (auto &w : this->workers)
+				{
+					if (w.thread.joinable())
+					{
+						w.thread.join();
+					}
+				}
 			}
 
 
@@ -62,39 +175,930 @@ namespace emergent
 			// you can wait for the job to finish and potentially retrieve the result,
 			// but unlike with std::async the future does not automatically wait on
 			// destruction which means you can fire-and-forget if necessary.
+			// If the shared queue is full this will block until there is space, an invalid
+			// future is only returned if the pool is destroyed whilst waiting.
 			template <typename T> auto Run(T &&job) -> std::future<decltype(job())>
 			{
-				std::lock_guard<std::mutex> lock(this->cs);
+				return this->Run(Precedence(), std::forward<T>(job));
+			}
+
+
+			// Run the job with the given priority and optional deadline.
+			//
+			//    pool.Run(Priority::High, [&] { Inspect(frame); });
+			//    pool.Run({ Priority::High, start + 5ms }, [&] { Inspect(frame); });
+			template <typename T> auto Run(const Precedence &precedence, T &&job) -> std::future<decltype(job())>
+			{
+				return this->Submit(std::forward<T>(job), precedence, Clock::time_point::max()).value_or(
+					std::future<decltype(job())> {}
+				);
+			}
+
+
+			// Run a job that can be cancelled. If a stop has been requested by the time a worker
+			// reaches the job then it is dropped without running and the future throws Cancelled.
+			// A job that accepts a std::stop_token is passed the token so that it can poll it and
+			// finish early, freeing the worker for current work.
+			//
+			//    std::stop_source frame;
+			//    pool.Run(frame.get_token(), [&](std::stop_token token) { Analyse(image, token); });
+			//    frame.request_stop();
+			template <typename T> auto Run(std::stop_token token, T &&job)
+			{
+				return this->Run(Precedence(), std::move(token), std::forward<T>(job));
+			}
+
+
+			template <typename T> auto Run(const Precedence &precedence, std::stop_token token, T &&job)
+			{
+				return this->Run(precedence, internal::Cancellable(std::move(token), std::forward<T>(job)));
+			}
+
+
+			// Attempt to run the job without blocking. If the shared queue is full the job
+			// is not accepted and an empty optional is returned.
+			template <typename T> auto TryRun(T &&job) -> std::optional<std::future<decltype(job())>>
+			{
+				return this->TryRun(Precedence(), std::forward<T>(job));
+			}
+
+
+			template <typename T> auto TryRun(const Precedence &precedence, T &&job) -> std::optional<std::future<decltype(job())>>
+			{
+				return this->Submit(std::forward<T>(job), precedence, Clock::time_point::min());
+			}
+
+
+			// Run the job on a worker once the given time has been reached. Timed jobs do not go
+			// through the shared lanes and so are never rejected, any that have not fired when
+			// the pool is destroyed are discarded. The job is run directly by the worker that
+			// finds it due, ahead of any queued work.
+			template <typename T> TimerHandle RunAt(const std::chrono::steady_clock::time_point due, T &&job)
+			{
+				return this->Arm(due, Clock::duration::zero(), std::forward<T>(job));
+			}
+
+
+			// Run the job on a worker once the delay has elapsed.
+			template <typename R, typename P, typename T> TimerHandle RunAfter(const std::chrono::duration<R, P> &delay, T &&job)
+			{
+				return this->RunAt(Clock::now() + std::chrono::ceil<Clock::duration>(delay), std::forward<T>(job));
+			}
+
+
+			// Run the job repeatedly, starting one period from now, until the timer is cancelled.
+			// Like AgentMode::Interval the schedule is maintained relative to the first run but
+			// if a run overruns then the missed periods are skipped. Runs of the same job never
+			// overlap since the next run is only scheduled once the current one has finished.
+			template <typename R, typename P, typename T> TimerHandle RunEvery(const std::chrono::duration<R, P> &period, T &&job)
+			{
+				const auto interval = std::max<Clock::duration>(std::chrono::ceil<Clock::duration>(period), Clock::duration(1));
+
+				return this->Arm(Clock::now() + interval, interval, std::forward<T>(job));
+			}
+
+
+			// Attempt to run the job, waiting up to the timeout for space in the shared queue.
+			// If the job could not be accepted in time then an empty optional is returned.
+			template <typename R, typename P, typename T> auto RunFor(const std::chrono::duration<R, P> &timeout, T &&job)
+				-> std::optional<std::future<decltype(job())>>
+			{
+				return this->Submit(std::forward<T>(job), Precedence(), Clock::now() + std::chrono::ceil<Clock::duration>(timeout));
+			}
+
+
+			// Fire-and-forget version of Run which skips the creation of a promise and future
+			// entirely. Any exception thrown by the job is discarded. Like Run, this will block
+			// if the shared queue is full and returns false if the pool is being destroyed.
+			template <typename T> bool Post(T &&job)
+			{
+				return this->Post(Precedence(), std::forward<T>(job));
+			}
+
+
+			template <typename T> bool Post(const Precedence &precedence, T &&job)
+			{
+				return this->Push(internal::Job(std::forward<T>(job)), precedence, Clock::time_point::max());
+			}
 
-				if (this->queue.size() < QUEUE_MAX)
+
+			// Fire-and-forget version of the cancellable Run.
+			template <typename T> bool Post(std::stop_token token, T &&job)
+			{
+				return this->Post(Precedence(), std::move(token), std::forward<T>(job));
+			}
+
+
+			template <typename T> bool Post(const Precedence &precedence, std::stop_token token, T &&job)
+			{
+				return this->Post(precedence, internal::Cancellable(std::move(token), std::forward<T>(job)));
+			}
+
+
+			// Awaitable that suspends a coroutine and resumes it on one of the workers.
+			//
+			//    co_await pool.Schedule();
+			//
+			// If the pool is being destroyed then the coroutine simply continues on the current thread.
+			auto Schedule(const Precedence &precedence = {})
+			{
+				struct Awaiter
 				{
-					auto task = std::make_shared<internal::Task<decltype(job())>>(std::move(job));
+					Executor &pool;
+					Precedence precedence;
+
+					bool await_ready() const { return false; }
+					bool await_suspend(std::coroutine_handle<> handle) { return this->pool.Post(this->precedence, [handle] { handle.resume(); }); }
+					void await_resume() const {}
+				};
+
+				return Awaiter { *this, precedence };
+			}
 
-					this->queue.push(task);
-					this->condition.notify_one();
 
-					return task->promise.get_future();
+			// The maximum number of jobs that can be waiting in each shared lane.
+			std::size_t Capacity() const
+			{
+				return this->lanes[0].Capacity();
+			}
+
+
+			// The number of worker threads currently running in this pool.
+			std::size_t Size() const
+			{
+				return this->active;
+			}
+
+
+			std::size_t Minimum() const { return this->minimum; }
+			std::size_t Maximum() const { return this->maximum; }
+
+
+			// Enable or disable the recording of latency and execution timings, which costs a
+			// couple of clock reads per job. The counters are always maintained.
+			void Instrument(const bool enabled)
+			{
+				this->instrument = enabled;
+			}
+
+
+			// Take a snapshot of the runtime metrics. Each worker only updates its own metrics
+			// so this does not interfere with the workers, but the values are approximate.
+			PoolMetrics Metrics() const
+			{
+				PoolMetrics result;
+
+				for (auto &l : this->lanes)
+				{
+					result.queued += l.SizeApprox();
+				}
+
+				result.pending	= this->pending;
+				result.rejected	= this->rejected;
+
+				this->timing.lock();
+					result.timers = this->timers.size();
+				this->timing.unlock();
+
+				// Total time that workers have been running, for the utilisation
+				Clock::duration lifetime {};
+
+				this->resize.lock();
+					const auto now	= Clock::now();
+					result.threads	= this->active;
+					result.grown	= this->grown;
+					result.retired	= this->retired;
+
+					for (auto &w : this->workers)
+					{
+						lifetime += w.running ? w.lifetime + (now - w.started) : w.lifetime;
+					}
+				this->resize.unlock();
+
+				for (auto &w : this->workers)
+				{
+					auto &m		= result.workers.emplace_back();
+					m.executed	= w.executed.Read();
+					m.stolen	= w.stolen.Read();
+					m.latency	= w.latency.Read();
+					m.execution	= w.execution.Read();
+
+					result.executed		+= m.executed;
+					result.latency		+= m.latency;
+					result.execution	+= m.execution;
+				}
+
+				if (const auto us = std::chrono::duration_cast<std::chrono::microseconds>(lifetime).count(); us > 0)
+				{
+					result.utilisation = std::min(1.0, (double)result.execution.sum / us);
 				}
 
-				return {};
+				return result;
 			}
 
 
 		private:
 
-			// Maximum queue size
-			static const int QUEUE_MAX = 1024;
+			using Clock = std::chrono::steady_clock;
+
+			// Number of unsuccessful search rounds a worker makes before parking
+			static const int SPIN = 64;
+
+			// One in this many searches by a worker starts from the lowest priority lane
+			static const int FAIRNESS = 8;
+
+			// How long jobs must have been queueing before an elastic pool adds a worker
+			static constexpr std::chrono::milliseconds SUSTAINED { 1 };
+
+
+			// A queued job along with the time it was submitted (only when instrumented)
+			// and the deadline used for ordering
+			struct Ticket
+			{
+				internal::Job job;
+				Clock::time_point queued;
+				Clock::time_point deadline = Clock::time_point::max();
+
+				explicit operator bool() const { return (bool)this->job; }
+				bool operator>(const Ticket &other) const { return this->deadline > other.deadline; }
+			};
+
+
+			// A shared lane for a single priority. Jobs without a deadline go into a lock-free FIFO
+			// whilst those with a deadline are kept in a heap, which is only locked when non-empty.
+			// Both parts have the same capacity.
+			class Lane
+			{
+				public:
+
+					explicit Lane(const std::size_t capacity) : fifo(capacity) {}
+
+
+					bool TryPush(Ticket &&task)
+					{
+						if (task.deadline == Clock::time_point::max())
+						{
+							return this->fifo.TryPush(std::move(task));
+						}
+
+						std::lock_guard<std::mutex> lock(this->cs);
+
+						if (this->timed.size() >= this->fifo.Capacity())
+						{
+							return false;
+						}
+
+						this->timed.push_back(std::move(task));
+						std::push_heap(this->timed.begin(), this->timed.end(), std::greater<Ticket>());
+						this->size++;
+
+						return true;
+					}
+
+
+					bool TryPop(Ticket &task)
+					{
+						if (this->size > 0)
+						{
+							std::lock_guard<std::mutex> lock(this->cs);
+
+							if (!this->timed.empty())
+							{
+								std::pop_heap(this->timed.begin(), this->timed.end(), std::greater<Ticket>());
+								task = std::move(this->timed.back());
+								this->timed.pop_back();
+								this->size--;
+
+								return true;
+							}
+						}
+
+						return this->fifo.TryPop(task);
+					}
+
+
+					std::size_t Capacity() const
+					{
+						return this->fifo.Capacity();
+					}
+
+
+					std::size_t SizeApprox() const
+					{
+						return this->fifo.SizeApprox() + this->size;
+					}
+
+
+				private:
+
+					BoundedQueue<Ticket> fifo;
+					std::mutex cs;
+					std::vector<Ticket> timed;
+					std::atomic<std::size_t> size = 0;
+			};
+
+
+			// The deque is a vector where jobs before "first" have already been stolen. Unlike
+			// std::deque it does not release memory as it drains so that steady state operation
+			// does not allocate. The worker mutex must be held when using these functions.
+			struct Worker
+			{
+				std::mutex cs;
+				std::vector<Ticket> jobs;
+				std::size_t first = 0;
+				std::thread thread;
+
+				// Metrics which are only written by the thread of this worker
+				Counter executed;
+				Counter stolen;
+				Histogram latency;
+				Histogram execution;
+
+				// Number of searches made by this worker, used for fairness between the lanes
+				unsigned turn = 0;
+
+				// Whether a thread is running for this worker slot and for how long it has run,
+				// these are protected by the resize mutex.
+				bool running = false;
+				Clock::time_point started;
+				Clock::duration lifetime {};
+
+				bool Empty() const
+				{
+					return this->first == this->jobs.size();
+				}
+
+				void PushBack(Ticket &job)
+				{
+					// Compact once the stolen portion dominates the vector
+					if (this->first > 32 && this->first * 2 > this->jobs.size())
+					{
+						this->jobs.erase(this->jobs.begin(), this->jobs.begin() + this->first);
+						this->first = 0;
+					}
+
+					this->jobs.push_back(std::move(job));
+				}
+
+				void PopBack(Ticket &job)
+				{
+					job = std::move(this->jobs.back());
+					this->jobs.pop_back();
+					this->Trim();
+				}
+
+				void PopFront(Ticket &job)
+				{
+					job = std::move(this->jobs[this->first++]);
+					this->Trim();
+				}
+
+				void Trim()
+				{
+					if (this->Empty())
+					{
+						this->jobs.clear();
+						this->first = 0;
+					}
+				}
+			};
+
+
+			// A job waiting in the timer heap. A zero period means that it only runs once.
+			struct Alarm
+			{
+				Clock::time_point due;
+				Clock::duration period;
+				internal::Job job;
+				std::shared_ptr<std::atomic<int>> state;
+
+				bool operator>(const Alarm &other) const { return this->due > other.due; }
+			};
+
+
+			// Identifies the pool and worker that the current thread belongs to (if any)
+			// so that submissions from within a job go straight to the local deque.
+			static inline thread_local Executor *owner	= nullptr;
+			static inline thread_local std::size_t self	= 0;
+
+
+			template <typename T> auto Submit(T &&job, const Precedence &precedence, const Clock::time_point deadline) -> std::optional<std::future<decltype(job())>>
+			{
+				auto [task, result] = internal::Package(std::forward<T>(job));
+
+				if (this->Push(std::move(task), precedence, deadline))
+				{
+					return std::move(result);
+				}
+
+				return std::nullopt;
+			}
 
-			// Threading members
+
+			// Jobs submitted from a worker are never rejected since the local deque is unbounded,
+			// this also ensures that a job cannot deadlock the pool by waiting for queue space.
+			// Prioritised jobs from a worker go to the shared lanes so that they are ordered
+			// correctly, falling back to the local deque if the lane is full.
+			// A deadline of time_point::min() means do not wait and time_point::max() means wait
+			// indefinitely for space in the shared lane.
+			bool Push(internal::Job &&job, const Precedence &precedence, const Clock::time_point deadline)
+			{
+				Ticket task { std::move(job), this->instrument ? Clock::now() : Clock::time_point(), precedence.deadline };
+
+				auto &lane			= this->lanes[(int)precedence.priority];
+				const bool local	= precedence.priority == Priority::Normal && precedence.deadline == Clock::time_point::max();
+
+				// Counted before the job is visible to the workers, otherwise a worker could take it
+				// and decrement the count first, wrapping it. Undone if the job is rejected.
+				this->pending++;
+
+				if (owner == this)
+				{
+					if (local || !lane.TryPush(std::move(task)))
+					{
+						auto &w = this->workers[self];
+
+						w.cs.lock();
+							w.PushBack(task);
+						w.cs.unlock();
+					}
+				}
+				else if (!lane.TryPush(std::move(task)))
+				{
+					if (deadline == Clock::time_point::min())
+					{
+						this->pending--;
+						this->rejected++;
+						return false;
+					}
+
+					// The mutex is only used by producers that are waiting for space
+					std::unique_lock<std::mutex> lock(this->cs);
+
+					this->blocked++;
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+
+					bool pushed = false;
+
+					while (this->run && !(pushed = lane.TryPush(std::move(task))))
+					{
+						if (deadline == Clock::time_point::max())
+						{
+							this->space.wait(lock);
+						}
+						else if (this->space.wait_until(lock, deadline) == std::cv_status::timeout)
+						{
+							pushed = this->run && lane.TryPush(std::move(task));
+							break;
+						}
+					}
+
+					this->blocked--;
+
+					if (!pushed)
+					{
+						this->pending--;
+						this->rejected++;
+						return false;
+					}
+				}
+
+				this->Wake();
+				this->Grow();
+
+				return true;
+			}
+
+
+			// Start a thread for the worker slot, the resize mutex must be held.
+			void Spawn(const std::size_t index)
+			{
+				auto &w = this->workers[index];
+
+				// The previous thread for this slot has retired but may not have finished exiting
+				if (w.thread.joinable())
+				{
+					w.thread.join();
+				}
+
+				w.running	= true;
+				w.started	= Clock::now();
+				w.thread	= std::thread(&Executor::Entry, this, index);
+
+				this->active++;
+			}
+
+
+			// Add a worker if jobs have been queueing up, with none of the workers idle, for
+			// longer than SUSTAINED. This is checked on every submission and after every job
+			// so the common case must be cheap.
+			void Grow()
+			{
+				if (this->active >= this->maximum)
+				{
+					return;
+				}
+
+				if (this->sleeping > 0 || this->pending <= this->active)
+				{
+					this->backlog = 0;
+					return;
+				}
+
+				const auto now	= Clock::now().time_since_epoch().count();
+				auto since		= this->backlog.load();
+
+				if (since == 0)
+				{
+					this->backlog.compare_exchange_strong(since, now);
+				}
+				else if (Clock::duration(now - since) >= SUSTAINED)
+				{
+					std::lock_guard<std::mutex> lock(this->resize);
+
+					if (this->run && this->active < this->maximum && this->backlog == since)
+					{
+						const auto slot = std::find_if(this->workers.begin(), this->workers.end(), [](auto &w) { return !w.running; });
+
+						this->Spawn(slot - this->workers.begin());
+						this->grown++;
+						this->backlog = 0;
+					}
+				}
+			}
+
+
+			// Retire the worker if there are more than the minimum running.
+			bool Retire(const std::size_t index)
+			{
+				std::lock_guard<std::mutex> lock(this->resize);
+
+				if (this->run && this->active > this->minimum)
+				{
+					auto &w = this->workers[index];
+
+					w.running	= false;
+					w.lifetime	+= Clock::now() - w.started;
+
+					this->active--;
+					this->retired++;
+
+					return true;
+				}
+
+				return false;
+			}
+
+
+			template <typename T> TimerHandle Arm(const Clock::time_point due, const Clock::duration period, T &&job)
+			{
+				auto state = std::make_shared<std::atomic<int>>(TimerHandle::ARMED);
+
+				this->Arm({ due, period, internal::Job(std::forward<T>(job)), state });
+
+				return TimerHandle(std::move(state));
+			}
+
+
+			void Arm(Alarm &&alarm)
+			{
+				const auto due = alarm.due.time_since_epoch().count();
+
+				this->timing.lock();
+					this->timers.push_back(std::move(alarm));
+					std::push_heap(this->timers.begin(), this->timers.end(), std::greater<Alarm>());
+
+					const bool earlier = due < this->earliest;
+					this->earliest = this->timers.front().due.time_since_epoch().count();
+				this->timing.unlock();
+
+				// The worker that is keeping time may be waiting for a later deadline, so wake all of
+				// the parked workers and let them decide between themselves which one keeps time.
+				if (earlier && this->sleeping > 0)
+				{
+					this->park.lock();
+					this->park.unlock();
+					this->condition.notify_all();
+				}
+			}
+
+
+			bool Due() const
+			{
+				const auto earliest = this->earliest.load();
+
+				return earliest != Clock::time_point::max().time_since_epoch().count()
+					&& Clock::now().time_since_epoch().count() >= earliest;
+			}
+
+
+			// Run the earliest timer if it is due, re-arming it if it is periodic.
+			bool Expire(Worker &worker)
+			{
+				if (!this->Due())
+				{
+					return false;
+				}
+
+				std::unique_lock<std::mutex> lock(this->timing);
+
+				if (this->timers.empty() || this->timers.front().due > Clock::now())
+				{
+					return false;
+				}
+
+				std::pop_heap(this->timers.begin(), this->timers.end(), std::greater<Alarm>());
+				auto alarm = std::move(this->timers.back());
+				this->timers.pop_back();
+
+				this->earliest = this->timers.empty()
+					? Clock::time_point::max().time_since_epoch().count()
+					: this->timers.front().due.time_since_epoch().count();
+
+				lock.unlock();
+
+				auto expected		= TimerHandle::ARMED;
+				const bool periodic	= alarm.period != Clock::duration::zero();
+
+				if (periodic ? *alarm.state == TimerHandle::ARMED : alarm.state->compare_exchange_strong(expected, TimerHandle::FIRED))
+				{
+					const auto start = Clock::now();
+
+					internal::Invoke(alarm.job);
+
+					if (this->instrument)
+					{
+						worker.latency.Record(start - alarm.due);
+						worker.execution.Record(Clock::now() - start);
+					}
+
+					worker.executed.Increment();
+
+					if (periodic && *alarm.state == TimerHandle::ARMED)
+					{
+						alarm.due = std::max(alarm.due + alarm.period, Clock::now());
+						this->Arm(std::move(alarm));
+					}
+				}
+
+				return true;
+			}
+
+
+			// Only touch the parking mutex if there is actually a worker asleep
+			void Wake()
+			{
+				if (this->sleeping > 0)
+				{
+					this->park.lock();
+					this->park.unlock();
+					this->condition.notify_one();
+				}
+			}
+
+
+			bool PopLane(const Priority priority, Ticket &task)
+			{
+				if (this->lanes[(int)priority].TryPop(task))
+				{
+					// Let a producer that is waiting for space know that some is available
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+
+					if (this->blocked > 0)
+					{
+						this->cs.lock();
+						this->cs.unlock();
+						this->space.notify_all();
+					}
+
+					return true;
+				}
+
+				return false;
+			}
+
+
+			bool PopLocal(Worker &local, Ticket &task)
+			{
+				std::lock_guard<std::mutex> lock(local.cs);
+
+				if (!local.Empty())
+				{
+					local.PopBack(task);
+					return true;
+				}
+
+				return false;
+			}
+
+
+			bool Steal(const std::size_t index, Ticket &task)
+			{
+				for (std::size_t i=1; i<this->workers.size(); i++)
+				{
+					auto &victim = this->workers[(index + i) % this->workers.size()];
+
+					// Do not queue up behind a busy owner, simply try the next victim
+					std::unique_lock<std::mutex> lock(victim.cs, std::try_to_lock);
+
+					if (lock && !victim.Empty())
+					{
+						victim.PopFront(task);
+						this->workers[index].stolen.Increment();
+
+						return true;
+					}
+				}
+
+				return false;
+			}
+
+
+			// Look for work in the order: high priority lane, own deque (newest first), normal lane,
+			// the deques of the other workers (oldest first) and finally the low priority lane. The
+			// local and stolen jobs are all normal priority. Every FAIRNESS searches the order is
+			// reversed so that the lower lanes continue to make progress.
+			bool Next(const std::size_t index, Ticket &task)
+			{
+				if (this->pending == 0)
+				{
+					return false;
+				}
+
+				auto &local = this->workers[index];
+
+				const bool found = ++local.turn % FAIRNESS
+					? this->PopLane(Priority::High, task) || this->PopLocal(local, task) || this->PopLane(Priority::Normal, task)
+						|| this->Steal(index, task) || this->PopLane(Priority::Low, task)
+					: this->PopLane(Priority::Low, task) || this->PopLane(Priority::Normal, task) || this->PopLocal(local, task)
+						|| this->Steal(index, task) || this->PopLane(Priority::High, task);
+
+				if (found)
+				{
+					this->pending--;
+					return true;
+				}
+
+				return false;
+			}
+
+
+			void Entry(const std::size_t index)
+			{
+				owner	= this;
+				self	= index;
+
+				this->attributes.For(index).Apply();
+
+				int idle = 0;
+				Ticket task;
+				auto &worker = this->workers[index];
+
+				while (this->run)
+				{
+					if (this->Expire(worker))
+					{
+						idle = 0;
+					}
+					else if (this->Next(index, task))
+					{
+						if (task.queued != Clock::time_point())
+						{
+							const auto start = Clock::now();
+
+							internal::Invoke(task.job);
+
+							worker.latency.Record(start - task.queued);
+							worker.execution.Record(Clock::now() - start);
+						}
+						else internal::Invoke(task.job);
+
+						worker.executed.Increment();
+
+						task	= {};
+						idle	= 0;
+
+						this->Grow();
+					}
+					else if (++idle < SPIN)
+					{
+						std::this_thread::yield();
+					}
+					else if (this->Park() && this->Retire(index))
+					{
+						return;
+					}
+					else idle = 0;
+				}
+			}
+
+
+			// Park until there is work, a timer is due or the pool is being destroyed. Returns true
+			// if the worker has been idle for the keep-alive period and so may be retired.
+			bool Park()
+			{
+				// The sleeping count is raised before checking for pending work so that
+				// a concurrent Push will either be seen here or will notify this worker.
+				std::unique_lock<std::mutex> lock(this->park);
+
+				const auto expiry	= this->minimum < this->maximum ? Clock::now() + this->keepAlive : Clock::time_point::max();
+				bool keeper			= false;
+				bool expired		= false;
+
+				this->sleeping++;
+
+				while (this->run && this->pending == 0 && !this->Due())
+				{
+					// A single parked worker sleeps until the earliest timer is due whilst the
+					// others wait indefinitely (or until their keep-alive expires).
+					const auto earliest	= Clock::time_point(Clock::duration(this->earliest.load()));
+					auto until			= this->active > this->minimum ? expiry : Clock::time_point::max();
+
+					if ((keeper || !this->timekeeper) && earliest != Clock::time_point::max())
+					{
+						keeper	= this->timekeeper = true;
+						until	= std::min(until, earliest);
+					}
+
+					if (until == expiry && Clock::now() >= expiry)
+					{
+						expired = true;
+						break;
+					}
+
+					if (until == Clock::time_point::max())
+					{
+						this->condition.wait(lock);
+					}
+					else this->condition.wait_until(lock, until);
+				}
+
+				this->sleeping--;
+
+				// Hand over the timekeeping to another parked worker
+				if (keeper)
+				{
+					this->timekeeper = false;
+
+					if (this->sleeping > 0)
+					{
+						this->condition.notify_one();
+					}
+				}
+
+				return expired;
+			}
+
+
+			// The shared lanes of tasks submitted from outside the pool, indexed by priority
+			std::array<Lane, 3> lanes;
+
+			// Producers waiting for space in the shared queue
 			std::mutex cs;
-			std::thread thread;
+			std::condition_variable space;
+			std::atomic<int> blocked = 0;
+
+			// Timers ordered by when they are due, the earliest due time is
+			// also held atomically so that workers can check it without locking
+			mutable std::mutex timing;
+			std::vector<Alarm> timers;
+			std::atomic<Clock::rep> earliest	= Clock::time_point::max().time_since_epoch().count();
+
+			// Parking members
+			std::mutex park;
 			std::condition_variable condition;
-			bool run = true;
+			bool timekeeper						= false;	// Protected by the park mutex
+			std::atomic<int> sleeping			= 0;
+			std::atomic<std::size_t> pending	= 0;
+			std::atomic<bool> run				= true;
+
+			// Instrumentation
+			std::atomic<bool> instrument		= false;
+			std::atomic<uint64_t> rejected		= 0;
+
+			// Elasticity, the backlog is the time at which jobs were first seen to be queueing
+			// up (zero when they are not) and the counts are protected by the resize mutex
+			const std::size_t minimum;
+			const std::size_t maximum;
+			const Clock::duration keepAlive;
+			mutable std::mutex resize;
+			std::atomic<std::size_t> active		= 0;
+			std::atomic<Clock::rep> backlog		= 0;
+			uint64_t grown						= 0;
+			uint64_t retired					= 0;
 
-			// The pool of threads
-			std::array<PersistentThread, N> threads;
+			// The pool of workers, with a slot for the maximum number
+			ThreadAttributes attributes;
+			std::vector<Worker> workers;
+	};
+
+
+	// A simple thread pool implementation. The size of the pool is determined
+	// by the first template argument.
+	template <std::size_t N> class ThreadPool : public Executor
+	{
+		public:
 
-			// The queue of tasks to be executed
-			std::queue<std::shared_ptr<internal::TaskBase>> queue;
+			ThreadPool(const std::size_t capacity = CAPACITY, const ThreadAttributes &attributes = {}) : Executor(N, capacity, attributes) {}
 	};
 }
@@ -1,32 +1,48 @@
 #pragma once
 
 #include <mutex>
-#include <condition_variable>
+#include <deque>
+#include <chrono>
+#include <coroutine>
+#include <emergent/thread/Event.hpp>
 
 
 namespace emergent
 {
 	/// Helper class that is the equivalent to both a ManualResetEvent and
-	/// AutoResetEvent.
+	/// AutoResetEvent. Setting the event and waiting on an event that is already
+	/// set do not make any system calls, see Event.hpp for the dedicated types.
 	class ResetEvent
 	{
 		public:
 
 			/// Sets the state of the event, allowing a single thread to proceed.
+			/// If a coroutine is waiting on the event (and a blocked thread does not
+			/// consume the event first) then it is resumed on the calling thread.
 			void Set()
 			{
-				std::lock_guard<std::mutex> lock(this->cs);
+				this->state.Set(true);
 
-				this->flag = true;
-				this->condition.notify_one();
+				if (this->suspended.load() > 0)
+				{
+					std::unique_lock<std::mutex> lock(this->cs);
+
+					if (!this->waiters.empty() && this->state.TryWait(true))
+					{
+						auto handle = this->waiters.front();
+						this->waiters.pop_front();
+						this->suspended--;
+
+						lock.unlock();
+						handle.resume();
+					}
+				}
 			}
 
 			/// Resets the state of the event, a thread will block at the wait function.
 			void Reset()
 			{
-				std::lock_guard<std::mutex> lock(this->cs);
-
-				this->flag = false;
+				this->state.Reset();
 			}
 
 			/// Wait for the event, if it has already been set then the function will
@@ -38,35 +54,65 @@ namespace emergent
 			/// an AutoResetEvent) otherwise the flag will be left alone (like a ManualResetEvent).
 			bool Wait(int timeout = 0, bool reset = true)
 			{
-				std::unique_lock<std::mutex> lock(this->cs);
+				return timeout > 0
+					? this->Wait(std::chrono::milliseconds(timeout), reset)
+					: this->state.Wait(internal::Clock::time_point::max(), reset);
+			}
 
-				if (!this->flag)
+			/// As above but with a timeout of any resolution.
+			template <typename R, typename P> bool Wait(const std::chrono::duration<R, P> &timeout, bool reset = true)
+			{
+				return this->state.Wait(internal::Deadline(timeout), reset);
+			}
+
+			/// Allows a coroutine to wait on the event without blocking a thread. If the
+			/// event is already set then the coroutine continues immediately, otherwise it
+			/// is suspended until Set is invoked. In both cases the flag is reset (like an
+			/// AutoResetEvent).
+			///
+			///    co_await event;
+			auto operator co_await()
+			{
+				struct Awaiter
 				{
-					if (timeout > 0)
+					ResetEvent &event;
+
+					bool await_ready() const { return false; }
+
+					bool await_suspend(std::coroutine_handle<> handle)
 					{
-						if (this->condition.wait_for(lock, std::chrono::milliseconds(timeout)) == std::cv_status::timeout)
+						std::lock_guard<std::mutex> lock(this->event.cs);
+
+						// Registered before checking the flag so that a concurrent Set will
+						// either be seen here or will see this coroutine
+						this->event.suspended++;
+
+						if (this->event.state.TryWait(true))
 						{
+							this->event.suspended--;
 							return false;
 						}
+
+						this->event.waiters.push_back(handle);
+						return true;
 					}
-					else this->condition.wait(lock);
-				}
 
-				if (reset) this->flag = false;
+					void await_resume() const {}
+				};
 
-				return true;
+				return Awaiter { *this };
 			}
 
 
 		private:
 
 			/// Stores the state of the event
-			bool flag = false;
+			internal::EventState state;
 
-			/// The mutex used to protect this event
+			/// Coroutines that are suspended waiting for the event, the mutex
+			/// is only used when there are coroutines involved
+			std::deque<std::coroutine_handle<>> waiters;
+			std::atomic<int> suspended = 0;
 			std::mutex cs;
-
-			/// Used to notify the Wait call so that it can unblock
-			std::condition_variable condition;
 	};
 }
@@ -0,0 +1,312 @@
+#pragma once
+
+#include <queue>
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <coroutine>
+#include <condition_variable>
+#include <emergent/thread/Attributes.hpp>
+#include <emergent/thread/Task.hpp>
+
+
+namespace emergent
+{
+	namespace internal
+	{
+		// Interface for anything that can be driven by a Scheduler.
+		struct Schedulable
+		{
+			using Clock = std::chrono::steady_clock;
+
+			virtual ~Schedulable() = default;
+
+			// Invoked on a scheduler thread when the item is due. It returns the time at which
+			// it should next be invoked, or time_point::max() to wait for an explicit Wake.
+			virtual Clock::time_point Fire(const Clock::time_point due) = 0;
+		};
+	}
+
+
+	// Drives many schedulable items (such as Agents) using a small, fixed set of threads
+	// instead of a dedicated thread per item. Pending items are kept in a heap ordered by
+	// the time they are next due, and the threads sleep until the earliest of those times or
+	// until woken. An individual item is never invoked concurrently with itself.
+	class Scheduler
+	{
+		public:
+
+			using Clock = std::chrono::steady_clock;
+
+
+			// The attributes are applied to every thread (see ThreadAttributes::For).
+			explicit Scheduler(const std::size_t threads = 1, const ThreadAttributes &attributes = {})
+			{
+				for (std::size_t i=0; i<std::max<std::size_t>(threads, 1); i++)
+				{
+					this->threads.emplace_back(&Scheduler::Entry, this, attributes.For(i));
+				}
+			}
+
+
+			// Any items still registered will no longer be invoked once the scheduler has been
+			// destroyed, but it is expected that they are removed beforehand.
+			~Scheduler()
+			{
+				this->cs.lock();
+					this->run = false;
+				this->cs.unlock();
+				this->condition.notify_all();
+
+				for (auto &t : this->threads)
+				{
+					t.join();
+				}
+			}
+
+
+			// The number of threads used by this scheduler.
+			std::size_t Size() const
+			{
+				return this->threads.size();
+			}
+
+
+			// Register an item that will first be invoked at the given time.
+			void Add(internal::Schedulable *item, const Clock::time_point due = Clock::now())
+			{
+				std::lock_guard<std::mutex> lock(this->cs);
+
+				auto &slot = this->slots[item];
+				slot.due = due;
+
+				this->Arm(item, slot);
+			}
+
+
+			// Request that an item is invoked as soon as possible. If it is currently running
+			// then it will be invoked again immediately afterwards.
+			void Wake(internal::Schedulable *item)
+			{
+				std::lock_guard<std::mutex> lock(this->cs);
+
+				auto it = this->slots.find(item);
+
+				if (it != this->slots.end())
+				{
+					auto &slot = it->second;
+
+					if (slot.running)
+					{
+						slot.woken = true;
+					}
+					else if (slot.due > Clock::now())
+					{
+						slot.due = Clock::now();
+						this->Arm(item, slot);
+					}
+				}
+			}
+
+
+			// Run a one-off job on a scheduler thread at the given time. The job should be short
+			// since it holds up any other items that are due.
+			template <typename F> void At(const Clock::time_point due, F &&job)
+			{
+				std::lock_guard<std::mutex> lock(this->cs);
+
+				this->alarms.push_back({ due, internal::Job(std::forward<F>(job)) });
+				std::push_heap(this->alarms.begin(), this->alarms.end(), std::greater<Alarm>());
+
+				this->condition.notify_one();
+			}
+
+
+			// Awaitable that suspends a coroutine until the given time, after which it is resumed on a
+			// scheduler thread. It can be combined with Executor::Schedule to hop back onto a pool.
+			//
+			//    co_await scheduler.SleepUntil(next);
+			auto SleepUntil(const Clock::time_point due)
+			{
+				struct Awaiter
+				{
+					Scheduler &scheduler;
+					Clock::time_point due;
+
+					bool await_ready() const		{ return this->due <= Clock::now(); }
+					void await_suspend(std::coroutine_handle<> handle)	{ this->scheduler.At(this->due, [handle] { handle.resume(); }); }
+					void await_resume() const		{}
+				};
+
+				return Awaiter { *this, due };
+			}
+
+
+			template <typename R, typename P> auto Sleep(const std::chrono::duration<R, P> &duration)
+			{
+				return this->SleepUntil(Clock::now() + std::chrono::ceil<Clock::duration>(duration));
+			}
+
+
+			// Unregister an item. If it is currently running on another thread then this will
+			// block until it has finished, after which it is guaranteed not to be invoked again.
+			void Remove(internal::Schedulable *item)
+			{
+				std::unique_lock<std::mutex> lock(this->cs);
+
+				auto it = this->slots.find(item);
+
+				if (it != this->slots.end())
+				{
+					// An item that removes itself whilst running must not wait for itself
+					if (it->second.running && it->second.thread != std::this_thread::get_id())
+					{
+						this->finished.wait(lock, [&] {
+							auto current = this->slots.find(item);
+							return current == this->slots.end() || !current->second.running;
+						});
+					}
+
+					this->slots.erase(item);
+				}
+			}
+
+
+		private:
+
+			struct Slot
+			{
+				Clock::time_point due;
+				uint64_t generation	= 0;		// Identifies the current heap entry for this item, older entries are stale
+				bool running		= false;
+				bool woken			= false;
+				std::thread::id thread;				// The scheduler thread currently running the item
+			};
+
+
+			struct Timer
+			{
+				Clock::time_point due;
+				uint64_t generation;
+				internal::Schedulable *item;
+
+				bool operator>(const Timer &other) const { return this->due > other.due; }
+			};
+
+
+			// A one-off job
+			struct Alarm
+			{
+				Clock::time_point due;
+				internal::Job job;
+
+				bool operator>(const Alarm &other) const { return this->due > other.due; }
+			};
+
+
+			// Push a new heap entry for the item which supersedes any existing one
+			void Arm(internal::Schedulable *item, Slot &slot)
+			{
+				if (slot.due != Clock::time_point::max())
+				{
+					this->timers.push({ slot.due, ++slot.generation, item });
+					this->condition.notify_one();
+				}
+				else slot.generation++;
+			}
+
+
+			void Entry(const ThreadAttributes attributes)
+			{
+				attributes.Apply();
+
+				std::unique_lock<std::mutex> lock(this->cs);
+
+				while (this->run)
+				{
+					if (this->timers.empty() && this->alarms.empty())
+					{
+						this->condition.wait(lock);
+						continue;
+					}
+
+					const auto now = Clock::now();
+
+					if (!this->alarms.empty() && this->alarms.front().due <= now)
+					{
+						std::pop_heap(this->alarms.begin(), this->alarms.end(), std::greater<Alarm>());
+
+						auto job = std::move(this->alarms.back().job);
+						this->alarms.pop_back();
+
+						lock.unlock();
+							internal::Invoke(job);
+							job = {};
+						lock.lock();
+
+						continue;
+					}
+
+					if (this->timers.empty() || this->timers.top().due > now)
+					{
+						auto next = this->timers.empty() ? Clock::time_point::max() : this->timers.top().due;
+
+						if (!this->alarms.empty())
+						{
+							next = std::min(next, this->alarms.front().due);
+						}
+
+						this->condition.wait_until(lock, next);
+						continue;
+					}
+
+					const auto timer = this->timers.top();
+
+					this->timers.pop();
+
+					auto it = this->slots.find(timer.item);
+
+					if (it == this->slots.end() || it->second.generation != timer.generation)
+					{
+						// Stale entry for an item that has since been rescheduled or removed
+						continue;
+					}
+
+					it->second.running	= true;
+					it->second.thread	= std::this_thread::get_id();
+
+					lock.unlock();
+						const auto next = timer.item->Fire(timer.due);
+					lock.lock();
+
+					// The slot may have been removed by the item itself while running
+					it = this->slots.find(timer.item);
+
+					if (it != this->slots.end())
+					{
+						auto &slot		= it->second;
+						slot.running	= false;
+						slot.due		= slot.woken ? Clock::now() : next;
+						slot.woken		= false;
+
+						this->Arm(timer.item, slot);
+					}
+
+					this->finished.notify_all();
+				}
+			}
+
+
+			std::mutex cs;
+			std::condition_variable condition;
+			std::condition_variable finished;
+			std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+			std::unordered_map<internal::Schedulable *, Slot> slots;
+			std::vector<Alarm> alarms;
+			std::vector<std::thread> threads;
+			bool run = true;
+	};
+}
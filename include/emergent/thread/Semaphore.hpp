@@ -0,0 +1,111 @@
+#pragma once
+
+#include <emergent/thread/Futex.hpp>
+
+
+namespace emergent
+{
+	// A counting semaphore. Acquiring an available count and releasing when there are no
+	// waiters are single atomic operations, otherwise waiters spin briefly before parking
+	// in the kernel.
+	class Semaphore
+	{
+		public:
+
+			explicit Semaphore(const uint32_t count = 0) : count(count) {}
+
+			Semaphore(const Semaphore &) = delete;
+			Semaphore &operator=(const Semaphore &) = delete;
+
+
+			void Release(const uint32_t count = 1)
+			{
+				this->count.fetch_add(count);
+
+				if (this->waiters.load() > 0)
+				{
+					internal::FutexWake(this->count, (int)std::min<uint32_t>(count, INT32_MAX));
+				}
+			}
+
+
+			bool TryAcquire()
+			{
+				auto current = this->count.load(std::memory_order_relaxed);
+
+				while (current)
+				{
+					if (this->count.compare_exchange_weak(current, current - 1, std::memory_order_acquire, std::memory_order_relaxed))
+					{
+						return true;
+					}
+				}
+
+				return false;
+			}
+
+
+			void Acquire()
+			{
+				this->Acquire(internal::Clock::time_point::max());
+			}
+
+
+			template <typename R, typename P> bool TryAcquireFor(const std::chrono::duration<R, P> &timeout)
+			{
+				return this->Acquire(internal::Deadline(timeout));
+			}
+
+
+			template <typename C, typename D> bool TryAcquireUntil(const std::chrono::time_point<C, D> &deadline)
+			{
+				return this->TryAcquireFor(deadline - C::now());
+			}
+
+
+			// The count at the time of the call, which may be stale by the time it is used.
+			uint32_t Count() const
+			{
+				return this->count.load(std::memory_order_relaxed);
+			}
+
+
+		private:
+
+			bool Acquire(const internal::Clock::time_point deadline)
+			{
+				for (int i=0; i<internal::SPINS; i++)
+				{
+					if (this->TryAcquire())
+					{
+						return true;
+					}
+
+					internal::Pause();
+				}
+
+				// The waiter is registered before the count is checked again so that a concurrent
+				// Release will either be seen here or will see the waiter and issue a wake.
+				this->waiters.fetch_add(1);
+
+				bool result = false;
+
+				while (!(result = this->TryAcquire()))
+				{
+					if (!internal::FutexWait(this->count, 0, deadline))
+					{
+						result = this->TryAcquire();
+						break;
+					}
+				}
+
+				this->waiters.fetch_sub(1);
+
+				return result;
+			}
+
+
+			std::atomic<uint32_t> count;
+			std::atomic<uint32_t> waiters = 0;
+	};
+}
@@ -0,0 +1,336 @@
+#pragma once
+
+#include <bit>
+#include <array>
+#include <future>
+#include <cstddef>
+#include <utility>
+#include <stdexcept>
+#include <stop_token>
+#include <type_traits>
+
+
+namespace emergent
+{
+	// Thrown in place of running a job that was cancelled before it started, so that
+	// any future waiting on the job is released.
+	class Cancelled : public std::runtime_error
+	{
+		public:
+
+			Cancelled() : std::runtime_error("job was cancelled before it started") {}
+	};
+}
+
+
+namespace emergent::internal
+{
+	// A move-only, type-erased void() callable. Callables that are small enough (and can be
+	// moved without throwing) are stored inline so that queueing a job does not touch the heap,
+	// larger callables fall back to a heap allocation.
+	class Job
+	{
+		public:
+
+			// Size of the inline storage, big enough for a promise plus a few captures.
+			static constexpr std::size_t CAPACITY = 64;
+
+
+			Job() = default;
+			Job(const Job &) = delete;
+			Job &operator=(const Job &) = delete;
+
+
+			template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Job>>> Job(F &&callable)
+			{
+				using C = std::decay_t<F>;
+
+				if constexpr (Inline<C>)
+				{
+					new (this->storage) C(std::forward<F>(callable));
+					this->vtable = &Local<C>::TABLE;
+				}
+				else
+				{
+					*reinterpret_cast<C **>(this->storage) = new C(std::forward<F>(callable));
+					this->vtable = &Remote<C>::TABLE;
+				}
+			}
+
+
+			Job(Job &&other) noexcept
+			{
+				*this = std::move(other);
+			}
+
+
+			Job &operator=(Job &&other) noexcept
+			{
+				if (this != &other)
+				{
+					this->Reset();
+
+					if (other.vtable)
+					{
+						other.vtable->move(this->storage, other.storage);
+						this->vtable	= other.vtable;
+						other.vtable	= nullptr;
+					}
+				}
+
+				return *this;
+			}
+
+
+			~Job()
+			{
+				this->Reset();
+			}
+
+
+			explicit operator bool() const
+			{
+				return this->vtable;
+			}
+
+
+			void operator()()
+			{
+				this->vtable->invoke(this->storage);
+			}
+
+
+		private:
+
+			struct VTable
+			{
+				void (*invoke)(void *);
+				void (*move)(void *dst, void *src);
+				void (*destroy)(void *);
+			};
+
+
+			template <typename C> static constexpr bool Inline = sizeof(C) <= CAPACITY
+				&& alignof(C) <= alignof(std::max_align_t)
+				&& std::is_nothrow_move_constructible_v<C>;
+
+
+			// The callable lives in the inline storage
+			template <typename C> struct Local
+			{
+				static constexpr VTable TABLE = {
+					[](void *s) { (*static_cast<C *>(s))(); },
+					[](void *d, void *s) { new (d) C(std::move(*static_cast<C *>(s))); static_cast<C *>(s)->~C(); },
+					[](void *s) { static_cast<C *>(s)->~C(); }
+				};
+			};
+
+
+			// The inline storage holds a pointer to the callable on the heap
+			template <typename C> struct Remote
+			{
+				static constexpr VTable TABLE = {
+					[](void *s) { (**static_cast<C **>(s))(); },
+					[](void *d, void *s) { *static_cast<C **>(d) = *static_cast<C **>(s); },
+					[](void *s) { delete *static_cast<C **>(s); }
+				};
+			};
+
+
+			void Reset()
+			{
+				if (this->vtable)
+				{
+					this->vtable->destroy(this->storage);
+					this->vtable = nullptr;
+				}
+			}
+
+
+			const VTable *vtable = nullptr;
+			alignas(std::max_align_t) std::byte storage[CAPACITY];
+	};
+
+
+	// Per-thread free lists of small memory blocks grouped into power-of-two size bins.
+	// Used for the shared state of promises so that, once warmed up, creating a promise
+	// and future pair reuses memory instead of going back to the system allocator. Blocks
+	// released on a different thread to the one that allocated them simply migrate to the
+	// free lists of the releasing thread.
+	class Bins
+	{
+		public:
+
+			static void *Allocate(const std::size_t size, const std::size_t alignment)
+			{
+				const int bin = Bin(size);
+
+				// Blocks that fit a bin always have the full size of the bin, even once the free lists
+				// of this thread are closed, since they may be released into a bin on another thread.
+				if (bin < BINS && alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+				{
+					if (!closed)
+					{
+						auto &local = Local();
+
+						if (auto *block = local.heads[bin])
+						{
+							local.heads[bin] = block->next;
+							local.counts[bin]--;
+
+							return block;
+						}
+					}
+
+					return ::operator new(MINIMUM << bin);
+				}
+
+				return alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__
+					? ::operator new(size, std::align_val_t(alignment))
+					: ::operator new(size);
+			}
+
+
+			static void Release(void *pointer, const std::size_t size, const std::size_t alignment)
+			{
+				const int bin = Bin(size);
+
+				if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+				{
+					::operator delete(pointer, std::align_val_t(alignment));
+				}
+				else if (bin < BINS && !closed && Local().counts[bin] < LIMIT)
+				{
+					auto &local			= Local();
+					auto *block			= static_cast<Block *>(pointer);
+					block->next			= local.heads[bin];
+					local.heads[bin]	= block;
+					local.counts[bin]++;
+				}
+				else ::operator delete(pointer);
+			}
+
+
+		private:
+
+			static constexpr int BINS				= 6;	// Bins of 16 to 512 bytes
+			static constexpr std::size_t MINIMUM	= 16;	// Size of the smallest bin
+			static constexpr std::size_t LIMIT		= 256;	// Maximum number of blocks retained per bin
+
+			struct Block { Block *next; };
+
+			std::array<Block *, BINS> heads		= {};
+			std::array<std::size_t, BINS> counts	= {};
+
+			// Set once the free lists for this thread have been destroyed so that any late
+			// releases (from other thread_local destructors) go straight to the heap.
+			static inline thread_local bool closed = false;
+
+
+			~Bins()
+			{
+				closed = true;
+
+				for (auto *head : this->heads)
+				{
+					while (head)
+					{
+						auto *next = head->next;
+						::operator delete(head);
+						head = next;
+					}
+				}
+			}
+
+
+			static Bins &Local()
+			{
+				static thread_local Bins bins;
+				return bins;
+			}
+
+
+			static constexpr int Bin(const std::size_t size)
+			{
+				return size <= MINIMUM ? 0 : std::bit_width(size - 1) - 4;
+			}
+	};
+
+
+	// An allocator that recycles memory through the per-thread Bins.
+	template <typename T> struct Recycler
+	{
+		using value_type = T;
+
+		Recycler() = default;
+		template <typename U> Recycler(const Recycler<U> &) noexcept {}
+
+		T *allocate(const std::size_t n)				{ return static_cast<T *>(Bins::Allocate(n * sizeof(T), alignof(T))); }
+		void deallocate(T *pointer, const std::size_t n)	{ Bins::Release(pointer, n * sizeof(T), alignof(T)); }
+
+		template <typename U> bool operator==(const Recycler<U> &) const { return true; }
+		template <typename U> bool operator!=(const Recycler<U> &) const { return false; }
+	};
+
+
+	// Wrap a callable in a job that will fulfil a promise with the result (or any exception
+	// thrown) and return the job along with the corresponding future. The promise state is
+	// allocated through the Recycler.
+	template <typename F> auto Package(F &&callable)
+	{
+		using R = std::invoke_result_t<std::decay_t<F> &>;
+
+		std::promise<R> promise(std::allocator_arg, Recycler<R>());
+		auto future = promise.get_future();
+
+		Job job([promise = std::move(promise), callable = std::forward<F>(callable)]() mutable {
+			try
+			{
+				if constexpr (std::is_void_v<R>)
+				{
+					callable();
+					promise.set_value();
+				}
+				else promise.set_value(callable());
+			}
+			catch (...)
+			{
+				promise.set_exception(std::current_exception());
+			}
+		});
+
+		return std::make_pair(std::move(job), std::move(future));
+	}
+
+
+	// Wrap a callable so that it is skipped if a stop has been requested by the time it is
+	// due to run. Callables that accept a stop_token are passed the token so that they can
+	// poll it and finish early.
+	template <typename F> auto Cancellable(std::stop_token token, F &&callable)
+	{
+		return [token = std::move(token), callable = std::forward<F>(callable)]() mutable {
+			if (token.stop_requested())
+			{
+				throw Cancelled();
+			}
+
+			if constexpr (std::is_invocable_v<std::decay_t<F> &, std::stop_token>)
+			{
+				return callable(token);
+			}
+			else return callable();
+		};
+	}
+
+
+	// Invoke a job that has no way of reporting failure, so exceptions are discarded
+	// rather than allowed to terminate the worker thread.
+	inline void Invoke(Job &job)
+	{
+		try
+		{
+			job();
+		}
+		catch (...) {}
+	}
+}
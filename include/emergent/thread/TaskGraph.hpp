@@ -0,0 +1,177 @@
+#pragma once
+
+#include <memory>
+#include <atomic>
+#include <vector>
+#include <stdexcept>
+#include <initializer_list>
+#include <emergent/thread/Future.hpp>
+
+
+namespace emergent
+{
+	// A reusable directed acyclic graph of jobs. Each time the graph is run the nodes are
+	// queued on a pool as soon as all of their dependencies have completed, so no thread
+	// is ever blocked waiting for part of the graph.
+	//
+	//    TaskGraph graph;
+	//    auto decode	= graph.Add([&] { ... });
+	//    auto a		= graph.Add([&] { ... }, { decode });
+	//    auto b		= graph.Add([&] { ... }, { decode });
+	//    auto merge	= graph.Add([&] { ... }, { a, b });
+	//
+	//    graph.Run(pool).Then([&] { Publish(); });
+	//
+	// If a node throws then the remaining nodes are skipped and the future returned by Run
+	// fails with the first exception. The graph must not be modified or destroyed while it is
+	// running, and a graph may only be run again once the previous run has completed.
+	class TaskGraph
+	{
+		public:
+
+			using Node = std::size_t;
+
+
+			// Add a job that will only run once all of the given dependencies have completed.
+			// Since dependencies must already exist in the graph it cannot contain a cycle.
+			template <typename F> Node Add(F &&job, std::initializer_list<Node> dependencies = {})
+			{
+				const Node node = this->nodes.size();
+
+				for (auto d : dependencies)
+				{
+					if (d >= node)
+					{
+						throw std::out_of_range("TaskGraph dependency does not exist");
+					}
+				}
+
+				this->nodes.push_back({ internal::Job(std::forward<F>(job)), {}, dependencies.size() });
+
+				for (auto d : dependencies)
+				{
+					this->nodes[d].successors.push_back(node);
+				}
+
+				return node;
+			}
+
+
+			std::size_t Size() const
+			{
+				return this->nodes.size();
+			}
+
+
+			// Start running the graph on the pool and return a future which completes once every
+			// node has finished.
+			Future<void> Run(Executor &pool)
+			{
+				auto run		= std::make_shared<Execution>(*this, pool);
+				auto result		= run->promise.GetFuture();
+
+				if (this->nodes.empty())
+				{
+					run->promise.Set();
+				}
+
+				for (Node i=0; i<this->nodes.size(); i++)
+				{
+					if (!this->nodes[i].dependencies)
+					{
+						Schedule(run, i);
+					}
+				}
+
+				return result;
+			}
+
+
+		private:
+
+			struct Entry
+			{
+				internal::Job job;
+				std::vector<Node> successors;
+				std::size_t dependencies;
+			};
+
+
+			// The state of a single run of the graph
+			struct Execution
+			{
+				TaskGraph &graph;
+				Executor &pool;
+				std::unique_ptr<std::atomic<std::size_t>[]> remaining;	// Outstanding dependencies per node
+				std::atomic<std::size_t> outstanding;					// Nodes that have not yet finished
+				std::atomic<bool> failed = false;
+				std::exception_ptr error;
+				Promise<void> promise;
+
+				Execution(TaskGraph &graph, Executor &pool)
+					: graph(graph), pool(pool), remaining(new std::atomic<std::size_t>[graph.nodes.size()]), outstanding(graph.nodes.size())
+				{
+					for (std::size_t i=0; i<graph.nodes.size(); i++)
+					{
+						this->remaining[i] = graph.nodes[i].dependencies;
+					}
+				}
+
+				void Fail(std::exception_ptr error)
+				{
+					if (!this->failed.exchange(true))
+					{
+						this->error = error;
+					}
+				}
+			};
+
+
+			static void Schedule(const std::shared_ptr<Execution> &run, const Node node)
+			{
+				const bool queued = run->pool.Post([run, node] {
+					if (!run->failed)
+					{
+						try
+						{
+							run->graph.nodes[node].job();
+						}
+						catch (...)
+						{
+							run->Fail(std::current_exception());
+						}
+					}
+
+					Finish(run, node);
+				});
+
+				if (!queued)
+				{
+					run->Fail(std::make_exception_ptr(std::runtime_error("TaskGraph node was rejected by the pool")));
+					Finish(run, node);
+				}
+			}
+
+
+			// Release the successors of a node that has finished and complete the run after the last node
+			static void Finish(const std::shared_ptr<Execution> &run, const Node node)
+			{
+				for (auto s : run->graph.nodes[node].successors)
+				{
+					if (--run->remaining[s] == 0)
+					{
+						Schedule(run, s);
+					}
+				}
+
+				if (--run->outstanding == 0)
+				{
+					if (run->failed)	run->promise.Fail(run->error);
+					else				run->promise.Set();
+				}
+			}
+
+
+			std::vector<Entry> nodes;
+	};
+}
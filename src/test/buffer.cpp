@@ -1,5 +1,6 @@
 #include "doctest.h"
 #include <emergent/image/Buffer.hpp>
+#include <numeric>
 
 using emg::image::Buffer;
 using emg::byte;
@@ -47,6 +48,148 @@ TEST_SUITE("buffer")
 			CHECK(buffer.empty());
 			CHECK(buffer.data() == ptr);
 		}
+
+		SUBCASE("growing preserves the contents")
+		{
+			std::iota(buffer.begin(), buffer.end(), 1);
+			buffer.resize(1000);
+
+			CHECK(buffer.size() == 1000);
+			CHECK(buffer[0] == 1);
+			CHECK(buffer[7] == 8);
+		}
+
+		SUBCASE("reserving allocates without changing the size")
+		{
+			buffer[3] = 42;
+			buffer.reserve(100);
+
+			const auto ptr = buffer.data();
+
+			CHECK(buffer.size() == 8);
+			CHECK(buffer.capacity == 100);
+			CHECK(buffer[3] == 42);
+
+			buffer.resize(100);
+			CHECK(buffer.data() == ptr);
+		}
+
+		SUBCASE("shrinking reduces the capacity to the size")
+		{
+			buffer[3] = 42;
+			buffer.reserve(100);
+			buffer.shrink_to_fit();
+
+			CHECK(buffer.capacity == 8);
+			CHECK(buffer[3] == 42);
+		}
+	}
+
+
+	TEST_CASE_TEMPLATE("allocation is aligned", T, byte, int, double)
+	{
+		Buffer<T> buffer(3);
+		CHECK((uintptr_t)buffer.data() % emg::image::Allocator::ALIGNMENT == 0);
+
+		emg::image::AlignedAllocator huge(true);
+		Buffer<T> large(emg::image::AlignedAllocator::HUGE_PAGE, huge);
+		CHECK((uintptr_t)large.data() % emg::image::AlignedAllocator::HUGE_PAGE == 0);
+	}
+
+
+	TEST_CASE("custom allocators")
+	{
+		struct Counter : emg::image::Allocator
+		{
+			int allocations	= 0;
+			int releases	= 0;
+
+			void *Allocate(const size_t bytes) override
+			{
+				allocations++;
+				return emg::image::AlignedAllocator::Shared().Allocate(bytes);
+			}
+
+			void Release(void *data, const size_t bytes) override
+			{
+				releases++;
+				emg::image::AlignedAllocator::Shared().Release(data, bytes);
+			}
+		};
+
+		Counter counter;
+
+		SUBCASE("memory is released to the allocator it came from")
+		{
+			{
+				Buffer<int> buffer(16, counter);
+				Buffer<int> copy = buffer;
+
+				CHECK(copy.allocator == &counter);
+			}
+
+			CHECK(counter.allocations == 2);
+			CHECK(counter.releases == 2);
+		}
+
+		SUBCASE("the default allocator can be replaced")
+		{
+			emg::image::Allocator::Default(counter);
+			Buffer<byte> buffer(16);
+			emg::image::Allocator::Default(emg::image::AlignedAllocator::Shared());
+
+			CHECK(counter.allocations == 1);
+			CHECK(buffer.allocator == &counter);
+		}
+	}
+
+
+	TEST_CASE("recycling memory with a buffer pool")
+	{
+		using emg::image::BufferPool;
+
+		BufferPool pool(1 << 20);
+
+		SUBCASE("sizes are rounded up to classes")
+		{
+			CHECK(BufferPool::Round(1) == 64);
+			CHECK(BufferPool::Round(100) == 128);
+			CHECK(BufferPool::Round(1000) == 1024);
+			CHECK(BufferPool::Round(1100) == 1280);
+			CHECK(BufferPool::Round(20'000'000) == 20'971'520);
+			CHECK(BufferPool::Round(BufferPool::Round(20'000'000)) == 20'971'520);
+		}
+
+		SUBCASE("released memory is reused by buffers of a similar size")
+		{
+			byte *ptr = nullptr;
+
+			{
+				Buffer<byte> frame(1000, pool);
+				ptr = frame.data();
+			}
+
+			CHECK(pool.Cached() == 1024);
+
+			Buffer<byte> next(1020, pool);
+
+			CHECK(next.data() == ptr);
+			CHECK(pool.Recycled() == 1);
+			CHECK(pool.Cached() == 0);
+		}
+
+		SUBCASE("memory beyond the limit is not held")
+		{
+			{
+				Buffer<byte> a(600'000, pool);
+				Buffer<byte> b(600'000, pool);
+			}
+
+			CHECK(pool.Cached() == BufferPool::Round(600'000));
+
+			pool.Trim();
+			CHECK(pool.Cached() == 0);
+		}
 	}
 
 
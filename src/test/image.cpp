@@ -1,5 +1,8 @@
 #include "doctest.h"
 #include <emergent/image/Image.hpp>
+#include <emergent/image/Qoi.hpp>
+#include <filesystem>
+#include <numeric>
 
 using emg::Image;
 using emg::ImageBase;
@@ -177,6 +180,17 @@ TEST_SUITE("image")
 			CHECK(src.Size() == 0);
 		}
 
+		SUBCASE("dimensions that cannot be addressed are rejected rather than wrapped")
+		{
+			CHECK_THROWS(src.Resize(INT_MAX, INT_MAX, 255));
+			CHECK(src.Width() == 10);
+			CHECK(src.Height() == 10);
+
+			ImageBase<double> wide;
+			CHECK_THROWS(wide.Resize(INT_MAX, INT_MAX));
+			CHECK(wide.Size() == 0);
+		}
+
 
 	}
 
@@ -276,6 +290,264 @@ TEST_SUITE("image")
 
 
 
+	// Compare the vectorised point operations for every instruction set supported by this CPU
+	// against the scalar equivalents. The size is deliberately not a multiple of any vector width.
+	template <typename T> void CheckPointOperations()
+	{
+		namespace simd = emg::image::simd;
+
+		std::vector<T> data(1000), modifier(1000);
+		uint32_t seed = 12345;
+
+		for (size_t i=0; i<data.size(); i++)
+		{
+			seed		= seed * 1664525 + 1013904223;
+			data[i]		= (T)((seed >> 16) % (std::is_same_v<T, byte> ? 256 : 60000));
+			modifier[i]	= (T)((seed >> 8) % 256);
+		}
+
+		data[7] = data[999] = 0;
+
+		for (auto isa : { simd::Isa::Sse2, simd::Isa::Avx2, simd::Isa::Avx512 })
+		{
+			if (isa > simd::Detect()) continue;
+
+			CAPTURE((int)isa);
+
+			CHECK(simd::Max(data.data(), data.size(), isa) == *std::max_element(data.begin(), data.end()));
+			CHECK(simd::Min(data.data(), data.size(), isa) == *std::min_element(data.begin(), data.end()));
+			CHECK(simd::Max(data.data(), 3, isa) == *std::max_element(data.begin(), data.begin() + 3));
+			CHECK(simd::Count<T>(data.data(), data.size(), 0, isa) == (size_t)std::count(data.begin(), data.end(), 0));
+			CHECK(simd::Uniform<T>(data.data(), data.size(), data[0], isa) == false);
+			CHECK(simd::Uniform<T>(std::vector<T>(999, 5).data(), 999, 5, isa));
+
+			auto result = data, expected = data;
+
+			simd::Threshold<T>(result.data(), result.size(), 100, 255, 0, isa);
+			for (auto &e : expected) e = e < 100 ? 0 : 255;
+			CHECK(result == expected);
+
+			result = expected = data;
+			simd::Clamp<T>(result.data(), result.size(), 50, 200, isa);
+			for (auto &e : expected) e = std::clamp<T>(e, 50, 200);
+			CHECK(result == expected);
+
+			if constexpr (simd::Integral<T>)
+			{
+				for (int value : { 100, -100, 100000, -100000 })
+				{
+					result = expected = data;
+					simd::Shift(result.data(), result.size(), value, isa);
+					for (auto &e : expected) e = emg::Maths::clamp<T>(e + value);
+					CHECK(result == expected);
+				}
+
+				result = expected = data;
+				simd::Invert(result.data(), result.size(), isa);
+				for (auto &e : expected) e = ~e;
+				CHECK(result == expected);
+
+				result = expected = data;
+				simd::Or(result.data(), modifier.data(), result.size(), isa);
+				for (size_t i=0; i<expected.size(); i++) expected[i] |= modifier[i];
+				CHECK(result == expected);
+
+				result = expected = data;
+				simd::And(result.data(), modifier.data(), result.size(), isa);
+				for (size_t i=0; i<expected.size(); i++) expected[i] &= modifier[i];
+				CHECK(result == expected);
+			}
+		}
+	}
+
+
+	// Every instruction set must match the scalar conversion of one pixel at a time. The source
+	// is deliberately misaligned.
+	template <typename T, typename U> void CheckConversion(const emg::image::Conversion &conversion)
+	{
+		namespace image = emg::image;
+
+		const size_t size = 3 * 257;
+		std::vector<U> data(size + 1);
+		uint32_t seed = 12345;
+
+		for (auto &s : data)
+		{
+			seed	= seed * 1664525 + 1013904223;
+			s		= std::is_floating_point_v<U> ? (U)((seed >> 8) / 16777216.0) : (U)(seed >> 8);
+		}
+
+		const U *src		= data.data() + 1;
+		const auto mapping	= image::Map<T>(conversion, src, size);
+
+		for (auto [from, to] : std::initializer_list<std::pair<byte, byte>> {{ 1, 1 }, { 3, 3 }, { 3, 1 }, { 1, 3 }})
+		{
+			const size_t pixels = size / from;
+			std::vector<T> expected(pixels * to), result(pixels * to);
+
+			for (size_t i=0; i<pixels; i++)
+			{
+				image::Convert(expected.data() + i * to, src + i * from, 1, from, to, mapping, conversion.luma, image::simd::Isa::Sse2);
+			}
+
+			for (auto isa : { image::simd::Isa::Sse2, image::simd::Isa::Avx2, image::simd::Isa::Avx512 })
+			{
+				if (isa > image::simd::Detect()) continue;
+
+				CAPTURE((int)isa);
+				CAPTURE((int)from);
+				CAPTURE((int)to);
+
+				image::Convert(result.data(), src, pixels, from, to, mapping, conversion.luma, isa);
+
+				size_t differences = 0;
+
+				for (size_t i=0; i<result.size(); i++)
+				{
+					differences += std::abs((double)result[i] - (double)expected[i]) > (std::is_integral_v<T> ? 0 : 1e-5);
+				}
+
+				CHECK(differences == 0);
+			}
+		}
+	}
+
+
+	TEST_CASE("converting between image types")
+	{
+		using emg::image::Scaling;
+		namespace Luma = emg::image::Luma;
+
+		SUBCASE("the kernels match the scalar conversion")
+		{
+			CheckConversion<byte, uint16_t>(Scaling::Automatic);
+			CheckConversion<byte, uint16_t>(Scaling::Shift);
+			CheckConversion<byte, uint16_t>({ 0, 4095, Luma::Rec601 });
+			CheckConversion<uint16_t, byte>(Scaling::Full);
+			CheckConversion<float, byte>(Scaling::Full);
+			CheckConversion<byte, float>({ Scaling::Full, Luma::Rec709 });
+			CheckConversion<byte, byte>(Luma::Rec601);
+			CheckConversion<int, uint16_t>(Scaling::Full);
+		}
+
+		SUBCASE("integer types are shifted or scaled")
+		{
+			ImageBase<uint16_t> src(1, 40, 2);
+			src = 0x1234;
+
+			ImageBase<byte> dst;
+			CHECK(dst.From(src, 1, Scaling::Shift).IsBlank(0x12));
+			CHECK(dst.From(src, 1, Scaling::Full).IsBlank(0x12));
+			CHECK(dst.From(src, 1, { 0, 18640 }).IsBlank(64));
+			CHECK(dst.From(src, 1, { 0, 0x1000 }).IsBlank(255));
+			CHECK(dst.From(src, 1, Scaling::None).IsBlank(255));
+
+			ImageBase<uint16_t> back;
+			CHECK(back.From(dst, 1, Scaling::Shift).IsBlank(0xff00));
+			CHECK(back.From(dst, 1, Scaling::Full).IsBlank(0xffff));
+		}
+
+		SUBCASE("floating point is treated as the unit range")
+		{
+			ImageBase<byte> src(1, 40, 2);
+			src = 255;
+
+			ImageBase<float> dst;
+			CHECK(dst.From(src, 1, Scaling::Full).IsBlank(1.0f));
+
+			dst = 0.5f;
+			CHECK(src.From(dst, 1, Scaling::Full).IsBlank(128));
+
+			dst = -1.0f;
+			CHECK(src.From(dst, 1, Scaling::Full).IsBlank(0));
+		}
+
+		SUBCASE("automatic scaling only rescales when the range does not fit")
+		{
+			ImageBase<uint16_t> src(1, 40, 2);
+
+			for (size_t i=0; i<src.Size(); i++) src[i] = 1000 + i;
+
+			ImageBase<byte> dst;
+			dst.From(src, 1);
+			CHECK(dst[0] == 0);
+			CHECK(dst[79] == 79);
+
+			for (size_t i=0; i<src.Size(); i++) src[i] = i * 500;
+
+			dst.From(src, 1);
+			CHECK(dst[0] == 0);
+			CHECK(dst[79] == 255);
+			CHECK(dst[40] == 129);
+		}
+
+		SUBCASE("copying an image of the same type preserves every value")
+		{
+			ImageBase<int> src(1, 2, 1);
+			src[0] = -2000000000;
+			src[1] = 2000000000;
+
+			ImageBase<int> dst = src;
+			CHECK(dst[0] == -2000000000);
+			CHECK(dst[1] == 2000000000);
+
+			ImageBase<int> rgb;
+			rgb.From(src, 3);
+			CHECK(rgb.Depth() == 3);
+			CHECK(rgb[0] == -2000000000);
+			CHECK(rgb[5] == 2000000000);
+		}
+
+		SUBCASE("RGB and greyscale")
+		{
+			ImageBase<byte> src(3, 40, 2);
+
+			for (size_t i=0; i<src.Size(); i++)
+			{
+				src[i * 3]		= 10;
+				src[i * 3 + 1]	= 20;
+				src[i * 3 + 2]	= 32;
+			}
+
+			ImageBase<byte> grey;
+			CHECK(grey.From(src, 1).IsBlank(20));
+			CHECK(grey.From(src, 1, Luma::Rec601).IsBlank(18));
+
+			src = 255;
+			CHECK(grey.From(src, 1, Luma::Rec709).IsBlank(255));
+
+			ImageBase<float> rgb;
+			rgb.From(grey, 3, Scaling::Full);
+			CHECK(rgb.Depth() == 3);
+			CHECK(rgb.IsBlank(1.0f));
+		}
+	}
+
+
+	TEST_CASE("vectorised point operations")
+	{
+		SUBCASE("byte")		{ CheckPointOperations<byte>(); }
+		SUBCASE("uint16_t")	{ CheckPointOperations<uint16_t>(); }
+		SUBCASE("float")	{ CheckPointOperations<float>(); }
+
+		SUBCASE("image operations use the kernels")
+		{
+			ImageBase<byte> img(3, 33, 17);
+			img = 10;
+
+			CHECK(img.IsBlank(10));
+			CHECK(img.ZeroCount() == 0);
+
+			img.Shift(250);
+			CHECK(img.Max() == 255);
+
+			img.Shift(-300);
+			CHECK(img.Min() == 0);
+			CHECK(img.ZeroCount() == 33 * 17 * 3);
+		}
+	}
+
+
 	TEST_CASE("inspection")
 	{
 		// inspect a region of the image using the provided operation
@@ -301,6 +573,1044 @@ TEST_SUITE("image")
 	// 			template <byte N> std::array<T, N> InterpolateAll(double x, double y) const
 
 
+	TEST_CASE("cancelling long operations")
+	{
+		ImageBase<uint16_t> src(3, 64, 64);
+		src = 1000;
+
+		std::stop_source source;
+		std::vector<byte> buffer;
+
+		SUBCASE("operations complete without a stop request")
+		{
+			ImageBase<byte> dst(1, 64, 64);
+			dst = 7;
+			dst.From(src, 1, source.get_token());
+
+			// A uniform source is shifted down to zero
+			CHECK(dst.Value(63, 63) == 0);
+			CHECK(emg::image::Qoi::Encode(src, buffer, source.get_token()));
+		}
+
+		SUBCASE("a copy is abandoned once a stop is requested")
+		{
+			ImageBase<byte> dst(3, 64, 64);
+			dst = 7;
+
+			source.request_stop();
+			dst.From(src, 3, source.get_token());
+
+			CHECK(dst.Value(0, 0) == 7);
+		}
+
+		SUBCASE("an inspection stops part way through")
+		{
+			int pixels = 0;
+
+			// Stop after the first row
+			src.Inspect(0, 0, 64, 64, [&](const uint16_t *) {
+				if (++pixels == 64) source.request_stop();
+			}, source.get_token());
+
+			CHECK(pixels == 64);
+		}
+
+		SUBCASE("encoding fails once a stop is requested")
+		{
+			source.request_stop();
+
+			CHECK_FALSE(emg::image::Qoi::Encode(src, buffer, source.get_token()));
+		}
+	}
+
+
+	TEST_CASE("parallel execution")
+	{
+		// Small bands so that even these images are split between the threads
+		emg::Executor pool(3);
+		const emg::image::Policy policy = { true, &pool, 0, 1024 };
+
+		ImageBase<uint16_t> src(3, 301, 97);
+		ImageBase<uint16_t> a, b;
+
+		for (size_t i=0; i<src.Internal().size(); i++)
+		{
+			src.Internal()[i] = (i * 7919) % 4099;
+		}
+
+		a = src;
+		b = src;
+
+		SUBCASE("point operations match the serial results")
+		{
+			a.Threshold(2000, 4000, 10);
+			b.Threshold(policy, 2000, 4000, 10);
+			CHECK(a.Internal() == b.Internal());
+
+			a.Shift(-500);
+			b.Shift(policy, -500);
+			CHECK(a.Internal() == b.Internal());
+
+			a.Clamp(100, 3000);
+			b.Clamp(policy, 100, 3000);
+			CHECK(a.Internal() == b.Internal());
+
+			a.Invert();
+			b.Invert(policy);
+			CHECK(a.Internal() == b.Internal());
+
+			a.OR(src);
+			b.OR(policy, src);
+			CHECK(a.Internal() == b.Internal());
+
+			a.AND(src);
+			b.AND(policy, src);
+			CHECK(a.Internal() == b.Internal());
+		}
+
+		SUBCASE("statistics match the serial results")
+		{
+			src.Internal()[src.Internal().size() - 5] = 0;
+			src.Internal()[12345] = 9999;
+
+			CHECK(src.Max(policy) == src.Max());
+			CHECK(src.Max(policy) == 9999);
+			CHECK(src.Min(policy) == src.Min());
+			CHECK(src.ZeroCount(policy) == src.ZeroCount());
+			CHECK(src.Count(policy, [](auto v) { return v > 1000; }) == src.Count([](auto v) { return v > 1000; }));
+			CHECK_FALSE(src.IsBlank(policy));
+
+			const auto serial	= src.Stats();
+			const auto parallel	= src.Stats(policy);
+
+			CHECK(parallel.samples == serial.samples);
+			CHECK(parallel.sum == serial.sum);
+			CHECK(parallel.min == serial.min);
+			CHECK(parallel.max == serial.max);
+			CHECK(parallel.variance == doctest::Approx(serial.variance));
+
+			a = 42;
+			CHECK(a.IsBlank(policy, 42));
+		}
+
+		SUBCASE("conversions match the serial results")
+		{
+			ImageBase<byte> grey, expected;
+
+			expected.From(src, 1);
+			grey.From(policy, src, 1);
+			CHECK(grey.Internal() == expected.Internal());
+
+			b.From(policy, src, 3);
+			CHECK(b.Internal() == src.Internal());
+		}
+
+		SUBCASE("inserting matches the serial result")
+		{
+			ImageBase<uint16_t> patch(1, 150, 80);
+			patch = 77;
+
+			a.Insert(patch, 200, 30, true);
+			b.Insert(policy, patch, 200, 30, true);
+			CHECK(a.Internal() == b.Internal());
+
+			a.Insert(src, 5, 3);
+			b.Insert(policy, src, 5, 3);
+			CHECK(a.Internal() == b.Internal());
+		}
+
+		SUBCASE("small images are processed serially")
+		{
+			ImageBase<byte> small(1, 8, 8);
+			small = 3;
+			small.Threshold(emg::image::par.On(pool), 2);
+
+			CHECK(small.IsBlank(emg::image::par, 255));
+		}
+	}
+
+
+	TEST_CASE("viewing external memory")
+	{
+		using emg::ImageView;
+
+		// An RGB frame of 20x10 where each row is padded to 64 bytes, the padding is filled with a marker
+		constexpr size_t PITCH = 64;
+		std::vector<byte> memory(PITCH * 10, 99);
+		ImageView<byte> view(memory.data(), 20, 10, 3, PITCH);
+
+		for (int y=0; y<10; y++)
+		{
+			for (auto p : view.Row(y))
+			{
+				p[0] = y; p[1] = y + 1; p[2] = y + 2;
+			}
+		}
+
+		auto padding = [&] {
+			for (size_t y=0; y<10; y++)
+			{
+				if (!std::all_of(memory.begin() + y * PITCH + 60, memory.begin() + (y + 1) * PITCH, [](byte b) { return b == 99; }))
+				{
+					return false;
+				}
+			}
+			return true;
+		};
+
+		SUBCASE("the view describes the memory")
+		{
+			CHECK(view.Width() == 20);
+			CHECK(view.Height() == 10);
+			CHECK(view.Depth() == 3);
+			CHECK(view.Pitch() == PITCH);
+			CHECK_FALSE(view.Contiguous());
+			CHECK_THROWS(ImageView<byte>(memory.data(), 30, 10, 3, PITCH));
+		}
+
+		SUBCASE("statistics ignore the padding")
+		{
+			CHECK(view.Max() == 11);
+			CHECK(view.Min() == 0);
+			CHECK(view.ZeroCount() == 20);
+			CHECK(view.Stats().samples == 600);
+			CHECK(view.Stats().sum == 20 * (3 * 45 + 30));
+			CHECK(view.View(0, 3, 20, 1).IsBlank(4) == false);
+			CHECK(view.View(0, 0, 5, 1).Count([](byte b) { return b == 0; }) == 5);
+		}
+
+		SUBCASE("point operations leave the padding untouched")
+		{
+			view.Threshold(5, 200, 10);
+			CHECK(view.Max() == 200);
+			CHECK(view.Min() == 10);
+			CHECK(padding());
+
+			view.Invert(emg::image::Policy { true, nullptr, 0, 128 });
+			CHECK(view.Max() == 245);
+			CHECK(padding());
+		}
+
+		SUBCASE("operations can combine views and images")
+		{
+			ImageBase<byte> mask(3, 20, 10);
+			mask = 0xf0;
+
+			CHECK(view.OR(mask));
+			CHECK(view.Min() == 0xf0);
+			CHECK(padding());
+
+			CHECK(mask.AND(ImageView<const byte>(view)));
+			CHECK(mask.Max() == 0xf0);
+			CHECK_FALSE(view.AND(ImageBase<byte>(3, 10, 20)));
+		}
+
+		SUBCASE("a sub-view is a region of the memory")
+		{
+			auto region = view.View(2, 1, 4, 3);
+
+			CHECK(region.Data() == memory.data() + PITCH + 6);
+			CHECK(region.Max() == 5);
+
+			region.Shift(-100);
+			CHECK(view.ZeroCount() == 20 + 12 * 3);
+			CHECK_FALSE(view.View(18, 0, 4, 1));
+		}
+
+		SUBCASE("encoding a view matches encoding a copy")
+		{
+			ImageBase<byte> copy(3, 20, 10);
+
+			for (int y=0; y<10; y++)
+			{
+				std::memcpy(copy.Row(y).data, view.Row(y).data, 60);
+			}
+
+			std::vector<byte> a, b;
+			CHECK(emg::image::Qoi::Encode(ImageView<const byte>(view), a));
+			CHECK(emg::image::Qoi::Encode(copy, b));
+			CHECK(a == b);
+
+			ImageBase<byte> grey(1, 20, 10);
+			grey = 3;
+			CHECK(emg::image::Qoi::Encode(grey.View().View(0, 0, 10, 10), a));
+			CHECK(a.size() == 14 + 100);
+		}
+	}
+
+
+	TEST_CASE("expressions")
+	{
+		namespace image = emg::image;
+
+		// Odd dimensions so that every remainder loop is used
+		ImageBase<byte> a(3, 37, 5), b(3, 37, 5), dst;
+
+		for (size_t i=0; i<a.Internal().size(); i++)
+		{
+			a.Internal()[i] = (i * 37) % 256;
+			b.Internal()[i] = (i * 101 + 7) % 256;
+		}
+
+		// Check every element of an image against a function of the corresponding samples of a and b
+		auto matches = [&](auto &&image, auto fn) {
+			if (image.Width() != 37 || image.Height() != 5 || image.Depth() != 3) return false;
+
+			for (size_t i=0; i<a.Internal().size(); i++)
+			{
+				if (image.Internal()[i] != fn(a.Internal()[i], b.Internal()[i])) return false;
+			}
+
+			return true;
+		};
+
+		SUBCASE("arithmetic is saturated to the destination type")
+		{
+			dst = a + b;
+			CHECK(matches(dst, [](int x, int y) { return std::min(x + y, 255); }));
+
+			dst = a - b;
+			CHECK(matches(dst, [](int x, int y) { return std::max(x - y, 0); }));
+
+			dst = a * 2 - b / 3;
+			CHECK(matches(dst, [](int x, int y) { return std::clamp(x * 2 - y / 3, 0, 255); }));
+
+			dst = image::max(a, b) - image::min(a, b);
+			CHECK(matches(dst, [](int x, int y) { return std::abs(x - y); }));
+		}
+
+		SUBCASE("multiple steps are fused")
+		{
+			dst = clamp(a * 0.5 + b - 10, 0, 255) > 128;
+			CHECK(matches(dst, [](float x, float y) { return std::clamp(x * 0.5f + y - 10, 0.0f, 255.0f) > 128 ? 255 : 0; }));
+
+			dst = image::select(a > b, a, b / 2);
+			CHECK(matches(dst, [](int x, int y) { return x > y ? x : y / 2; }));
+
+			dst = (~a & b) | (a == b);
+			CHECK(matches(dst, [](int x, int y) { return (~x & y & 255) | (x == y ? 255 : 0); }));
+		}
+
+		SUBCASE("the result type follows the destination")
+		{
+			ImageBase<float> f;
+			f = abs(a - b) / 2.0;
+			CHECK(matches(f, [](float x, float y) { return std::abs(x - y) / 2.0f; }));
+
+			ImageBase<int16_t> s;
+			s = -(a * 300) + b;
+			CHECK(matches(s, [](int x, int y) { return std::max(-x * 300 + y, -32768); }));
+
+			ImageBase<uint16_t> w;
+			w = (a + 1) * b;
+			CHECK(matches(w, [](int x, int y) { return (x + 1) * y; }));
+
+			// Images of the same size are packed
+			ImageBase<int8_t> n, c;
+			n = a * 0 - 5;
+			c = n * 2 + image::select(a > 100, 1, -1);
+			CHECK(matches(c, [](int x, int) { return -10 + (x > 100 ? 1 : -1); }));
+
+			ImageBase<double> d;
+			d = f * 0.25 + 1;
+			CHECK(matches(d, [](double x, double y) { return (double)(std::abs((float)x - (float)y) / 2.0f) * 0.25 + 1; }));
+		}
+
+		SUBCASE("integer division by zero results in 0")
+		{
+			namespace simd = image::simd;
+
+			for (size_t i=0; i<b.Internal().size(); i+=3)
+			{
+				b.Internal()[i] = 0;
+			}
+
+			for (auto isa : { simd::Isa::Sse2, simd::Isa::Avx2, simd::Isa::Avx512 })
+			{
+				if (isa > simd::Detect()) continue;
+
+				ImageBase<byte> d(3, 37, 5);
+
+				CHECK(image::Evaluate(image::seq, d.View(), a / b, isa));
+				CHECK(matches(d, [](int x, int y) { return y ? x / y : 0; }));
+
+				CHECK(image::Evaluate(image::seq, d.View(), a / 0 + 1, isa));
+				CHECK(matches(d, [](int, int) { return 1; }));
+			}
+
+			// The quotient that overflows wraps instead of trapping
+			ImageBase<int32_t> n(1, 37, 5), m(1, 37, 5), q;
+			n	= std::numeric_limits<int32_t>::lowest();
+			m	= -1;
+			q	= n / m + n / 0;
+			CHECK(std::all_of(q.Data(), q.Data() + q.Size(), [](int32_t v) { return v == std::numeric_limits<int32_t>::lowest(); }));
+		}
+
+		SUBCASE("every instruction set gives the same results")
+		{
+			namespace simd = image::simd;
+
+			for (auto isa : { simd::Isa::Sse2, simd::Isa::Avx2, simd::Isa::Avx512 })
+			{
+				if (isa > simd::Detect()) continue;
+
+				ImageBase<byte> d(3, 37, 5);
+				ImageBase<uint16_t> w(3, 37, 5), q(3, 37, 5);
+				ImageBase<float> f(3, 37, 5);
+
+				CHECK(image::Evaluate(image::seq, d.View(), clamp(a * 0.5 + b - 10, 0, 255) > 128, isa));
+				CHECK(matches(d, [](float x, float y) { return std::clamp(x * 0.5f + y - 10, 0.0f, 255.0f) > 128 ? 255 : 0; }));
+
+				CHECK(image::Evaluate(image::seq, d.View(), a - b / 2, isa));
+				CHECK(matches(d, [](int x, int y) { return std::max(x - y / 2, 0); }));
+
+				CHECK(image::Evaluate(image::seq, w.View(), (a + 1) * b, isa));
+				CHECK(image::Evaluate(image::seq, q.View(), w + w / 2 - 1000, isa));
+				CHECK(matches(q, [](int x, int y) { return std::clamp((x + 1) * y * 3 / 2 - 1000, 0, 65535); }));
+
+				CHECK(image::Evaluate(image::seq, f.View(), image::select(a < b, -a, b * 0.25), isa));
+				CHECK(matches(f, [](float x, float y) { return x < y ? -x : y * 0.25f; }));
+			}
+		}
+
+		SUBCASE("views with padding and the destination as an operand")
+		{
+			constexpr size_t PITCH = 37 * 3 + 5;
+			std::vector<byte> memory(PITCH * 5, 42);
+			emg::ImageView<byte> view(memory.data(), 37, 5, 3, PITCH);
+
+			CHECK(image::Evaluate(view, a + 0));
+			CHECK(image::Evaluate(view, view + b));
+			CHECK(matches(ImageBase<byte>(3, 37, 5) = view + 0, [](int x, int y) { return std::min(x + y, 255); }));
+			CHECK(memory[PITCH - 1] == 42);
+			CHECK(memory.back() == 42);
+
+			a = a / 2 + a / 4;
+			CHECK(a.Internal()[100] == (100 * 37 % 256) / 2 + (100 * 37 % 256) / 4);
+
+			CHECK_FALSE(image::Evaluate(view.View(0, 0, 10, 5), a + b));
+		}
+
+		SUBCASE("parallel evaluation matches the serial results")
+		{
+			emg::Executor pool(3);
+			const image::Policy policy = { true, &pool, 0, 64 };
+
+			ImageBase<byte> serial;
+			serial = (a + b) / 2 > image::max(a, b) - 64;
+			dst.Assign(policy, (a + b) / 2 > image::max(a, b) - 64);
+			CHECK(dst.Internal() == serial.Internal());
+		}
+
+		SUBCASE("images must match")
+		{
+			CHECK_THROWS(a + ImageBase<byte>(3, 10, 10));
+			CHECK_THROWS(a + ImageBase<byte>(1, 37, 5));
+
+			Image<byte, 1> grey;
+			CHECK_THROWS(grey = a + 1);
+		}
+	}
+
+
+	TEST_CASE("planar images")
+	{
+		namespace image = emg::image;
+		using emg::PlanarImage;
+
+		// Odd dimensions so that every remainder loop is used
+		ImageBase<byte> src(3, 37, 5);
+
+		for (size_t i=0; i<src.Internal().size(); i++)
+		{
+			src.Internal()[i] = (i * 37) % 256;
+		}
+
+		SUBCASE("an image survives a round trip")
+		{
+			PlanarImage<byte> planar(src);
+			ImageBase<byte> dst;
+
+			REQUIRE(planar.Depth() == 3);
+			REQUIRE(planar.Width() == 37);
+			REQUIRE(planar.Height() == 5);
+
+			CHECK(planar.Plane(1).Data()[10] == src.Internal()[10 * 3 + 1]);
+			CHECK(planar.Plane(2).Data()[36 + 37 * 4] == src.Internal()[(36 + 37 * 4) * 3 + 2]);
+			CHECK_FALSE(planar.Plane(3));
+
+			planar.Interleave(dst);
+			CHECK(dst.Depth() == 3);
+			CHECK(dst.Internal() == src.Internal());
+		}
+
+		SUBCASE("every plane is aligned")
+		{
+			PlanarImage<uint16_t> planar(4, 37, 5);
+
+			for (byte c=0; c<4; c++)
+			{
+				CHECK((uintptr_t)planar.Data(c) % image::Allocator::ALIGNMENT == 0);
+			}
+		}
+
+		SUBCASE("every instruction set and depth gives the same results")
+		{
+			namespace simd = image::simd;
+
+			auto check = [](auto sample, const size_t depth, const simd::Isa isa) {
+				using T = decltype(sample);
+
+				constexpr size_t PIXELS = 261;
+				std::vector<T> interleaved(PIXELS * depth), back(PIXELS * depth);
+				std::vector<std::vector<T>> planes(depth, std::vector<T>(PIXELS));
+				std::vector<T *> dst;
+
+				for (size_t i=0; i<interleaved.size(); i++) interleaved[i] = (T)(i * 7 + 3);
+				for (auto &p : planes) dst.push_back(p.data());
+
+				simd::Deinterleave(interleaved.data(), dst.data(), PIXELS, depth, isa);
+
+				for (size_t i=0; i<PIXELS; i++)
+				{
+					for (size_t k=0; k<depth; k++)
+					{
+						if (planes[k][i] != interleaved[i * depth + k]) return false;
+					}
+				}
+
+				const std::vector<const T *> src(dst.begin(), dst.end());
+				simd::Interleave(src.data(), back.data(), PIXELS, depth, isa);
+
+				return back == interleaved;
+			};
+
+			for (auto isa : { simd::Isa::Sse2, simd::Isa::Avx2, simd::Isa::Avx512 })
+			{
+				if (isa > simd::Detect()) continue;
+
+				for (size_t depth=1; depth<=5; depth++)
+				{
+					CHECK(check(byte {}, depth, isa));
+					CHECK(check(uint16_t {}, depth, isa));
+					CHECK(check(float {}, depth, isa));
+				}
+			}
+		}
+
+		SUBCASE("views with padding are converted")
+		{
+			constexpr size_t PITCH = 37 * 3 + 5;
+			std::vector<byte> memory(PITCH * 5, 42);
+			emg::ImageView<byte> view(memory.data(), 37, 5, 3, PITCH);
+
+			CHECK(image::Evaluate(view, src + 0));
+
+			PlanarImage<byte> planar(view);
+			ImageBase<byte> dst;
+			planar.Interleave(dst);
+			CHECK(dst.Internal() == src.Internal());
+
+			planar.Invert();
+			CHECK(planar.Interleave(image::seq, view));
+			CHECK(view.Row(4).data[3 * 36 + 2] == (byte)~src.Internal()[src.Internal().size() - 1]);
+			CHECK(memory[PITCH - 1] == 42);
+			CHECK(memory.back() == 42);
+
+			CHECK_FALSE(planar.Interleave(image::seq, view.View(0, 0, 10, 5)));
+		}
+
+		SUBCASE("operations apply to each channel")
+		{
+			PlanarImage<byte> planar(src);
+			const auto stats = planar.Stats();
+
+			REQUIRE(stats.size() == 3);
+
+			for (byte c=0; c<3; c++)
+			{
+				std::vector<byte> channel;
+
+				for (size_t i=c; i<src.Internal().size(); i+=3)
+				{
+					channel.push_back(src.Internal()[i]);
+				}
+
+				const emg::distribution expected(channel.data(), channel.size());
+				CHECK(stats[c].mean == doctest::Approx(expected.mean));
+				CHECK(stats[c].variance == doctest::Approx(expected.variance));
+			}
+
+			planar.Plane(0).Threshold(128);
+			planar.Shift(10);
+
+			CHECK(planar.Plane(0).Max() == 255);
+			CHECK(planar.Plane(0).Min() == 10);
+			CHECK(planar.Plane(1).Min() >= 10);
+		}
+
+		SUBCASE("channels are variance normalised independently")
+		{
+			PlanarImage<byte> planar(src);
+			planar.Plane(1).Clamp(100, 140);
+			planar.Plane(2).Threshold(0, 7, 7);
+
+			CHECK(planar.VarianceNormalise(400));
+
+			const auto stats = planar.Stats();
+			CHECK(stats[0].mean == doctest::Approx(128).epsilon(0.02));
+			CHECK(stats[1].mean == doctest::Approx(128).epsilon(0.02));
+			CHECK(stats[0].variance == doctest::Approx(400).epsilon(0.05));
+			CHECK(stats[1].variance == doctest::Approx(400).epsilon(0.05));
+
+			// A uniform channel has no variance to scale
+			CHECK(stats[2].mean == 7);
+
+			CHECK_FALSE(PlanarImage<byte>().VarianceNormalise(400));
+		}
+
+		SUBCASE("parallel conversions match the serial results")
+		{
+			emg::Executor pool(3);
+			const image::Policy policy = { true, &pool, 0, 64 };
+
+			PlanarImage<byte> planar(src, policy);
+			ImageBase<byte> dst;
+			planar.Interleave(policy, dst);
+			CHECK(dst.Internal() == src.Internal());
+
+			const auto serial = PlanarImage<byte>(src).Stats();
+			const auto parallel = planar.Stats(policy);
+			CHECK(parallel[2].mean == doctest::Approx(serial[2].mean));
+		}
+
+		SUBCASE("encoding a planar image matches encoding the interleaved one")
+		{
+			std::vector<byte> a, b;
+
+			CHECK(image::Qoi::Encode(PlanarImage<byte>(src), a));
+			CHECK(image::Qoi::Encode(src, b));
+			CHECK(a == b);
+
+			ImageBase<uint16_t> wide(src);
+			CHECK(image::Qoi::Encode(PlanarImage<uint16_t>(wide), a));
+			CHECK(image::Qoi::Encode(wide, b));
+			CHECK(a == b);
+
+			Image<byte, 1> grey(src);
+			CHECK(image::Qoi::Encode(PlanarImage<byte>(grey), a));
+			CHECK(image::Qoi::Encode(grey, b));
+			CHECK(a == b);
+		}
+	}
+
+
+	TEST_CASE("channel statistics")
+	{
+		namespace image = emg::image;
+		using emg::distribution;
+
+		// Odd dimensions so that every remainder loop is used, and values far from zero
+		ImageBase<uint16_t> src(3, 1037, 7);
+
+		for (size_t i=0; i<src.Internal().size(); i++)
+		{
+			src.Internal()[i] = 60000 + (i * 37) % 5000;
+		}
+
+		// The stats of channel c (or every channel if c < 0) of the pixels selected by the predicate
+		auto expected = [&](const int c, auto selected) {
+			std::vector<uint16_t> values;
+
+			for (int y=0; y<src.Height(); y++)
+			{
+				for (int x=0; x<src.Width(); x++)
+				{
+					for (int k=0; k<3; k++)
+					{
+						if ((c < 0 || c == k) && selected(x, y))
+						{
+							values.push_back(src.Internal()[(y * src.Width() + x) * 3 + k]);
+						}
+					}
+				}
+			}
+
+			return distribution(values);
+		};
+
+		auto all = [](int, int) { return true; };
+
+		auto same = [](const distribution &a, const distribution &b) {
+			return a.samples == b.samples && a.sum == b.sum && a.min == b.min && a.max == b.max
+				&& a.mean == doctest::Approx(b.mean) && a.variance == doctest::Approx(b.variance);
+		};
+
+		SUBCASE("masked values are aligned with the data")
+		{
+			std::vector<int> data	= { 100, 1, 2, 3 };
+			std::vector<byte> mask	= { 0, 1, 1, 1 };
+
+			const distribution d(data, &mask);
+			CHECK(d.samples == 3);
+			CHECK(d.min == 1);
+			CHECK(d.max == 3);
+			CHECK(d.mean == 2);
+
+			mask = { 0, 0, 0, 0 };
+			distribution none;
+			CHECK_FALSE(none.analyse(data, &mask));
+			CHECK(none.samples == 0);
+		}
+
+		SUBCASE("the variance does not suffer from cancellation")
+		{
+			const std::vector<double> data = { 1e9 + 1, 1e9 + 2, 1e9 + 3, 1e9 + 4 };
+
+			const distribution d(data);
+			CHECK(d.mean == 1e9 + 2.5);
+			CHECK(d.variance == doctest::Approx(1.25));
+
+			distribution a(data.data(), 2), b(data.data() + 2, 2);
+			a.merge(b);
+			CHECK(a.mean == d.mean);
+			CHECK(a.variance == doctest::Approx(1.25));
+			CHECK(a.sum == d.sum);
+		}
+
+		SUBCASE("integers are accumulated exactly")
+		{
+			const auto stats = src.Stats();
+			CHECK(same(stats, expected(-1, all)));
+			CHECK(stats.sum == (double)std::accumulate(src.Internal().begin(), src.Internal().end(), uint64_t { 0 }));
+
+			ImageBase<byte> narrow(src);
+			CHECK(same(narrow.Stats(), distribution(narrow.Internal())));
+
+			ImageBase<float> f(src);
+			CHECK(f.Stats().mean == doctest::Approx(stats.mean));
+			CHECK(f.Stats().variance == doctest::Approx(stats.variance));
+
+			// Types without kernels fall back to merging distributions
+			ImageBase<int> wide(src);
+			CHECK(same(wide.Stats(), stats));
+		}
+
+		SUBCASE("every instruction set gives the same results")
+		{
+			namespace simd = image::simd;
+
+			auto check = [](auto sample, const bool masked, const simd::Isa isa) {
+				using T = decltype(sample);
+
+				constexpr size_t SIZE = 1001;
+				std::vector<T> data(SIZE);
+				std::vector<simd::Bits<T>> mask(SIZE);
+				std::vector<byte> selected(SIZE);
+
+				for (size_t i=0; i<SIZE; i++)
+				{
+					data[i]		= (T)((i * 7919) % 251 + 3);
+					selected[i]	= !masked || i % 3;
+					mask[i]		= selected[i] ? ~simd::Bits<T> {} : 0;
+				}
+
+				simd::Moments<T> moments;
+				moments.shift = data[0];
+				simd::Accumulate(data.data(), masked ? mask.data() : nullptr, SIZE, moments, isa);
+
+				const distribution d(data.data(), SIZE, selected.data());
+				const double shift	= std::is_integral_v<T> ? 0 : (double)moments.shift;
+				const double count	= d.samples;
+
+				return moments.min == d.min && moments.max == d.max
+					&& (double)moments.sum == doctest::Approx(d.sum - shift * count)
+					&& (double)moments.squared == doctest::Approx(d.squared - shift * (2 * d.sum - shift * count));
+			};
+
+			for (auto isa : { simd::Isa::Sse2, simd::Isa::Avx2, simd::Isa::Avx512 })
+			{
+				if (isa > simd::Detect()) continue;
+
+				for (bool masked : { false, true })
+				{
+					CHECK(check(byte {}, masked, isa));
+					CHECK(check(uint16_t {}, masked, isa));
+					CHECK(check(float {}, masked, isa));
+				}
+			}
+		}
+
+		SUBCASE("each channel is analysed separately")
+		{
+			const auto channels = src.ChannelStats();
+
+			REQUIRE(channels.size() == 3);
+
+			for (int c=0; c<3; c++)
+			{
+				CHECK(same(channels[c], expected(c, all)));
+			}
+
+			// A view with padding
+			constexpr size_t PITCH = 1037 * 3 + 5;
+			std::vector<uint16_t> memory(PITCH * 7, 42);
+			emg::ImageView<uint16_t> view(memory.data(), 1037, 7, 3, PITCH * sizeof(uint16_t));
+			CHECK(image::Evaluate(view, src + 0));
+
+			CHECK(same(view.ChannelStats()[1], channels[1]));
+			CHECK(same(view.Stats(), src.Stats()));
+		}
+
+		SUBCASE("a mask selects the pixels")
+		{
+			auto selected = [](int x, int y) { return (x * 3 + y) % 7 < 3; };
+
+			image::Mask mask(src.Width(), src.Height());
+
+			for (int y=0; y<src.Height(); y++)
+			{
+				for (int x=0; x<src.Width(); x++)
+				{
+					mask.Set(x, y, selected(x, y));
+				}
+			}
+
+			const auto channels = src.ChannelStats(image::seq, mask);
+
+			for (int c=0; c<3; c++)
+			{
+				CHECK(same(channels[c], expected(c, selected)));
+			}
+
+			CHECK(same(src.Stats(image::seq, mask), expected(-1, selected)));
+			CHECK(same(src.Stats(image::seq, image::Mask(src.Width(), src.Height(), true)), src.Stats()));
+			CHECK(src.Stats(image::seq, image::Mask(src.Width(), src.Height())).samples == 0);
+			CHECK(src.Stats(image::seq, image::Mask(10, 10, true)).samples == 0);
+
+			// A mask made from an image
+			ImageBase<byte> marks(1, src.Width(), src.Height());
+			marks.Clear();
+			marks.Internal()[5] = 1;
+			marks.Internal()[src.Width() + 70] = 1;
+
+			const image::Mask sparse(marks.View());
+			CHECK(sparse.Count() == 2);
+			CHECK(sparse.Test(70, 1));
+			CHECK(src.Stats(image::seq, sparse).samples == 6);
+		}
+
+		SUBCASE("a region can be analysed with a region of the mask")
+		{
+			auto selected = [](int x, int y) { return x >= 65 && x < 65 + 130 && y >= 2 && y < 5 && (x + y) % 2; };
+
+			image::Mask mask(src.Width(), src.Height());
+
+			for (int y=0; y<src.Height(); y++)
+			{
+				for (int x=0; x<src.Width(); x++)
+				{
+					mask.Set(x, y, (x + y) % 2);
+				}
+			}
+
+			const auto region = src.View().View(65, 2, 130, 3);
+			const auto sub = emg::ImageView<const uint16_t>(src.SubImage(65, 2, 130, 3));
+
+			CHECK(sub.Data() == region.Data());
+			CHECK(same(region.Stats(image::seq, mask.View(65, 2, 130, 3)), expected(-1, selected)));
+			CHECK(same(sub.ChannelStats(image::seq, mask.View(65, 2, 130, 3))[2], expected(2, selected)));
+			CHECK(same(sub.Stats(), expected(-1, [](int x, int y) { return x >= 65 && x < 195 && y >= 2 && y < 5; })));
+		}
+
+		SUBCASE("parallel statistics match the serial results")
+		{
+			emg::Executor pool(3);
+			const image::Policy policy = { true, &pool, 0, 1024 };
+
+			image::Mask mask(src.Width(), src.Height(), true);
+			mask.Set(3, 3, false);
+
+			const auto serial	= src.ChannelStats(image::seq, mask);
+			const auto parallel	= src.ChannelStats(policy, mask);
+
+			for (int c=0; c<3; c++)
+			{
+				CHECK(same(parallel[c], serial[c]));
+			}
+
+			CHECK(same(src.Stats(policy), src.Stats()));
+		}
+	}
+
+
+	TEST_CASE("raw files")
+	{
+		const auto path = (std::filesystem::temp_directory_path() / "emergent-test.raw").string();
+
+		namespace image = emg::image;
+
+		auto same = [](const auto &a, const auto &b) {
+			return a.Width() == b.Width() && a.Height() == b.Height() && a.Depth() == b.Depth()
+				&& std::equal(a.Data(), a.Data() + a.Size() * a.Depth(), b.Data());
+		};
+
+		ImageBase<byte> src(3, 70, 5);
+
+		for (size_t i=0; i<src.Size() * 3; i++)
+		{
+			src[i] = i % 251;
+		}
+
+		SUBCASE("an image survives a round trip")
+		{
+			REQUIRE(src.SaveRaw(path));
+
+			ImageBase<byte> dst;
+			CHECK(dst.LoadRaw(path));
+			CHECK(same(dst, src));
+
+			Image<byte, rgb> rgb;
+			CHECK(rgb.LoadRaw(path));
+			CHECK(same(rgb, src));
+
+			Image<byte, 1> grey;
+			CHECK_THROWS(grey.LoadRaw(path));
+
+			ImageBase<int8_t> other;
+			CHECK_FALSE(other.LoadRaw(path));
+		}
+
+		SUBCASE("a mapped file is viewed without copying")
+		{
+			REQUIRE(src.SaveRaw(path));
+
+			image::RawFile file(path);
+			REQUIRE(file);
+
+			const auto &header = file.Header();
+			CHECK(header.width == 70);
+			CHECK(header.height == 5);
+			CHECK(header.depth == 3);
+			CHECK(header.offset == 4096);
+			CHECK(header.stride == 256);
+
+			auto view = file.View<const byte>();
+			REQUIRE(view);
+			CHECK((size_t)view.Data() % 64 == 0);
+			CHECK(view.Pitch() == 256);
+			CHECK(view.Max() == src.Max());
+			CHECK(view.Stats().sum == src.Stats().sum);
+			CHECK(std::equal(src.Row(4).data, src.Row(4).data + 210, view.Row(4).data));
+
+			CHECK_FALSE(file.View<byte>());
+			CHECK_FALSE(file.View<const int8_t>());
+			CHECK(file.Verify());
+		}
+
+		SUBCASE("a writable mapping changes the file")
+		{
+			REQUIRE(src.SaveRaw(path, { .alignment = 64, .row = 1 }));
+
+			{
+				image::RawFile file(path, true);
+				REQUIRE(file);
+				CHECK(file.Header().offset == 64);
+				CHECK(file.Header().stride == 210);
+
+				auto view = file.View<byte>();
+				REQUIRE(view);
+				view.Invert();
+			}
+
+			ImageBase<byte> dst;
+			CHECK(dst.LoadRaw(path));
+			CHECK(dst[0] == 255);
+			CHECK(dst[1] == 254);
+		}
+
+		SUBCASE("dimensions are not limited to 16 bits")
+		{
+			ImageBase<float> wide(1, 70000, 2);
+			wide = 0.5f;
+
+			REQUIRE(wide.SaveRaw(path));
+
+			ImageBase<float> dst;
+			CHECK(dst.LoadRaw(path));
+			CHECK(dst.Width() == 70000);
+			CHECK(same(dst, wide));
+
+			ImageBase<int32_t> same;
+			CHECK_FALSE(same.LoadRaw(path));
+		}
+
+		SUBCASE("a checksum detects corruption")
+		{
+			REQUIRE(src.SaveRaw(path, { .checksum = true }));
+			CHECK(image::RawFile(path).Verify());
+
+			{
+				image::RawFile file(path, true);
+				file.View<byte>().Row(2).data[7] ^= 1;
+				CHECK_FALSE(file.Verify());
+			}
+
+			ImageBase<byte> dst;
+			CHECK_FALSE(dst.LoadRaw(path));
+		}
+
+		SUBCASE("truncated and foreign files are rejected")
+		{
+			REQUIRE(src.SaveRaw(path));
+			std::filesystem::resize_file(path, 4096 + 256 * 4);
+
+			CHECK_FALSE(image::RawFile(path));
+			CHECK_FALSE(ImageBase<byte>().LoadRaw(path));
+		}
+
+		SUBCASE("headers with rows that overflow the file are rejected")
+		{
+			REQUIRE(src.SaveRaw(path));
+
+			image::RawHeader header;
+			{
+				std::ifstream ifs(path, std::ios::binary);
+				ifs.read((char *)&header, sizeof(header));
+			}
+
+			// The extent of the rows wraps to zero
+			header.stride	= 1ull << 63;
+			header.height	= 2;
+			{
+				std::fstream fs(path, std::ios::binary | std::ios::in | std::ios::out);
+				fs.write((char *)&header, sizeof(header));
+			}
+
+			CHECK_FALSE(image::RawFile(path));
+			CHECK_FALSE(ImageBase<byte>().LoadRaw(path));
+		}
+
+		SUBCASE("files with the older header can still be loaded")
+		{
+			{
+				std::ofstream ofs(path, std::ios::binary);
+				emg::ImageHeader header = { 3, 1, 70, 5 };
+				ofs.write((char *)&header, sizeof(header));
+				ofs.write((char *)src.Data(), src.Size() * 3);
+			}
+
+			CHECK_FALSE(image::RawFile(path));
+
+			ImageBase<byte> dst;
+			CHECK(dst.LoadRaw(path));
+			CHECK(same(dst, src));
+		}
+
+		std::filesystem::remove(path);
+	}
+
+
 	TEST_CASE("i/o")
 	{
 		SUBCASE("construct image from path")
@@ -0,0 +1,119 @@
+#include "doctest.h"
+#include <emergent/parallel/Parallel.hpp>
+
+using emergent::Chunking;
+using emergent::Generator;
+using emergent::ThreadPool;
+
+
+TEST_SUITE("parallel")
+{
+	TEST_CASE("parallel for over a range")
+	{
+		ThreadPool<4> pool;
+		std::vector<int> values(1000, 0);
+
+		SUBCASE("every value is visited once with dynamic chunking")
+		{
+			emergent::ParallelFor(pool, Generator<int>(0, 1000), [&](int i) { values[i]++; });
+
+			CHECK(std::all_of(values.begin(), values.end(), [](int v) { return v == 1; }));
+		}
+
+		SUBCASE("every value is visited once with static chunking")
+		{
+			emergent::ParallelFor(pool, Generator<int>(0, 1000), [&](int i) { values[i]++; }, { Chunking::Static });
+
+			CHECK(std::all_of(values.begin(), values.end(), [](int v) { return v == 1; }));
+		}
+
+		SUBCASE("a stepped range is respected")
+		{
+			emergent::ParallelFor(pool, Generator<int>(1, 500, 2), [&](int i) { values[i]++; }, { Chunking::Dynamic, 7 });
+
+			CHECK(std::count(values.begin(), values.end(), 1) == 500);
+			CHECK(values[0] == 0);
+			CHECK(values[999] == 1);
+		}
+
+		SUBCASE("chunks can be processed as a whole")
+		{
+			std::atomic<int> chunks = 0;
+
+			emergent::ParallelFor(pool, Generator<int>(0, 1000), [&](const Generator<int> &chunk) {
+				for (auto i : chunk) values[i]++;
+				chunks++;
+			}, { Chunking::Dynamic, 100 });
+
+			CHECK(chunks == 10);
+			CHECK(std::all_of(values.begin(), values.end(), [](int v) { return v == 1; }));
+		}
+
+		SUBCASE("an exception is passed back to the caller")
+		{
+			CHECK_THROWS_AS(
+				emergent::ParallelFor(pool, Generator<int>(0, 1000), [](int i) { if (i == 500) throw std::runtime_error("failed"); }),
+				std::runtime_error
+			);
+		}
+	}
+
+
+	TEST_CASE("parallel for over a 2D range")
+	{
+		ThreadPool<4> pool;
+		std::vector<int> values(64 * 48, 0);
+
+		SUBCASE("automatic tiling visits every position once")
+		{
+			emergent::ParallelFor(pool, Generator<int>(0, 64), Generator<int>(0, 48), [&](int x, int y) { values[y * 64 + x]++; });
+
+			CHECK(std::all_of(values.begin(), values.end(), [](int v) { return v == 1; }));
+		}
+
+		SUBCASE("explicit tile size visits every position once")
+		{
+			emergent::ParallelFor(pool, Generator<int>(0, 64), Generator<int>(0, 48), [&](int x, int y) { values[y * 64 + x]++; }, { Chunking::Dynamic, 5 });
+
+			CHECK(std::all_of(values.begin(), values.end(), [](int v) { return v == 1; }));
+		}
+	}
+
+
+	TEST_CASE("parallel reduction")
+	{
+		ThreadPool<4> pool;
+
+		SUBCASE("sum of a range")
+		{
+			const auto result = emergent::ParallelReduce(pool, Generator<int>(1, 1000), 0L,
+				[](long a, int v) { return a + v; },
+				[](long a, long b) { return a + b; }
+			);
+
+			CHECK(result == 500500);
+		}
+
+		SUBCASE("floating-point reductions are deterministic")
+		{
+			auto reduce = [&] {
+				return emergent::ParallelReduce(pool, Generator<int>(1, 100000), 0.0,
+					[](double a, int v) { return a + 1.0 / v; },
+					[](double a, double b) { return a + b; }
+				);
+			};
+
+			const double first = reduce();
+
+			for (int i=0; i<10; i++)
+			{
+				CHECK(reduce() == first);
+			}
+		}
+
+		SUBCASE("an empty range returns the identity")
+		{
+			CHECK(emergent::ParallelReduce(pool, Generator<int>(), 42, [](int a, int) { return a; }, [](int a, int b) { return a + b; }) == 42);
+		}
+	}
+}
@@ -0,0 +1,1252 @@
+#include "doctest.h"
+#include <emergent/thread/Pool.hpp>
+#include <emergent/thread/AtomicStack.hpp>
+#include <emergent/thread/Agent.hpp>
+#include <emergent/thread/Attributes.hpp>
+#include <emergent/thread/TaskGraph.hpp>
+#include <emergent/thread/Coroutine.hpp>
+#include <emergent/thread/Semaphore.hpp>
+#include <numeric>
+#include <cstring>
+
+using emergent::ThreadPool;
+using emergent::AtomicStack;
+using emergent::Scheduler;
+using emergent::AgentMode;
+using emergent::Agent;
+
+
+TEST_SUITE("pool")
+{
+	TEST_CASE("running jobs on a thread pool")
+	{
+		ThreadPool<4> pool;
+
+		REQUIRE(pool.Size() == 4);
+
+		SUBCASE("a job returns its result through the future")
+		{
+			auto result = pool.Run([] { return 42; });
+
+			REQUIRE(result.valid());
+			CHECK(result.get() == 42);
+		}
+
+		SUBCASE("a void job can be waited on")
+		{
+			std::atomic<bool> done = false;
+
+			pool.Run([&] { done = true; }).wait();
+
+			CHECK(done);
+		}
+
+		SUBCASE("many jobs are all executed")
+		{
+			std::atomic<int> count = 0;
+			std::vector<std::future<void>> results;
+
+			for (int i=0; i<1000; i++)
+			{
+				results.push_back(pool.Run([&] { count++; }));
+			}
+
+			for (auto &r : results) r.wait();
+
+			CHECK(count == 1000);
+		}
+
+		SUBCASE("an exception thrown by a job is passed through the future")
+		{
+			auto result = pool.Run([]() -> int { throw std::runtime_error("failed"); });
+
+			CHECK_THROWS_AS(result.get(), std::runtime_error);
+		}
+
+		SUBCASE("posted jobs are executed without a future")
+		{
+			std::atomic<int> count = 0;
+
+			for (int i=0; i<100; i++)
+			{
+				CHECK(pool.Post([&] { count++; }));
+			}
+
+			// Jobs are run in order from the shared queue so this will be one of the last
+			pool.Run([] {}).wait();
+
+			while (count < 100)
+			{
+				std::this_thread::yield();
+			}
+
+			CHECK(count == 100);
+		}
+
+		SUBCASE("jobs can submit further jobs to the same pool")
+		{
+			auto result = pool.Run([&] {
+				std::vector<std::future<int>> inner;
+
+				for (int i=0; i<16; i++)
+				{
+					inner.push_back(pool.Run([i] { return i; }));
+				}
+
+				int sum = 0;
+				for (auto &r : inner) sum += r.get();
+
+				return sum;
+			});
+
+			CHECK(result.get() == 120);
+		}
+	}
+
+
+	TEST_CASE("submitting jobs to a full thread pool")
+	{
+		// A single worker that is held busy and a shared queue that can only hold two jobs
+		ThreadPool<1> pool(2);
+		std::promise<void> gate;
+		auto blocker = gate.get_future().share();
+
+		REQUIRE(pool.Capacity() == 2);
+
+		std::atomic<bool> started = false;
+
+		auto first = pool.Run([&, blocker] { started = true; blocker.wait(); });
+
+		// Wait for the worker to take the first job off the shared queue and then fill it
+		while (!started)
+		{
+			std::this_thread::yield();
+		}
+
+		REQUIRE(pool.TryRun([] {}).has_value());
+		REQUIRE(pool.TryRun([] {}).has_value());
+
+		SUBCASE("try run rejects the job")
+		{
+			CHECK_FALSE(pool.TryRun([] { return 1; }).has_value());
+		}
+
+		SUBCASE("run for times out")
+		{
+			CHECK_FALSE(pool.RunFor(std::chrono::milliseconds(5), [] { return 1; }).has_value());
+		}
+
+		SUBCASE("run blocks until there is space")
+		{
+			auto release = std::async(std::launch::async, [&] {
+				std::this_thread::sleep_for(std::chrono::milliseconds(5));
+				gate.set_value();
+			});
+
+			auto result = pool.Run([] { return 42; });
+
+			REQUIRE(result.valid());
+			CHECK(result.get() == 42);
+		}
+
+		gate = {};
+	}
+
+
+	TEST_CASE("prioritising jobs in a thread pool")
+	{
+		using emergent::Priority;
+
+		ThreadPool<1> pool;
+		std::promise<void> gate;
+		std::atomic<bool> started = false;
+		std::vector<int> order;
+
+		pool.Post([&, blocker = gate.get_future()] { started = true; blocker.wait(); });
+
+		while (!started)
+		{
+			std::this_thread::yield();
+		}
+
+		SUBCASE("high priority jobs are taken ahead of low priority jobs")
+		{
+			for (int i=0; i<4; i++) pool.Post(Priority::Low, [&, i] { order.push_back(i); });
+			for (int i=4; i<8; i++) pool.Post(Priority::High, [&, i] { order.push_back(i); });
+
+			gate.set_value();
+			pool.Run(Priority::Low, [] {}).wait();
+
+			REQUIRE(order.size() == 8);
+
+			// Starvation protection may let a single low priority job through early
+			CHECK(std::count_if(order.begin(), order.begin() + 4, [](int i) { return i >= 4; }) >= 3);
+			CHECK(order.back() < 4);
+		}
+
+		SUBCASE("jobs with a deadline are taken earliest first")
+		{
+			const auto now = std::chrono::steady_clock::now();
+
+			for (int i=0; i<4; i++)
+			{
+				pool.Post({ Priority::Normal, now + std::chrono::milliseconds(10 - i) }, [&, i] { order.push_back(i); });
+			}
+
+			gate.set_value();
+			pool.Run([] {}).wait();
+
+			CHECK(order == std::vector<int> { 3, 2, 1, 0 });
+		}
+
+		SUBCASE("a stream of high priority jobs does not starve the low priority lane")
+		{
+			std::atomic<bool> done = false;
+			std::atomic<int> count = 0;
+			std::function<void()> repeat = [&] {
+				count++;
+				if (!done) pool.Post(Priority::High, repeat);
+			};
+
+			pool.Post(Priority::High, repeat);
+			auto low = pool.Run(Priority::Low, [&] { done = true; });
+
+			gate.set_value();
+
+			CHECK(low.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+			CHECK(count > 0);
+		}
+	}
+
+
+	TEST_CASE("scheduling delayed and periodic jobs on a thread pool")
+	{
+		using namespace std::chrono_literals;
+
+		ThreadPool<2> pool;
+		const auto start = std::chrono::steady_clock::now();
+
+		SUBCASE("a delayed job runs once the delay has elapsed")
+		{
+			std::promise<std::chrono::steady_clock::time_point> fired;
+			auto result = fired.get_future();
+
+			auto timer = pool.RunAfter(20ms, [&] { fired.set_value(std::chrono::steady_clock::now()); });
+
+			REQUIRE(result.wait_for(5s) == std::future_status::ready);
+			CHECK(result.get() - start >= 20ms);
+			CHECK_FALSE(timer.Cancel());
+		}
+
+		SUBCASE("timers fire in order of their due time")
+		{
+			std::mutex cs;
+			std::vector<int> order;
+			std::promise<void> done;
+
+			pool.RunAt(start + 30ms, [&] { std::lock_guard<std::mutex> lock(cs); order.push_back(2); done.set_value(); });
+			pool.RunAt(start + 10ms, [&] { std::lock_guard<std::mutex> lock(cs); order.push_back(1); });
+
+			REQUIRE(done.get_future().wait_for(5s) == std::future_status::ready);
+
+			std::lock_guard<std::mutex> lock(cs);
+			CHECK(order == std::vector<int> { 1, 2 });
+		}
+
+		SUBCASE("a cancelled job does not run")
+		{
+			std::atomic<bool> fired = false;
+
+			auto timer = pool.RunAfter(20ms, [&] { fired = true; });
+
+			CHECK(timer.Cancel());
+			CHECK(timer.Cancelled());
+			CHECK_FALSE(timer.Cancel());
+
+			std::this_thread::sleep_for(40ms);
+			CHECK_FALSE(fired);
+			CHECK(pool.Metrics().timers == 0);
+		}
+
+		SUBCASE("a periodic job repeats until cancelled")
+		{
+			std::atomic<int> count = 0;
+
+			auto timer = pool.RunEvery(2ms, [&] { count++; });
+
+			while (count < 5)
+			{
+				std::this_thread::sleep_for(1ms);
+			}
+
+			CHECK(timer.Cancel());
+
+			// Allow for a run that was already in progress
+			std::this_thread::sleep_for(10ms);
+			const int stopped = count;
+			std::this_thread::sleep_for(10ms);
+
+			CHECK(count == stopped);
+			CHECK(pool.Metrics().timers == 0);
+		}
+	}
+
+
+	TEST_CASE("cancelling jobs")
+	{
+		using namespace std::chrono_literals;
+
+		std::stop_source source;
+		std::promise<void> gate;
+		std::atomic<bool> started = false;
+
+		SUBCASE("a queued job is dropped once a stop is requested")
+		{
+			ThreadPool<1> pool;
+			std::atomic<bool> ran = false;
+
+			pool.Post([&, blocker = gate.get_future()] { started = true; blocker.wait(); });
+
+			auto result = pool.Run(source.get_token(), [&] { ran = true; return 1; });
+
+			source.request_stop();
+			gate.set_value();
+
+			CHECK_THROWS_AS(result.get(), emergent::Cancelled);
+			CHECK_FALSE(ran);
+		}
+
+		SUBCASE("a running job is passed the token and can finish early")
+		{
+			ThreadPool<1> pool;
+
+			auto result = pool.Run(source.get_token(), [&](std::stop_token token) {
+				started = true;
+
+				while (!token.stop_requested())
+				{
+					std::this_thread::sleep_for(1ms);
+				}
+
+				return 42;
+			});
+
+			while (!started)
+			{
+				std::this_thread::yield();
+			}
+
+			source.request_stop();
+
+			REQUIRE(result.wait_for(5s) == std::future_status::ready);
+			CHECK(result.get() == 42);
+		}
+
+		SUBCASE("a job assigned to a persistent thread is skipped if already cancelled")
+		{
+			emergent::PersistentThread thread;
+
+			source.request_stop();
+
+			CHECK_THROWS_AS(thread.Run(source.get_token(), [] { return 1; }).get(), emergent::Cancelled);
+			CHECK(thread.Run([] { return 2; }).get() == 2);
+		}
+
+		SUBCASE("a callable passed to a persistent thread by reference is copied")
+		{
+			emergent::PersistentThread thread;
+
+			auto job = [values = std::vector<int> { 1, 2, 3 }] { return (int)values.size(); };
+
+			CHECK(thread.Run(job).get() == 3);
+			CHECK(job() == 3);
+		}
+	}
+
+
+	// Metrics are recorded after a job has completed (and its future has been fulfilled)
+	// so wait for them to catch up.
+	emergent::PoolMetrics Settle(emergent::Executor &pool, const uint64_t executed)
+	{
+		for (int i=0; i<1000 && pool.Metrics().executed < executed; i++)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		return pool.Metrics();
+	}
+
+
+	TEST_CASE("an elastic thread pool")
+	{
+		using namespace std::chrono_literals;
+
+		emergent::Executor pool({ 1, 4, 20ms });
+		pool.Instrument(true);
+
+		REQUIRE(pool.Size() == 1);
+		REQUIRE(pool.Minimum() == 1);
+		REQUIRE(pool.Maximum() == 4);
+
+		SUBCASE("workers are added while jobs are queueing and retired once idle")
+		{
+			std::vector<std::future<void>> results;
+
+			for (int i=0; i<32; i++)
+			{
+				results.push_back(pool.Run([] { std::this_thread::sleep_for(2ms); }));
+			}
+
+			for (auto &r : results) r.wait();
+
+			auto metrics = Settle(pool, 32);
+
+			CHECK(metrics.grown > 0);
+			CHECK(metrics.workers.size() == 4);
+			CHECK(metrics.utilisation > 0.0);
+			CHECK(metrics.utilisation <= 1.0);
+
+			for (int i=0; i<1000 && pool.Size() > 1; i++)
+			{
+				std::this_thread::sleep_for(1ms);
+			}
+
+			metrics = pool.Metrics();
+
+			CHECK(pool.Size() == 1);
+			CHECK(metrics.threads == 1);
+			CHECK(metrics.retired == metrics.grown);
+		}
+
+		SUBCASE("a light load does not add workers")
+		{
+			for (int i=0; i<10; i++)
+			{
+				pool.Run([] {}).wait();
+			}
+
+			CHECK(pool.Metrics().grown == 0);
+			CHECK(pool.Size() == 1);
+		}
+	}
+
+
+	TEST_CASE("collecting metrics from a thread pool")
+	{
+		ThreadPool<2> pool(2);
+		pool.Instrument(true);
+
+		for (int i=0; i<100; i++)
+		{
+			pool.Run([] { std::this_thread::sleep_for(std::chrono::microseconds(10)); }).wait();
+		}
+
+		auto metrics = Settle(pool, 100);
+
+		CHECK(metrics.workers.size() == 2);
+		CHECK(metrics.executed == 100);
+		CHECK(metrics.latency.samples == 100);
+		CHECK(metrics.execution.samples == 100);
+		CHECK(metrics.execution.minimum >= 10);
+		CHECK(metrics.execution.Percentile(50) >= metrics.execution.minimum);
+		CHECK(metrics.execution.Percentile(100) == metrics.execution.maximum);
+
+		SUBCASE("timings are not recorded when disabled")
+		{
+			pool.Instrument(false);
+			pool.Run([] {}).wait();
+
+			metrics = Settle(pool, 101);
+
+			CHECK(metrics.executed == 101);
+			CHECK(metrics.execution.samples == 100);
+		}
+
+		SUBCASE("rejected submissions are counted")
+		{
+			std::atomic<bool> release = false;
+
+			pool.Post([&] { while (!release) std::this_thread::yield(); });
+			pool.Post([&] { while (!release) std::this_thread::yield(); });
+
+			int rejected = 0;
+
+			for (int i=0; i<10; i++)
+			{
+				rejected += !pool.TryRun([] {});
+			}
+
+			release = true;
+
+			CHECK(rejected > 0);
+			CHECK(pool.Metrics().rejected == (uint64_t)rejected);
+
+			// Rejected jobs are not left pending
+			Settle(pool, 102 + 10 - rejected);
+			CHECK(pool.Metrics().pending == 0);
+		}
+	}
+
+
+	TEST_CASE("applying thread attributes")
+	{
+		emergent::ThreadAttributes attributes;
+		attributes.name = "worker";
+		attributes.cpus = { 0, 1 };
+
+		SUBCASE("attributes for a thread in a group")
+		{
+			attributes.distribute = true;
+
+			CHECK(attributes.For(3).name == "worker/3");
+			CHECK(attributes.For(3).cpus == std::vector<int> { 1 });
+		}
+
+		#ifdef __linux__
+			SUBCASE("pool workers are named and pinned")
+			{
+				attributes.cpus = { 0 };
+				ThreadPool<2> pool(ThreadPool<2>::CAPACITY, attributes);
+
+				auto result = pool.Run([] {
+					char name[16] = {};
+					pthread_getname_np(pthread_self(), name, sizeof(name));
+
+					return std::make_pair(std::string(name), sched_getcpu());
+				}).get();
+
+				CHECK(result.first.rfind("worker/", 0) == 0);
+				CHECK(result.second == 0);
+			}
+
+			SUBCASE("failures are counted")
+			{
+				const auto failures = emergent::ThreadAttributes::Failures();
+
+				// An empty CPU set cannot be applied
+				attributes.cpus = { CPU_SETSIZE };
+				emergent::PersistentThread thread(attributes);
+
+				CHECK_FALSE(thread.Run([&] { return attributes.Apply(); }).get());
+				CHECK(emergent::ThreadAttributes::Failures() == failures + 2);
+			}
+		#endif
+	}
+
+
+	TEST_CASE("storing callables in a job")
+	{
+		using emergent::internal::Job;
+
+		int count = 0;
+
+		SUBCASE("a small callable is invoked")
+		{
+			Job job([&] { count++; });
+			job();
+
+			CHECK(count == 1);
+		}
+
+		SUBCASE("a large callable is invoked")
+		{
+			std::array<int, 64> values;
+			values.fill(1);
+
+			Job job([&, values] { count = std::accumulate(values.begin(), values.end(), 0); });
+			job();
+
+			CHECK(count == 64);
+		}
+
+		SUBCASE("moving a job transfers the callable")
+		{
+			Job job([&, p = std::make_unique<int>(42)] { count = *p; });
+			Job other = std::move(job);
+
+			CHECK_FALSE(job);
+			REQUIRE(other);
+
+			other();
+			CHECK(count == 42);
+		}
+	}
+
+
+	TEST_CASE("recycling small blocks")
+	{
+		using emergent::internal::Bins;
+
+		SUBCASE("blocks allocated after a thread has closed its free lists fill their bin")
+		{
+			// Constructed before the free lists of the thread, so destroyed after them
+			struct Late
+			{
+				void **out = nullptr;
+				~Late() { if (this->out) *this->out = Bins::Allocate(20, alignof(void *)); }
+			};
+
+			void *block = nullptr;
+
+			std::thread([&] {
+				static thread_local Late late;
+				Bins::Release(Bins::Allocate(16, alignof(void *)), 16, alignof(void *));
+				late.out = &block;
+			}).join();
+
+			REQUIRE(block);
+
+			// Released into the bin of this thread, which must then be able to hand it out at the full size
+			Bins::Release(block, 20, alignof(void *));
+			void *reused = Bins::Allocate(32, alignof(void *));
+
+			CHECK(reused == block);
+			std::memset(reused, 0, 32);
+			Bins::Release(reused, 32, alignof(void *));
+		}
+	}
+}
+
+
+TEST_SUITE("stack")
+{
+	TEST_CASE("pushing and popping values")
+	{
+		AtomicStack<int> stack;
+
+		SUBCASE("popping an empty stack returns nothing")
+		{
+			CHECK_FALSE(stack.Pop().has_value());
+			CHECK(stack.Empty());
+		}
+
+		SUBCASE("values are popped in reverse order")
+		{
+			stack.Push(1);
+			stack.Push(2);
+			stack.Push(3);
+
+			CHECK(stack.Size() == 3);
+			CHECK(stack.Pop() == 3);
+			CHECK(stack.Pop() == 2);
+			CHECK(stack.Pop() == 1);
+			CHECK(stack.Empty());
+		}
+
+		SUBCASE("a range is pushed with the last value on top")
+		{
+			std::vector<int> values = { 1, 2, 3, 4 };
+
+			stack.PushRange(values.begin(), values.end());
+
+			CHECK(stack.Size() == 4);
+			CHECK(stack.PopAll() == std::vector<int> { 4, 3, 2, 1 });
+			CHECK(stack.Empty());
+		}
+	}
+
+
+	TEST_CASE("move-only values can be stored")
+	{
+		AtomicStack<std::unique_ptr<int>> stack;
+
+		stack.Push(std::make_unique<int>(42));
+
+		auto value = stack.Pop();
+
+		REQUIRE(value.has_value());
+		CHECK(**value == 42);
+	}
+
+
+	TEST_CASE("concurrent pushing and popping")
+	{
+		AtomicStack<int> stack;
+		std::atomic<long> sum = 0;
+		std::vector<std::thread> threads;
+
+		for (int t=0; t<4; t++)
+		{
+			threads.emplace_back([&, t] {
+				for (int i=0; i<10000; i++)
+				{
+					stack.Push(t * 10000 + i);
+
+					if (auto v = stack.Pop())
+					{
+						sum += *v;
+					}
+				}
+			});
+		}
+
+		for (auto &t : threads) t.join();
+
+		for (auto v : stack.PopAll()) sum += v;
+
+		CHECK(sum == 39999L * 40000L / 2);
+		CHECK(stack.Empty());
+	}
+}
+
+
+struct Polled
+{
+	virtual ~Polled() = default;
+
+	bool Initialise()	{ return true; }
+	void OnEntry()		{ this->entered++; }
+	void OnExit()		{ this->exited++; exits++; }
+	void Poll()			{ this->polls++; }
+
+	std::atomic<int> entered	= 0;
+	std::atomic<int> exited		= 0;
+	std::atomic<int> polls		= 0;
+
+	static inline std::atomic<int> exits = 0;
+};
+
+REGISTER_TYPE(Polled, Polled)
+
+
+// Checks the command mailbox of an agent that has been initialised with a long period so
+// that it will be waiting whenever commands arrive.
+void CheckCommands(Agent<Polled> &agent)
+{
+	using namespace std::chrono_literals;
+
+	// Wait for the first poll
+	for (int i=0; i<1000 && agent.Subject()->polls < 1; i++)
+	{
+		std::this_thread::sleep_for(1ms);
+	}
+
+	REQUIRE(agent.Subject()->polls == 1);
+
+	SUBCASE("a call returns the result without polling")
+	{
+		auto result = agent.Call([](Polled *s) { return s->entered.load() * 42; });
+
+		REQUIRE(result.wait_for(1s) == std::future_status::ready);
+		CHECK(result.get() == 42);
+		CHECK(agent.Subject()->polls == 1);
+	}
+
+	SUBCASE("exceptions are returned through the future")
+	{
+		auto result = agent.Call([](auto *) -> int { throw std::runtime_error("failed"); });
+
+		CHECK_THROWS_AS(result.get(), std::runtime_error);
+	}
+
+	SUBCASE("commands are executed in order and can request a poll")
+	{
+		std::vector<int> order;
+
+		for (int i=0; i<100; i++)
+		{
+			agent.Send([&order, i](auto *) { order.push_back(i); return false; });
+		}
+
+		agent.Send([](auto *) { return true; });
+
+		for (int i=0; i<1000 && agent.Subject()->polls < 2; i++)
+		{
+			std::this_thread::sleep_for(1ms);
+		}
+
+		CHECK(agent.Subject()->polls == 2);
+		CHECK(agent.Metrics().commands == 101);
+		REQUIRE(order.size() == 100);
+		CHECK(std::is_sorted(order.begin(), order.end()));
+	}
+}
+
+
+TEST_SUITE("agent")
+{
+	TEST_CASE("agents sharing a scheduler")
+	{
+		using namespace std::chrono_literals;
+
+		Scheduler scheduler(2);
+
+		REQUIRE(scheduler.Size() == 2);
+
+		SUBCASE("many agents are polled by the shared threads")
+		{
+			std::vector<std::unique_ptr<Agent<Polled>>> agents;
+
+			for (int i=0; i<64; i++)
+			{
+				agents.push_back(std::make_unique<Agent<Polled>>());
+				REQUIRE(agents.back()->Initialise(scheduler, AgentMode::Sleep, 1ms, "polled"));
+			}
+
+			std::this_thread::sleep_for(50ms);
+
+			for (auto &a : agents)
+			{
+				CHECK(a->Subject()->entered == 1);
+				CHECK(a->Subject()->polls > 1);
+			}
+		}
+
+		SUBCASE("interval mode maintains the polling period")
+		{
+			Agent<Polled> agent;
+
+			REQUIRE(agent.Initialise(scheduler, AgentMode::Interval, 10ms, "polled"));
+
+			std::this_thread::sleep_for(105ms);
+
+			const int polls = agent.Subject()->polls;
+
+			CHECK(polls >= 8);
+			CHECK(polls <= 13);
+
+			const auto metrics = agent.Metrics();
+
+			CHECK(metrics.polls >= 8);
+			CHECK(metrics.overruns == 0);
+			CHECK(metrics.poll.samples == metrics.polls);
+		}
+
+		SUBCASE("blocking mode only polls when woken by Execute")
+		{
+			Agent<Polled> agent;
+
+			REQUIRE(agent.Initialise(scheduler, AgentMode::Blocking, 1ms, "polled"));
+
+			std::this_thread::sleep_for(20ms);
+			CHECK(agent.Subject()->polls == 1);
+
+			agent.Execute([](auto *) { return false; });
+			std::this_thread::sleep_for(20ms);
+			CHECK(agent.Subject()->polls == 1);
+
+			agent.Execute([](auto *) { return true; });
+			std::this_thread::sleep_for(20ms);
+			CHECK(agent.Subject()->polls == 2);
+		}
+
+		SUBCASE("the subject is exited when the agent is destroyed")
+		{
+			Polled::exits = 0;
+
+			{
+				Agent<Polled> agent;
+
+				REQUIRE(agent.Initialise(scheduler, AgentMode::Timeout, 1ms, "polled"));
+				std::this_thread::sleep_for(10ms);
+
+				CHECK(agent.Subject()->entered == 1);
+				CHECK(Polled::exits == 0);
+			}
+
+			CHECK(Polled::exits == 1);
+		}
+	}
+
+
+	TEST_CASE("sending commands to an agent")
+	{
+		using namespace std::chrono_literals;
+
+		Scheduler scheduler(1);
+		Agent<Polled> agent;
+
+		SUBCASE("dedicated thread")
+		{
+			REQUIRE(agent.Initialise(AgentMode::Interval, 10s, "polled"));
+			CheckCommands(agent);
+		}
+
+		SUBCASE("scheduled")
+		{
+			REQUIRE(agent.Initialise(scheduler, AgentMode::Sleep, 10s, "polled"));
+			CheckCommands(agent);
+		}
+	}
+}
+
+
+TEST_SUITE("future")
+{
+	using emergent::Future;
+	using emergent::Promise;
+	using emergent::TaskGraph;
+
+
+	TEST_CASE("chaining continuations")
+	{
+		ThreadPool<2> pool;
+
+		SUBCASE("continuations receive the result of the previous stage")
+		{
+			auto result = emergent::Async(pool, [] { return 20; })
+				.Then(pool, [](int v) { return v + 1; })
+				.Then([](int v) { return v * 2; });
+
+			CHECK(result.Get() == 42);
+		}
+
+		SUBCASE("a continuation can be attached after completion")
+		{
+			Promise<std::string> promise;
+			auto future = promise.GetFuture();
+
+			promise.Set("done");
+
+			CHECK(future.Ready());
+			CHECK(future.Then(pool, [](const std::string &s) { return s.size(); }).Get() == 4);
+		}
+
+		SUBCASE("exceptions skip the remaining stages")
+		{
+			std::atomic<bool> invoked = false;
+
+			auto result = emergent::Async(pool, []() -> int { throw std::runtime_error("failed"); })
+				.Then(pool, [&](int v) { invoked = true; return v; });
+
+			CHECK_THROWS_AS(result.Get(), std::runtime_error);
+			CHECK_FALSE(invoked);
+		}
+
+		SUBCASE("a destroyed promise breaks the future")
+		{
+			Future<int> future;
+
+			{
+				Promise<int> promise;
+				future = promise.GetFuture();
+			}
+
+			CHECK_THROWS_AS(future.Get(), std::future_error);
+		}
+	}
+
+
+	TEST_CASE("combining futures")
+	{
+		ThreadPool<4> pool;
+
+		SUBCASE("all results are gathered in order")
+		{
+			std::vector<Future<int>> futures;
+
+			for (int i=0; i<16; i++)
+			{
+				futures.push_back(emergent::Async(pool, [i] { return i * i; }));
+			}
+
+			auto result = emergent::WhenAll(futures).Get();
+
+			REQUIRE(result.size() == 16);
+			for (int i=0; i<16; i++) CHECK(result[i] == i * i);
+		}
+
+		SUBCASE("all void futures")
+		{
+			std::atomic<int> count = 0;
+			std::vector<Future<void>> futures;
+
+			for (int i=0; i<16; i++)
+			{
+				futures.push_back(emergent::Async(pool, [&] { count++; }));
+			}
+
+			emergent::WhenAll(futures).Then([&] { count += 100; }).Get();
+
+			CHECK(count == 116);
+		}
+
+		SUBCASE("the first future to complete is reported")
+		{
+			Promise<int> slow;
+			std::vector<Future<int>> futures = { slow.GetFuture(), emergent::Async(pool, [] { return 1; }) };
+
+			CHECK(emergent::WhenAny(futures).Get() == 1);
+
+			slow.Set(0);
+		}
+	}
+
+
+	TEST_CASE("running a task graph")
+	{
+		ThreadPool<4> pool;
+		TaskGraph graph;
+
+		std::atomic<int> decoded	= 0;
+		std::atomic<int> analysed	= 0;
+		std::atomic<int> merged		= 0;
+		std::atomic<bool> ordered	= true;
+
+		auto decode = graph.Add([&] { decoded++; });
+
+		for (int i=0; i<8; i++)
+		{
+			graph.Add([&] { if (!decoded) ordered = false; analysed++; }, { decode });
+		}
+
+		auto merge = graph.Add([&] { if (analysed != 8) ordered = false; merged++; }, { 1, 2, 3, 4, 5, 6, 7, 8 });
+		graph.Add([&] { if (!merged) ordered = false; }, { merge });
+
+		REQUIRE(graph.Size() == 11);
+		CHECK_THROWS_AS(graph.Add([] {}, { 20 }), std::out_of_range);
+
+		SUBCASE("nodes run after their dependencies and the graph can be reused")
+		{
+			for (int i=1; i<=3; i++)
+			{
+				decoded = analysed = 0;
+				graph.Run(pool).Get();
+
+				CHECK(ordered);
+				CHECK(merged == i);
+			}
+		}
+
+		SUBCASE("a failing node stops the graph")
+		{
+			graph.Add([] { throw std::runtime_error("failed"); });
+
+			CHECK_THROWS_AS(graph.Run(pool).Get(), std::runtime_error);
+		}
+	}
+}
+
+
+TEST_SUITE("sync")
+{
+	using namespace std::chrono_literals;
+
+
+	TEST_CASE("waiting on events")
+	{
+		SUBCASE("a manual reset event releases every waiter")
+		{
+			emergent::ManualResetEvent event;
+			std::atomic<int> released = 0;
+			std::vector<std::thread> threads;
+
+			for (int i=0; i<4; i++)
+			{
+				threads.emplace_back([&] { event.Wait(); released++; });
+			}
+
+			std::this_thread::sleep_for(5ms);
+			CHECK(released == 0);
+
+			event.Set();
+			for (auto &t : threads) t.join();
+
+			CHECK(released == 4);
+			CHECK(event.IsSet());
+			CHECK(event.WaitFor(0ms));
+
+			event.Reset();
+			CHECK_FALSE(event.WaitFor(1ms));
+		}
+
+		SUBCASE("an auto reset event releases a single waiter per set")
+		{
+			emergent::AutoResetEvent event;
+			std::atomic<int> released = 0;
+			std::vector<std::thread> threads;
+
+			for (int i=0; i<4; i++)
+			{
+				threads.emplace_back([&] { event.Wait(); released++; });
+			}
+
+			for (int i=1; i<=4; i++)
+			{
+				event.Set();
+
+				while (released < i) std::this_thread::yield();
+				std::this_thread::sleep_for(1ms);
+
+				CHECK(released == i);
+			}
+
+			for (auto &t : threads) t.join();
+
+			CHECK_FALSE(event.TryWait());
+		}
+
+		SUBCASE("waits time out")
+		{
+			emergent::AutoResetEvent event;
+
+			const auto start = std::chrono::steady_clock::now();
+
+			CHECK_FALSE(event.WaitFor(2ms));
+			CHECK(std::chrono::steady_clock::now() - start >= 2ms);
+			CHECK_FALSE(event.WaitUntil(std::chrono::steady_clock::now() - 1s));
+		}
+
+		SUBCASE("the reset event supports both behaviours")
+		{
+			emergent::ResetEvent event;
+
+			CHECK_FALSE(event.Wait(1));
+			CHECK_FALSE(event.Wait(500us));
+
+			event.Set();
+			CHECK(event.Wait(1, false));
+			CHECK(event.Wait(1));
+			CHECK_FALSE(event.Wait(1));
+
+			std::thread setter([&] { std::this_thread::sleep_for(2ms); event.Set(); });
+			CHECK(event.Wait());
+			setter.join();
+		}
+	}
+
+
+	TEST_CASE("counting with a semaphore")
+	{
+		emergent::Semaphore semaphore(2);
+
+		CHECK(semaphore.TryAcquire());
+		CHECK(semaphore.TryAcquire());
+		CHECK_FALSE(semaphore.TryAcquire());
+		CHECK_FALSE(semaphore.TryAcquireFor(1ms));
+
+		std::atomic<int> consumed = 0;
+		std::vector<std::thread> consumers;
+
+		for (int i=0; i<4; i++)
+		{
+			consumers.emplace_back([&] {
+				for (int j=0; j<1000; j++)
+				{
+					semaphore.Acquire();
+					consumed++;
+				}
+			});
+		}
+
+		for (int i=0; i<4000; i++)
+		{
+			semaphore.Release();
+		}
+
+		for (auto &c : consumers) c.join();
+
+		CHECK(consumed == 4000);
+		CHECK(semaphore.Count() == 0);
+	}
+}
+
+
+namespace coroutines
+{
+	using namespace std::chrono_literals;
+	using emergent::Task;
+
+
+	Task<int> Square(emergent::Executor &pool, int value)
+	{
+		co_await pool.Schedule();
+		co_return value * value;
+	}
+
+
+	Task<int> Sum(emergent::Executor &pool, int count)
+	{
+		int result = 0;
+
+		for (int i=0; i<count; i++)
+		{
+			result += co_await Square(pool, i);
+		}
+
+		co_return result;
+	}
+
+
+	Task<> Fail()
+	{
+		throw std::runtime_error("failed");
+		co_return;
+	}
+
+
+	Task<std::chrono::steady_clock::duration> Delay(Scheduler &scheduler)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		co_await scheduler.Sleep(20ms);
+
+		co_return std::chrono::steady_clock::now() - start;
+	}
+
+
+	Task<> Signalled(emergent::ResetEvent &event, std::atomic<int> &stage)
+	{
+		stage = 1;
+		co_await event;
+		stage = 2;
+	}
+}
+
+
+TEST_SUITE("coroutine")
+{
+	using namespace std::chrono_literals;
+
+
+	TEST_CASE("running coroutine tasks")
+	{
+		ThreadPool<2> pool;
+
+		SUBCASE("tasks can await other tasks")
+		{
+			CHECK(emergent::Spawn(pool, coroutines::Sum(pool, 10)).Get() == 285);
+		}
+
+		SUBCASE("exceptions propagate to the awaiter")
+		{
+			CHECK_THROWS_AS(emergent::Spawn(pool, coroutines::Fail()).Get(), std::runtime_error);
+		}
+
+		SUBCASE("awaiting a task that is not valid throws")
+		{
+			auto task	= coroutines::Square(pool, 2);
+			auto other	= std::move(task);
+
+			CHECK_FALSE(task.Valid());
+			CHECK_THROWS_AS(emergent::Spawn(pool, std::move(task)).Get(), std::logic_error);
+			CHECK_THROWS_AS(emergent::Spawn(pool, emergent::Task<int>()).Get(), std::logic_error);
+			CHECK(emergent::Spawn(pool, std::move(other)).Get() == 4);
+		}
+
+		SUBCASE("a task can sleep without blocking a thread")
+		{
+			Scheduler scheduler;
+
+			CHECK(emergent::Spawn(pool, coroutines::Delay(scheduler)).Get() >= 20ms);
+		}
+
+		SUBCASE("a task can wait on an event")
+		{
+			emergent::ResetEvent event;
+			std::atomic<int> stage = 0;
+
+			auto result = emergent::Spawn(pool, coroutines::Signalled(event, stage));
+
+			while (stage != 1) std::this_thread::yield();
+			std::this_thread::sleep_for(5ms);
+
+			CHECK(stage == 1);
+
+			event.Set();
+			result.Get();
+
+			CHECK(stage == 2);
+		}
+	}
+}